@@ -0,0 +1,10 @@
+#ifndef DEAD_RECKONING_HPP
+#define DEAD_RECKONING_HPP
+#include <atomic>
+#include <ros/ros.h>
+
+// 単体のノード(src/dead_reckoning_node.cpp)とnodelet(src/nodelet.cpp)の両方から呼ぶ
+namespace dead_reckoning {
+void run(ros::NodeHandle &n, const std::atomic<bool> &running);
+} // namespace dead_reckoning
+#endif
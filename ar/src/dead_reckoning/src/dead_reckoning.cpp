@@ -1,9 +1,13 @@
+#include <atomic>
+#include <dead_reckoning.hpp>
 #include <geometry_msgs/Pose2D.h>
+#include <ros/callback_queue.h>
 #include <ros/ros.h>
 #include <std_msgs/Float32.h>
 #include <std_msgs/String.h>
 #include <string>
 
+namespace dead_reckoning {
 bool should_reset_point = true;
 void checkGlobalMessage(const std_msgs::String msg) {
   std::string mode = msg.data;
@@ -21,9 +25,11 @@ void getPoseWheel(const geometry_msgs::Pose2D msgs) {
   wheel_robot_pose.theta = msgs.theta * 1.0;
 }
 
-int main(int argc, char **argv) {
-  ros::init(argc, argv, "dead_reckoning");
-  ros::NodeHandle n;
+void run(ros::NodeHandle &nh, const std::atomic<bool> &running) {
+  // nodeletの時も他と混ざらないように専用のキューで回す
+  ros::NodeHandle n(nh);
+  ros::CallbackQueue queue;
+  n.setCallbackQueue(&queue);
   ros::Subscriber wheel_robot_pose_sub =
       n.subscribe("wheel/robot_pose", 1, getPoseWheel);
   ros::Subscriber global_sub =
@@ -34,7 +40,6 @@ int main(int argc, char **argv) {
       n.advertise<geometry_msgs::Pose2D>("robot_pose", 1);
   ros::Publisher reset_robot_pose_pub =
       n.advertise<geometry_msgs::Pose2D>("wheel/reset_robot_pose", 1);
-  geometry_msgs::Pose2D robot_pose;
 
   constexpr int FREQ = 100;
   ros::Rate loop_rate(FREQ);
@@ -65,28 +70,30 @@ int main(int argc, char **argv) {
   offset_robot_pose.theta = 0;
 
   geometry_msgs::Pose2D robot_relative_pose;
-  while (ros::ok()) {
-    ros::spinOnce();
+  while (ros::ok() && running) {
+    queue.callAvailable();
 
+    // 同じプロセスのnodeletにはポインタのまま渡るので毎回新しく確保する
+    geometry_msgs::Pose2DPtr robot_pose(new geometry_msgs::Pose2D);
     ros::Time now = ros::Time::now();
     if (should_reset_point) {
-      robot_pose.x = start_x;
-      robot_pose.y = start_y;
-      robot_pose.theta = start_yaw;
-      if (robot_pose.theta > M_PI) {
-        robot_pose.theta -= 2 * M_PI;
-      } else if (robot_pose.theta <= -M_PI) {
-        robot_pose.theta += 2 * M_PI;
+      robot_pose->x = start_x;
+      robot_pose->y = start_y;
+      robot_pose->theta = start_yaw;
+      if (robot_pose->theta > M_PI) {
+        robot_pose->theta -= 2 * M_PI;
+      } else if (robot_pose->theta <= -M_PI) {
+        robot_pose->theta += 2 * M_PI;
       }
       reset_robot_pose_pub.publish(robot_pose);
       should_reset_point = false;
     } else {
-      robot_pose = wheel_robot_pose;
-      robot_pose.theta = M_PI;
-      if (robot_pose.theta > M_PI) {
-        robot_pose.theta -= 2 * M_PI;
-      } else if (robot_pose.theta <= -M_PI) {
-        robot_pose.theta += 2 * M_PI;
+      *robot_pose = wheel_robot_pose;
+      robot_pose->theta = M_PI;
+      if (robot_pose->theta > M_PI) {
+        robot_pose->theta -= 2 * M_PI;
+      } else if (robot_pose->theta <= -M_PI) {
+        robot_pose->theta += 2 * M_PI;
       }
       robot_pose_pub.publish(robot_pose);
     }
@@ -94,3 +101,4 @@ int main(int argc, char **argv) {
     loop_rate.sleep();
   }
 }
+} // namespace dead_reckoning
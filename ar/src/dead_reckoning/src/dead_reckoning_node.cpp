@@ -0,0 +1,10 @@
+#include <atomic>
+#include <dead_reckoning.hpp>
+#include <ros/ros.h>
+
+int main(int argc, char **argv) {
+  ros::init(argc, argv, "dead_reckoning");
+  ros::NodeHandle n;
+  std::atomic<bool> running(true);
+  dead_reckoning::run(n, running);
+}
@@ -0,0 +1,29 @@
+#include <atomic>
+#include <dead_reckoning.hpp>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <ros/ros.h>
+#include <thread>
+
+// robot_planのnodeletと同じプロセスで動かして, robot_poseをコピー無しで渡す
+namespace dead_reckoning {
+class DeadReckoning : public nodelet::Nodelet {
+public:
+  ~DeadReckoning() {
+    running_ = false;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+private:
+  void onInit() override {
+    running_ = true;
+    thread_ = std::thread([this] { run(getNodeHandle(), running_); });
+  }
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+} // namespace dead_reckoning
+
+PLUGINLIB_EXPORT_CLASS(dead_reckoning::DeadReckoning, nodelet::Nodelet)
@@ -1,22 +1,52 @@
 #include "motor_serial.hpp"
+#include "motor_serial/motor_commands.h"
+#include "motor_serial/motor_reply.h"
 #include "motor_serial/motor_serial.h"
 #include <ros/ros.h>
 
 using ros::MotorSerial;
 MotorSerial ms;
+ros::Publisher reply_pub;
 
+// 送信して, 返信と往復時間をmotor_replyに流す
+short sendAndReply(unsigned char id, unsigned char cmd, short data) {
+  ros::WallTime start = ros::WallTime::now();
+  short rx_data = ms.send(id, cmd, data);
+  if (reply_pub.getNumSubscribers() > 0) {
+    motor_serial::motor_reply reply;
+    reply.id = id;
+    reply.cmd = cmd;
+    reply.tx_data = data;
+    reply.rx_data = rx_data;
+    reply.round_trip = (ros::WallTime::now() - start).toSec();
+    reply_pub.publish(reply);
+  }
+  return rx_data;
+}
+
+// 返信が必要な読み出しはサービスで
 bool motorSerialSend(motor_serial::motor_serial::Request &tx,
                      motor_serial::motor_serial::Response &rx) {
-  rx.data = ms.send(tx.id, tx.cmd, tx.data);
+  rx.data = sendAndReply(tx.id, tx.cmd, tx.data);
   return true;
 }
 
+// 目標値など返信を待たなくていいものはトピックで, 送る側は止まらない
+void motorCommandsCallback(const motor_serial::motor_commands &msg) {
+  for (const motor_serial::motor_command &command : msg.commands) {
+    sendAndReply(command.id, command.cmd, command.data);
+  }
+}
+
 int main(int argc, char **argv) {
   ros::init(argc, argv, "motor_serial");
   ros::NodeHandle n;
 
   ros::ServiceServer service =
       n.advertiseService("motor_speed", motorSerialSend);
+  ros::Subscriber commands_sub =
+      n.subscribe("motor_commands", 10, motorCommandsCallback);
+  reply_pub = n.advertise<motor_serial::motor_reply>("motor_reply", 100);
   ROS_INFO_STREAM("Start MotorSerial");
 
   ros::spin();
@@ -0,0 +1,86 @@
+#ifndef ROBOT_PLAN_ACTION_EXECUTOR_HPP
+#define ROBOT_PLAN_ACTION_EXECUTOR_HPP
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// motion_plannerの機構への指令を, メインループを止めずに実行する
+// 機構(channel)ごとに1本のスレッドがあり, 同じ機構の指令は順番に,
+// 違う機構の指令は並行して送る. 終わったら(時間切れも)コールバックを呼ぶ
+// 機構の状態を読んで, 動き終わるまで待つこともできる(waitUntil)
+// コールバックはpollを呼んだスレッド(メインループ)で呼ばれる
+namespace motion_planner {
+enum class ActionStatus { IDLE, RUNNING, DONE, FAILED, TIMEOUT, CANCELED };
+
+class ActionExecutor {
+public:
+  // 送ってみて成功したらtrue, dataに返ってきた値を入れる
+  using Task = std::function<bool(int &data)>;
+  using Callback = std::function<void(ActionStatus status, int data)>;
+
+  explicit ActionExecutor(int num_channel);
+  ~ActionExecutor();
+  ActionExecutor(const ActionExecutor &) = delete;
+  ActionExecutor &operator=(const ActionExecutor &) = delete;
+
+  // channelの列に足してすぐ戻る. timeout[s]は実行を始めてからの時間
+  void start(int channel, Task task, double timeout,
+             Callback callback = nullptr);
+  // interval[s]ごとにconditionを呼び, settle回続けてtrueならDONE
+  // 読めなかった時もfalseを返せばよく, timeoutまで読み続ける
+  void waitUntil(int channel, Task condition, double interval, int settle,
+                 double timeout, Callback callback = nullptr);
+  // 時間切れを調べ, 終わった指令のコールバックを呼ぶ. ループの中で毎回呼ぶ
+  void poll();
+  // 全てのchannelの待っている指令を捨て, 実行中の指令の結果も使わない
+  // どちらのコールバックもCANCELEDで呼ばれる. 送っている最中の指令は
+  // 止められないので, idleになるのはそれが戻ってきてから(waitUntilは読む前に戻る)
+  void cancel();
+
+  // channelで最後に始めた指令の状態と, 返ってきた値
+  ActionStatus status(int channel) const;
+  int data(int channel) const;
+  // 実行中も待っている指令も無い
+  bool idle(int channel) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+  struct Job {
+    Task task;
+    double timeout;
+    Callback callback;
+    double interval; // waitUntilの時だけ使う
+    int settle;      // 0なら1回送るだけ
+  };
+  struct Channel {
+    std::deque<Job> queue;
+    std::condition_variable wake;
+    std::thread thread;
+    bool is_running = false; // 時間切れの後も, 戻ってくるまでtrue
+    Clock::time_point deadline;
+    Callback callback; // 実行中の指令のもの
+    ActionStatus status = ActionStatus::IDLE;
+    int data = 0;
+  };
+  struct Result {
+    Callback callback;
+    ActionStatus status;
+    int data;
+  };
+
+  void work(Channel &channel);
+  bool wait(Channel &channel, const Job &job, int &data,
+            std::unique_lock<std::mutex> &lock);
+
+  mutable std::mutex mutex_;
+  std::vector<Channel> channels_;
+  std::vector<Result> finished_; // コールバックをまだ呼んでいないもの
+  std::vector<Result> results_;  // pollで使い回す
+  bool should_stop_ = false;
+};
+} // namespace motion_planner
+#endif
@@ -0,0 +1,59 @@
+#ifndef ROBOT_PLAN_GOAL_MANAGER_HPP
+#define ROBOT_PLAN_GOAL_MANAGER_HPP
+#include <mission_graph.hpp>
+#include <vector>
+
+// motion_plannerの経路(目標点の列)と到着判定
+namespace motion_planner {
+struct GoalInfo {
+  int x;
+  int y;
+  int yaw; // degree あとでradに変換する
+  int action_type;
+  int action_value; // 必要なら使う e.g. 高さ
+  int velocity_x;
+  int velocity_y;
+  int accel;
+};
+
+class GoalManager {
+public:
+  GoalManager(int coat);
+  void add(GoalInfo goal);
+  void add(int x, int y, int yaw, int accel = 100, int action_type = 0,
+           int action_value = 0, int velocity_x = 0, int velocity_y = 0);
+
+  void next();
+  // 並行動作も全部始める前に戻す
+  void restart();
+  int id() const { return map_id_; } // nowの番号
+  void reset() { map_.resize(0); }
+
+  // 今の目標点から, 最初に止まる点までをwaypointsに入れる
+  void passWaypoints(std::vector<GoalInfo> &waypoints) const;
+  // 1点ごとに 経路番号, x, y, theta, accel, velocity_x, velocity_y, 通過 を並べる
+  void appendMission(int map_type, std::vector<double> &mission) const;
+
+  GoalInfo now;
+  // 走りながら動かす機構の動作. goalはこの経路の点の番号
+  MissionGraph actions;
+
+private:
+  // 点に着いた時に実行するのは次の点のaction_type(位置: 後判定)で,
+  // それが0: 通過, 1: 2段目昇降(指令を送ったらすぐ次へ進む)なら止まらない
+  // 速度を指定した点はその速度を優先する
+  // actionsで止まって待つ点も通過しない
+  bool isPassThrough(int id) const;
+
+  std::vector<GoalInfo> map_;
+  int map_id_ = 0;
+  int coat_reverse_;
+};
+
+// 目標点からerror_distance[mm]以内, 向きがerror_angle[degree]以内に入ったか
+// thetaは[rad]
+bool reachGoal(double goal_x, double goal_y, double goal_theta,
+               double current_x, double current_y, double current_theta,
+               double error_distance, double error_angle);
+} // namespace motion_planner
+#endif
@@ -0,0 +1,74 @@
+#ifndef ROBOT_PLAN_JERK_TRAJECTORY_HPP
+#define ROBOT_PLAN_JERK_TRAJECTORY_HPP
+
+// 躍度(加速度の変化)を制限したS字加減速(7区間)
+// 始点から終点までの直線上の道のりで1本の速度計画を立て, x, y, yawを同じ時刻で動かす
+// 速度と加速度の制限は軸ごとに分けずに合成したベクトルの大きさにかかる
+namespace robot_plan {
+struct JerkLimit {
+  double velocity;
+  double accel;
+  double jerk;
+};
+
+// 1本の道のり(>= 0)の上の速度計画
+class JerkProfile {
+public:
+  JerkProfile() { set(0, 0, 0, JerkLimit{1, 1, 1}); }
+  // distanceを初速velocity_first, 終速velocity_final(共に>= 0)で進む
+  // 距離が短くて初速から終速に変えきれない時は遅い方に揃える
+  void set(double distance, double velocity_first, double velocity_final,
+           const JerkLimit &limit);
+
+  double position(double time) const;
+  double velocity(double time) const;
+  double acceleration(double time) const;
+  // 道のりpositionに着く時刻, 速度は負にならないので単調
+  double timeAt(double position) const;
+
+  double totalTime() const { return total_time_; }
+  double distance() const { return distance_; }
+  double velocityLimit() const { return velocity_limit_; }
+
+private:
+  bool plan(double accel_max, double jerk_max);
+  double positionIn(double time) const;
+
+  double distance_;
+  double velocity_first_, velocity_final_, velocity_limit_;
+  // 加速と減速の, 躍度がかかっている時間と区間全体の時間
+  double jerk_accel_time_, accel_time_, jerk_decel_time_, decel_time_;
+  double const_time_, total_time_;
+  double accel_limit_, decel_limit_, jerk_;
+  JerkLimit limit_;
+};
+
+struct TrajectoryPoint {
+  double x, y, theta;
+  double vx, vy, omega;
+  double ax, ay;
+};
+
+class Trajectory2D {
+public:
+  Trajectory2D() { stay(0, 0, 0); }
+  // (x0, y0, theta0)から(x1, y1, theta1)へ, 速さはvelocity_firstからvelocity_finalへ
+  // yawの角速度がomega_maxを超えないように直線の速度制限を下げる
+  void set(double x0, double y0, double theta0, double x1, double y1,
+           double theta1, double velocity_first, double velocity_final,
+           const JerkLimit &limit, double omega_max);
+  void stay(double x, double y, double theta);
+
+  TrajectoryPoint at(double time) const;
+  // (x, y)を直線に下ろした点に着く時刻
+  double timeAt(double x, double y) const;
+  double totalTime() const { return profile_.totalTime(); }
+
+private:
+  double x0_, y0_, theta0_;
+  double unit_x_, unit_y_; // 進む向きの単位ベクトル
+  double yaw_per_distance_;
+  JerkProfile profile_;
+};
+} // namespace robot_plan
+#endif
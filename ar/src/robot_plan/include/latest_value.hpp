@@ -0,0 +1,33 @@
+#ifndef ROBOT_PLAN_LATEST_VALUE_HPP
+#define ROBOT_PLAN_LATEST_VALUE_HPP
+#include <atomic>
+
+// 1つのスレッドが書き, 別の1つのスレッドが最新の値だけを読む(トリプルバッファ)
+// どちらもロックを取らないので, 書き込みが続いても読む側が待たされない
+namespace robot_plan {
+template <class T> class LatestValue {
+public:
+  LatestValue() : buffer_(), middle_(1) {}
+
+  // 書く側のスレッドだけが呼ぶ
+  void write(const T &value) {
+    buffer_[back_] = value;
+    back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  // 読む側のスレッドだけが呼ぶ, 次にreadを呼ぶまで参照は有効
+  const T &read() {
+    if (middle_.load(std::memory_order_acquire) & FRESH) {
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    }
+    return buffer_[front_];
+  }
+
+private:
+  static constexpr int INDEX = 3, FRESH = 4;
+  T buffer_[3];
+  std::atomic<int> middle_; // 書き終わったバッファの番号 | 新しいか
+  int front_ = 0, back_ = 2;
+};
+} // namespace robot_plan
+#endif
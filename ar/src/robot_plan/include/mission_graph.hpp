@@ -0,0 +1,62 @@
+#ifndef ROBOT_PLAN_MISSION_GRAPH_HPP
+#define ROBOT_PLAN_MISSION_GRAPH_HPP
+#include <limits>
+#include <vector>
+
+// 機構の動作を, 目標点の列とは別の小さな依存グラフで並べたもの
+// 動作はある目標点へ向かう区間の途中(残りの距離)で始められ, 走るのと並行に動く
+// 止まる点では, その点で待つと決めた動作だけが終わるのを待つ
+namespace motion_planner {
+struct MissionAction {
+  int action_type; // GoalInfoと同じ番号(1: 2段目昇降, 2: ハンガー, 3: タオル)
+  int action_value;
+  int goal;              // GoalManagerの何番目の点へ向かう区間で始めるか
+  double distance_to_go; // 残りがこれ以下になったら始める[mm], 0なら着いてから
+  std::vector<int> depends; // 先に終わっている必要がある動作
+  bool is_blocking;         // 終わるまでgoalを離れない(止まってする動作)
+};
+
+enum class ActionState { WAITING, RUNNING, DONE };
+
+class MissionGraph {
+public:
+  // 区間に入ったらすぐ始める
+  static constexpr double ON_DEPART = std::numeric_limits<double>::infinity();
+
+  // dependsには先に足した動作しか書けないので, 依存は輪にならない
+  // 足した動作の番号を返す
+  int add(int action_type, int action_value, int goal,
+          double distance_to_go = 0, const std::vector<int> &depends = {},
+          bool is_blocking = false);
+  // goal番目の点を離れる前に, actionsが終わるのを待つ
+  void waitAt(int goal, const std::vector<int> &actions);
+  void restart();
+
+  // goal番目の点へ向かっていて残りがdistance_to_go[mm](着いたら0)の時,
+  // 新しく始める動作の番号をstartedに入れてRUNNINGにする
+  // 前の区間で始められなかった動作も, 依存が終わればここで始める
+  void update(int goal, double distance_to_go, std::vector<int> &started);
+  void finish(int id);
+
+  // goal番目の点で待つ動作が全て終わった
+  bool canLeave(int goal) const;
+  // goal番目の点で止まって待つ動作がある(通過させない)
+  bool isStop(int goal) const;
+
+  const MissionAction &action(int id) const { return actions_[id]; }
+  ActionState state(int id) const { return states_[id]; }
+  int size() const { return actions_.size(); }
+
+private:
+  struct Wait {
+    int goal;
+    std::vector<int> actions;
+  };
+  bool isDone(const std::vector<int> &ids) const;
+
+  std::vector<MissionAction> actions_;
+  std::vector<ActionState> states_;
+  std::vector<Wait> waits_;
+};
+} // namespace motion_planner
+#endif
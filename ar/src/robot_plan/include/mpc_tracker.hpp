@@ -0,0 +1,72 @@
+#ifndef ROBOT_PLAN_MPC_TRACKER_HPP
+#define ROBOT_PLAN_MPC_TRACKER_HPP
+#include <jerk_trajectory.hpp>
+#include <segment_planner.hpp>
+#include <vector>
+
+// 軌道追従のモデル予測制御
+// 速度が指令に1次遅れで追いつく全方向移動のモデルで, horizon段先までの位置と
+// 速度のずれが小さくなる指令を, 駆動輪の速さと指令の変化の制限の中で選ぶ
+// (制約付きの2次計画をADMMで解く). 反復の回数と時間に上限があり,
+// 間に合わなければその時点の解を制限内に収めて使う
+namespace robot_plan {
+struct MpcConfig {
+  int horizon = 10;                 // 何段先まで見るか
+  double step = 0.05;               // 1段の時間[s]
+  double motor_lag = 0.05;          // 速度が指令に追いつく時定数[s]
+  double wheel_velocity_max = 3000; // 駆動輪の速さの上限[mm/s]
+  double accel_max = 3000;          // 指令の変化の上限[mm/s^2]
+  // angular.z(駆動輪の速さと同じ単位)の上限. 0ならyawは動かさない
+  double omega_max = 0;
+  double turn_radius = 312; // angular.zを角速度[rad/s]に直す半径[mm]
+  double position_weight = 1, velocity_weight = 0.05;
+  double smooth_weight = 0.01; // 指令の変化の重み
+  int max_iterations = 50;
+  double time_budget = 0.002; // 1回に使ってよい時間[s]
+};
+
+struct MpcResult {
+  double velocity[3]; // フィールド座標のx, y[mm/s]とangular.z
+  int iterations;
+  double solve_time; // [s]
+  double residual;   // 制約の破れの最大値, 収束していれば小さい
+};
+
+class MpcTracker {
+public:
+  explicit MpcTracker(const MpcConfig &config = MpcConfig());
+  const MpcConfig &config() const { return config_; }
+
+  // reference[k]は(k + 1) * step後の目標, horizon個
+  // periodは前に呼んでからの時間で, 前の指令でモデルの速度を進めるのに使う
+  const MpcResult &solve(const Pose &current,
+                         const std::vector<TrajectoryPoint> &reference,
+                         double period);
+  // 止まった時など, モデルの速度と前の指令を0に戻す
+  void reset();
+
+  static constexpr int NUM_AXIS = 3, NUM_WHEEL = 4;
+
+private:
+  void multiplyA(const std::vector<double> &x, std::vector<double> &ax) const;
+  void multiplyAt(const std::vector<double> &y,
+                  std::vector<double> &aty) const;
+  void addAtA(std::vector<double> &matrix, double scale) const;
+  bool factorize();
+  void solveFactor(std::vector<double> &x) const;
+  void setBounds(double period);
+  void clip(double velocity[NUM_AXIS], double period) const;
+
+  MpcConfig config_;
+  int n_, m_; // 変数(軸 x 段)と制約の数
+  // 指令を1にした時と, 初速を1にした時の各段の位置と速度
+  std::vector<double> position_, velocity_, position_v0_, velocity_v0_;
+  std::vector<double> hessian_; // 位置, 速度, 変化の重みをかけた1軸分
+  double wheel_[NUM_WHEEL][NUM_AXIS]; // 今の向きでの駆動輪の速さの係数
+  std::vector<double> kkt_, q_, lower_, upper_;
+  std::vector<double> x_, z_, y_, ax_, rhs_, z_prev_;
+  double model_velocity_[NUM_AXIS] = {}, command_[NUM_AXIS] = {};
+  MpcResult result_;
+};
+} // namespace robot_plan
+#endif
@@ -0,0 +1,36 @@
+#ifndef ROBOT_PLAN_PERIODIC_TIMER_HPP
+#define ROBOT_PLAN_PERIODIC_TIMER_HPP
+#include <cstdint>
+
+// CLOCK_MONOTONICの絶対時刻で次の周期まで眠る制御ループ用のタイマー
+// 起きた時刻の遅れ(ジッタ), 処理にかかった時間, 周期を過ぎた回数を数える
+namespace robot_plan {
+// 時間は全て[s]
+struct LoopStats {
+  int cycles = 0;
+  int overruns = 0; // 処理が周期に間に合わず, 待たずに次へ進んだ回数
+  double jitter_mean = 0, jitter_max = 0;
+  double exec_mean = 0, exec_max = 0;
+};
+
+class PeriodicTimer {
+public:
+  explicit PeriodicTimer(double rate);
+  // 次の周期の始まりまで待つ. 過ぎていたら待たずに戻り, 飛ばした周期は詰めない
+  void wait();
+  double period() const { return period_ * 1.0e-9; }
+
+  const LoopStats &stats() const { return stats_; }
+  void resetStats() { stats_ = LoopStats(); }
+
+private:
+  int64_t period_;   // [ns]
+  int64_t deadline_; // 次に起きる時刻[ns]
+  int64_t wake_;     // 前に起きた時刻[ns]
+  LoopStats stats_;
+};
+
+// 呼んだスレッドをSCHED_FIFOのpriorityにする. 権限が無いなどで失敗したらfalse
+bool setRealtimePriority(int priority);
+} // namespace robot_plan
+#endif
@@ -0,0 +1,14 @@
+#ifndef ROBOT_PLAN_PLANNER_HPP
+#define ROBOT_PLAN_PLANNER_HPP
+#include <atomic>
+#include <ros/ros.h>
+
+// 単体のノード(src/*_node.cpp)とnodelet(src/nodelets.cpp)の両方から呼ぶ
+namespace local_planner {
+void run(ros::NodeHandle &n, const std::atomic<bool> &running);
+} // namespace local_planner
+
+namespace motion_planner {
+void run(ros::NodeHandle &n, const std::atomic<bool> &running);
+} // namespace motion_planner
+#endif
@@ -0,0 +1,45 @@
+#ifndef ROBOT_PLAN_S_CURVE_HPP
+#define ROBOT_PLAN_S_CURVE_HPP
+
+// 1軸分のS字加減速(加速度がcosで0から立ち上がって0に戻る)
+// 区間の時間と速度だけを持っていて, 任意の時刻の位置, 速度, 加速度をその場で計算する
+namespace robot_plan {
+class SCurve {
+public:
+  // 何もsetしていない時はその場(0)で止まっている
+  SCurve() { stay(0); }
+  // start_positionからdistance(>= 0)だけ進む, 速度と加速度は向きの符号付き
+  void set(double start_position, double distance, double velocity_first,
+           double velocity_max, double velocity_final, double accel_max);
+  // 動かずにpositionで止まる
+  void stay(double position);
+
+  double position(double time) const;
+  double velocity(double time) const;
+  double acceleration(double time) const;
+  // positionに一番近い時刻, 区間の範囲で単調に進む軌道を前提にする
+  double timeAt(double position) const;
+
+  double accelTime() const { return accel_time_; }
+  double constTime() const { return const_time_; }
+  double decelTime() const { return decel_time_; }
+  double totalTime() const { return decel_time_; }
+  double startPosition() const { return start_position_; }
+  double finalPosition() const { return start_position_ + decel_position_; }
+
+private:
+  // 動き始めからの相対位置
+  double relativePosition(double time) const;
+  // [time_min, time_max]の中でrelativePosition(time) = targetになる時刻
+  double solve(double target, double time_min, double time_max) const;
+
+  double start_position_;
+  double velocity_first_, velocity_max_, velocity_final_, accel_max_;
+  // 加速が終わる, 等速が終わる, 減速が終わる時刻(動き始めから)
+  double accel_time_, const_time_, decel_time_;
+  // 各区間が終わる時の相対位置
+  double accel_position_, const_position_, decel_position_;
+  double direction_; // 進む向き(1 or -1)
+};
+} // namespace robot_plan
+#endif
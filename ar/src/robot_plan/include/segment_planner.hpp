@@ -0,0 +1,85 @@
+#ifndef ROBOT_PLAN_SEGMENT_PLANNER_HPP
+#define ROBOT_PLAN_SEGMENT_PLANNER_HPP
+#include <jerk_trajectory.hpp>
+#include <s_curve.hpp>
+#include <vector>
+#include <waypoint_blend.hpp>
+
+// local_plannerの計算部分. 目標点を受け取った時の区間の計画(SegmentPlanner)と,
+// 制御周期ごとの追従(SegmentFollower)
+namespace robot_plan {
+struct Pose {
+  double x, y, theta;
+};
+
+// 1区間分の軌道. 始点, 終点, 前後の速度と加速度が決まれば中身も決まる
+struct Segment {
+  Pose start, goal;
+  double velocity_prev[2];  // 前の区間の終端速度
+  double velocity_final[2]; // この区間の終端速度
+  double accel;
+  SCurve curve[2];
+  Trajectory2D trajectory;
+};
+
+struct PlannerConfig {
+  bool is_jerk_mode = false; // false: 軸ごとのS字加減速, true: Trajectory2D
+  double velocity_min = 400, velocity_max = 3000;
+  double jerk_max = 2000, omega_max = 1.0;
+  double blend_distance = 400; // 角を曲がり始めてから曲がり終えるまでの距離
+  double error_distance = 50;  // これより短い区間は動かない
+  // 起動時に作っておいた区間を使う始点のずれの上限
+  double cache_distance = 100, cache_angle = 0.1, cache_velocity = 50;
+  // motion_plannerが次の目標点を送る, 前の目標点までの距離(着いたとみなす距離)
+  double reach_distance = 400;
+};
+
+class SegmentPlanner {
+public:
+  PlannerConfig config;
+
+  // start, goal, velocity_prev, velocity_final, accelを入れて呼ぶ
+  // velocity_finalが0でpass_waypointsの先頭がgoalなら, 角を曲がれる速さにする
+  void blend(Segment &segment,
+             const std::vector<Waypoint> &pass_waypoints) const;
+  // 区間のパラメータだけ決めて, 位置と速度は追従する時にその都度計算する
+  void plan(Segment &segment) const;
+
+  // 全経路を予定通りに進んだ時の区間を先に計算しておく
+  // 次の区間は前の区間の軌道が前の目標点からreach_distance以内に入った所から始まる
+  // missionは1点ごとに 経路番号, x, y, theta, accel, velocity_x, velocity_y, 通過
+  void precompute(const std::vector<double> &mission);
+  // 目標点, 加速度が同じで, 始点と速度がずれていなければ作っておいた区間を返す
+  const Segment *find(const Segment &segment) const;
+  int cacheSize() const { return cache_.size(); }
+
+  static constexpr int MISSION_FIELDS = 8;
+
+private:
+  void planSCurve(Segment &segment) const;
+  void planTrajectory(Segment &segment) const;
+  Pose reachPose(const Segment &segment) const;
+  std::vector<Segment> cache_;
+};
+
+// 今の位置に一番近い軌道上の点を, 前の時刻の近くに限って探して1周期先を返す
+class SegmentFollower {
+public:
+  SegmentFollower() { stay(Pose{0, 0, 0}, false); }
+  void set(const Segment &segment, bool is_jerk_mode);
+  void stay(const Pose &pose, bool is_jerk_mode);
+  // thetaはjerkの時は軌道上の向き, そうでなければ目標点の向き
+  TrajectoryPoint follow(const Pose &current, double period);
+  // 最後にfollowで返した点からoffset[s]先の軌道上の点(MpcTrackerの目標)
+  TrajectoryPoint preview(double offset) const;
+
+private:
+  double nextTime(double time, double prev_time, double total_time,
+                  double period) const;
+  static constexpr int SEARCH_RANGE = 5; // 何周期分前後の時刻まで探すか
+  Segment segment_;
+  bool is_jerk_mode_;
+  double curve_time_[2], trajectory_time_; // 今目標にしている軌道の時刻
+};
+} // namespace robot_plan
+#endif
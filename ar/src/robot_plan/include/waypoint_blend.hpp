@@ -0,0 +1,19 @@
+#ifndef ROBOT_PLAN_WAYPOINT_BLEND_HPP
+#define ROBOT_PLAN_WAYPOINT_BLEND_HPP
+#include <vector>
+
+// 通過するだけの目標点で止まらないように, 角を曲がる時の速さを決める
+namespace robot_plan {
+struct Waypoint {
+  double x, y;
+};
+
+// points[0]は今の位置, 最後の点では止まる. 戻り値は各点での速さ
+// 角ではblend_distanceの間に向きを変えられる速さまで落とし,
+// その後前後の点から加速度accel_maxで届く速さに抑える
+// 距離と速さの関係はS字加減速(平均の加速度がaccel_max / 2)に合わせる
+std::vector<double> blendVelocities(const std::vector<Waypoint> &points,
+                                    double velocity_first, double velocity_max,
+                                    double accel_max, double blend_distance);
+} // namespace robot_plan
+#endif
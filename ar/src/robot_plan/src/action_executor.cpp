@@ -0,0 +1,172 @@
+#include <action_executor.hpp>
+
+namespace motion_planner {
+ActionExecutor::ActionExecutor(int num_channel) : channels_(num_channel) {
+  for (Channel &channel : channels_) {
+    channel.thread = std::thread([this, &channel] { work(channel); });
+  }
+}
+
+// 実行中の指令は戻ってくるまで待つ(ROSの終了でサービスも戻る)
+ActionExecutor::~ActionExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    should_stop_ = true;
+  }
+  for (Channel &channel : channels_) {
+    channel.wake.notify_one();
+  }
+  for (Channel &channel : channels_) {
+    channel.thread.join();
+  }
+}
+
+void ActionExecutor::start(int channel, Task task, double timeout,
+                           Callback callback) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channels_[channel].queue.push_back(Job{task, timeout, callback, 0, 0});
+  }
+  channels_[channel].wake.notify_one();
+}
+
+void ActionExecutor::waitUntil(int channel, Task condition, double interval,
+                               int settle, double timeout, Callback callback) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channels_[channel].queue.push_back(
+        Job{condition, timeout, callback, interval, settle > 0 ? settle : 1});
+  }
+  channels_[channel].wake.notify_one();
+}
+
+void ActionExecutor::poll() {
+  results_.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Clock::time_point now = Clock::now();
+    // 時間切れにしても, スレッドは戻ってくるまで次の指令を始めない
+    for (Channel &channel : channels_) {
+      if (channel.status == ActionStatus::RUNNING && now > channel.deadline) {
+        channel.status = ActionStatus::TIMEOUT;
+        finished_.push_back(Result{channel.callback, channel.status, 0});
+      }
+    }
+    results_.swap(finished_);
+  }
+  for (const Result &result : results_) {
+    if (result.callback) {
+      result.callback(result.status, result.data);
+    }
+  }
+}
+
+void ActionExecutor::cancel() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Channel &channel : channels_) {
+      for (const Job &job : channel.queue) {
+        finished_.push_back(Result{job.callback, ActionStatus::CANCELED, 0});
+      }
+      bool is_canceled = !channel.queue.empty() ||
+                         channel.status == ActionStatus::RUNNING;
+      channel.queue.clear();
+      if (channel.status == ActionStatus::RUNNING) {
+        finished_.push_back(
+            Result{channel.callback, ActionStatus::CANCELED, 0});
+      }
+      // 前の指令のDONEが残っていると, 止まったと読み違える
+      if (is_canceled) {
+        channel.status = ActionStatus::CANCELED;
+        channel.data = 0;
+      }
+    }
+  }
+  for (Channel &channel : channels_) {
+    channel.wake.notify_one();
+  }
+}
+
+ActionStatus ActionExecutor::status(int channel) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return channels_[channel].status;
+}
+
+int ActionExecutor::data(int channel) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return channels_[channel].data;
+}
+
+bool ActionExecutor::idle(int channel) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !channels_[channel].is_running && channels_[channel].queue.empty();
+}
+
+void ActionExecutor::work(Channel &channel) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    channel.wake.wait(lock,
+                      [&] { return should_stop_ || !channel.queue.empty(); });
+    if (should_stop_) {
+      return;
+    }
+    Job job = channel.queue.front();
+    channel.queue.pop_front();
+    channel.is_running = true;
+    channel.deadline =
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(job.timeout));
+    channel.callback = job.callback;
+    channel.status = ActionStatus::RUNNING;
+    channel.data = 0;
+
+    int data = 0;
+    bool ok;
+    if (job.settle == 0) {
+      lock.unlock();
+      ok = job.task(data);
+      lock.lock();
+    } else if (!wait(channel, job, data, lock)) {
+      return;
+    } else {
+      ok = channel.status == ActionStatus::RUNNING;
+    }
+
+    channel.is_running = false;
+    // 時間切れか取り消しになった後に戻ってきた結果は使わない
+    if (channel.status == ActionStatus::RUNNING) {
+      channel.status = ok ? ActionStatus::DONE : ActionStatus::FAILED;
+      channel.data = data;
+      finished_.push_back(Result{channel.callback, channel.status, data});
+    }
+  }
+}
+
+// 指令の直後に読むと前の状態が返ることがあるので, 先にintervalだけ待つ
+// 止める時(should_stop_)はfalse, それ以外はtrue
+// 時間切れならchannel.statusがTIMEOUTになる. 取り消されたらすぐ戻る
+bool ActionExecutor::wait(Channel &channel, const Job &job, int &data,
+                          std::unique_lock<std::mutex> &lock) {
+  const auto interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(job.interval));
+  int count = 0;
+  while (channel.status == ActionStatus::RUNNING && count < job.settle) {
+    if (channel.wake.wait_for(lock, interval, [&] {
+          return should_stop_ || channel.status != ActionStatus::RUNNING;
+        })) {
+      return !should_stop_;
+    }
+    lock.unlock();
+    bool is_met = job.task(data);
+    lock.lock();
+    count = is_met ? count + 1 : 0;
+    // pollが呼ばれていなくても, 読み続けるのは時間切れまで
+    if (count < job.settle && channel.status == ActionStatus::RUNNING &&
+        Clock::now() > channel.deadline) {
+      channel.status = ActionStatus::TIMEOUT;
+      finished_.push_back(Result{channel.callback, channel.status, data});
+    }
+  }
+  return true;
+}
+} // namespace motion_planner
@@ -0,0 +1,85 @@
+#include <cmath>
+#include <goal_manager.hpp>
+
+namespace motion_planner {
+GoalManager::GoalManager(int coat) {
+  coat_reverse_ = coat;
+  restart();
+}
+
+void GoalManager::add(GoalInfo goal) {
+  goal.x = coat_reverse_ * goal.x;
+  goal.yaw = coat_reverse_ * goal.yaw;
+  map_.push_back(goal);
+}
+
+void GoalManager::add(int x, int y, int yaw, int accel, int action_type,
+                      int action_value, int velocity_x, int velocity_y) {
+  GoalInfo dummy_goal;
+  dummy_goal.x = coat_reverse_ * x;
+  dummy_goal.y = y;
+  dummy_goal.yaw = coat_reverse_ * yaw;
+  dummy_goal.action_type = action_type;
+  dummy_goal.action_value = action_value;
+  dummy_goal.velocity_x = velocity_x * coat_reverse_;
+  dummy_goal.velocity_y = velocity_y;
+  dummy_goal.accel = accel;
+  map_.push_back(dummy_goal);
+}
+
+void GoalManager::next() {
+  if (map_id_ + 1 < (int)map_.size()) {
+    ++map_id_;
+    now = map_.at(map_id_);
+  }
+}
+
+void GoalManager::restart() {
+  map_id_ = 0;
+  actions.restart();
+  if (map_.size() > 0) {
+    now = map_.at(map_id_);
+  }
+}
+
+void GoalManager::passWaypoints(std::vector<GoalInfo> &waypoints) const {
+  waypoints.clear();
+  for (int i = map_id_; i < (int)map_.size(); ++i) {
+    waypoints.push_back(map_[i]);
+    if (!isPassThrough(i)) {
+      break;
+    }
+  }
+}
+
+void GoalManager::appendMission(int map_type,
+                                std::vector<double> &mission) const {
+  for (int i = 0; i < (int)map_.size(); ++i) {
+    const GoalInfo &goal = map_[i];
+    mission.insert(mission.end(),
+                   {(double)map_type, (double)goal.x, (double)goal.y,
+                    goal.yaw / 180.0 * M_PI, (double)goal.accel,
+                    (double)goal.velocity_x, (double)goal.velocity_y,
+                    (double)isPassThrough(i)});
+  }
+}
+
+bool GoalManager::isPassThrough(int id) const {
+  if (id + 1 >= (int)map_.size()) {
+    return false;
+  }
+  const GoalInfo &next = map_[id + 1];
+  return (next.action_type == 0 || next.action_type == 1) &&
+         map_[id].velocity_x == 0 && map_[id].velocity_y == 0 &&
+         !actions.isStop(id);
+}
+
+bool reachGoal(double goal_x, double goal_y, double goal_theta,
+               double current_x, double current_y, double current_theta,
+               double error_distance, double error_angle) {
+  double diff_yaw = (goal_theta - current_theta) / M_PI * 180;
+  diff_yaw = diff_yaw - (int)diff_yaw / 180 * 360;
+  return std::hypot(goal_x - current_x, goal_y - current_y) < error_distance &&
+         std::fabs(diff_yaw) < error_angle;
+}
+} // namespace motion_planner
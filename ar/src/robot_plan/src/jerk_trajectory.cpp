@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cmath>
+#include <jerk_trajectory.hpp>
+
+// 速度計画はL. Biagiotti, C. Melchiorri "Trajectory Planning for Automatic
+// Machines and Robots" 3.4節の両端の速度付きダブルS字による
+namespace robot_plan {
+namespace {
+inline double pow2(double x) { return x * x; }
+constexpr int REDUCE_ITERATION = 500;
+constexpr double ACCEL_REDUCE = 0.99;
+constexpr int SOLVE_ITERATION = 20;
+constexpr double SOLVE_TOLERANCE = 1.0e-6;
+} // namespace
+
+void JerkProfile::set(double distance, double velocity_first,
+                      double velocity_final, const JerkLimit &limit) {
+  limit_ = limit;
+  distance_ = std::max(distance, 0.0);
+  velocity_first_ = std::min(std::max(velocity_first, 0.0), limit.velocity);
+  velocity_final_ = std::min(std::max(velocity_final, 0.0), limit.velocity);
+  if (distance_ <= 0) {
+    velocity_first_ = velocity_final_ = velocity_limit_ = 0;
+    jerk_accel_time_ = accel_time_ = jerk_decel_time_ = decel_time_ = 0;
+    const_time_ = total_time_ = 0;
+    accel_limit_ = decel_limit_ = 0;
+    jerk_ = limit.jerk;
+    return;
+  }
+
+  // 初速から終速に変えるのに必要な距離が足りるか
+  const double jerk = limit.jerk, accel = limit.accel;
+  const double velocity_change = std::fabs(velocity_final_ - velocity_first_);
+  double jerk_time = std::min(std::sqrt(velocity_change / jerk), accel / jerk);
+  bool is_feasible =
+      jerk_time < accel / jerk
+          ? distance_ > jerk_time * (velocity_first_ + velocity_final_)
+          : distance_ > (velocity_first_ + velocity_final_) / 2 *
+                            (jerk_time + velocity_change / accel);
+  if (!is_feasible) {
+    velocity_first_ = velocity_final_ =
+        std::min(velocity_first_, velocity_final_);
+  }
+
+  // 最高速度に届かない上に加速度も頭打ちにならない時は, 加速度の上限を下げて計画し直す
+  double accel_max = accel;
+  for (int i = 0; i < REDUCE_ITERATION && !plan(accel_max, jerk); ++i) {
+    accel_max *= ACCEL_REDUCE;
+  }
+}
+
+bool JerkProfile::plan(double accel_max, double jerk_max) {
+  const double h = distance_, v_0 = velocity_first_, v_1 = velocity_final_;
+  const double v_max = limit_.velocity;
+  jerk_ = jerk_max;
+  if ((v_max - v_0) * jerk_max < pow2(accel_max)) {
+    jerk_accel_time_ = std::sqrt((v_max - v_0) / jerk_max);
+    accel_time_ = 2 * jerk_accel_time_;
+  } else {
+    jerk_accel_time_ = accel_max / jerk_max;
+    accel_time_ = jerk_accel_time_ + (v_max - v_0) / accel_max;
+  }
+  if ((v_max - v_1) * jerk_max < pow2(accel_max)) {
+    jerk_decel_time_ = std::sqrt((v_max - v_1) / jerk_max);
+    decel_time_ = 2 * jerk_decel_time_;
+  } else {
+    jerk_decel_time_ = accel_max / jerk_max;
+    decel_time_ = jerk_decel_time_ + (v_max - v_1) / accel_max;
+  }
+  const_time_ = h / v_max - accel_time_ / 2 * (1 + v_0 / v_max) -
+                decel_time_ / 2 * (1 + v_1 / v_max);
+
+  bool is_done = true;
+  if (const_time_ <= 0) {
+    // 最高速度まで届かない
+    const_time_ = 0;
+    double jerk_time = accel_max / jerk_max;
+    jerk_accel_time_ = jerk_decel_time_ = jerk_time;
+    double delta = std::pow(accel_max, 4) / pow2(jerk_max) +
+                   2 * (pow2(v_0) + pow2(v_1)) +
+                   accel_max * (4 * h - 2 * accel_max / jerk_max * (v_0 + v_1));
+    accel_time_ =
+        (pow2(accel_max) / jerk_max - 2 * v_0 + std::sqrt(delta)) /
+        (2 * accel_max);
+    decel_time_ =
+        (pow2(accel_max) / jerk_max - 2 * v_1 + std::sqrt(delta)) /
+        (2 * accel_max);
+    if (accel_time_ < 0) {
+      // 減速だけ
+      accel_time_ = jerk_accel_time_ = 0;
+      decel_time_ = 2 * h / (v_1 + v_0);
+      jerk_decel_time_ =
+          (jerk_max * h -
+           std::sqrt(jerk_max * (jerk_max * pow2(h) +
+                                 pow2(v_1 + v_0) * (v_1 - v_0)))) /
+          (jerk_max * (v_1 + v_0));
+    } else if (decel_time_ < 0) {
+      // 加速だけ
+      decel_time_ = jerk_decel_time_ = 0;
+      accel_time_ = 2 * h / (v_1 + v_0);
+      jerk_accel_time_ =
+          (jerk_max * h -
+           std::sqrt(jerk_max * (jerk_max * pow2(h) -
+                                 pow2(v_1 + v_0) * (v_1 - v_0)))) /
+          (jerk_max * (v_1 + v_0));
+    } else if (accel_time_ < 2 * jerk_time || decel_time_ < 2 * jerk_time) {
+      is_done = false;
+    }
+  }
+  accel_limit_ = jerk_max * jerk_accel_time_;
+  decel_limit_ = -jerk_max * jerk_decel_time_;
+  velocity_limit_ = v_0 + (accel_time_ - jerk_accel_time_) * accel_limit_;
+  total_time_ = accel_time_ + const_time_ + decel_time_;
+  return is_done;
+}
+
+double JerkProfile::positionIn(double t) const {
+  const double v_0 = velocity_first_, v_1 = velocity_final_;
+  const double v_lim = velocity_limit_, j = jerk_, T = total_time_;
+  const double T_a = accel_time_, T_j1 = jerk_accel_time_;
+  const double T_d = decel_time_, T_j2 = jerk_decel_time_;
+  if (t < T_j1) {
+    return v_0 * t + j * std::pow(t, 3) / 6;
+  } else if (t < T_a - T_j1) {
+    return v_0 * t +
+           accel_limit_ / 6 * (3 * pow2(t) - 3 * T_j1 * t + pow2(T_j1));
+  } else if (t < T_a) {
+    return (v_lim + v_0) * T_a / 2 - v_lim * (T_a - t) +
+           j * std::pow(T_a - t, 3) / 6;
+  } else if (t < T - T_d) {
+    return (v_lim + v_0) * T_a / 2 + v_lim * (t - T_a);
+  }
+  const double tau = t - T + T_d;
+  const double decel_start = distance_ - (v_lim + v_1) * T_d / 2;
+  if (tau < T_j2) {
+    return decel_start + v_lim * tau - j * std::pow(tau, 3) / 6;
+  } else if (t < T - T_j2) {
+    return decel_start + v_lim * tau +
+           decel_limit_ / 6 * (3 * pow2(tau) - 3 * T_j2 * tau + pow2(T_j2));
+  }
+  return distance_ - v_1 * (T - t) - j * std::pow(T - t, 3) / 6;
+}
+
+double JerkProfile::position(double time) const {
+  if (time <= 0) {
+    return 0;
+  } else if (time >= total_time_) {
+    return distance_;
+  }
+  return positionIn(time);
+}
+
+double JerkProfile::velocity(double t) const {
+  const double j = jerk_, T = total_time_;
+  const double T_a = accel_time_, T_j1 = jerk_accel_time_;
+  const double T_d = decel_time_, T_j2 = jerk_decel_time_;
+  if (t <= 0) {
+    return velocity_first_;
+  } else if (t >= T) {
+    return velocity_final_;
+  } else if (t < T_j1) {
+    return velocity_first_ + j * pow2(t) / 2;
+  } else if (t < T_a - T_j1) {
+    return velocity_first_ + accel_limit_ * (t - T_j1 / 2);
+  } else if (t < T_a) {
+    return velocity_limit_ - j * pow2(T_a - t) / 2;
+  } else if (t < T - T_d) {
+    return velocity_limit_;
+  }
+  const double tau = t - T + T_d;
+  if (tau < T_j2) {
+    return velocity_limit_ - j * pow2(tau) / 2;
+  } else if (t < T - T_j2) {
+    return velocity_limit_ + decel_limit_ * (tau - T_j2 / 2);
+  }
+  return velocity_final_ + j * pow2(T - t) / 2;
+}
+
+double JerkProfile::acceleration(double t) const {
+  const double j = jerk_, T = total_time_;
+  const double T_a = accel_time_, T_j1 = jerk_accel_time_;
+  const double T_d = decel_time_, T_j2 = jerk_decel_time_;
+  if (t <= 0 || t >= T) {
+    return 0;
+  } else if (t < T_j1) {
+    return j * t;
+  } else if (t < T_a - T_j1) {
+    return accel_limit_;
+  } else if (t < T_a) {
+    return j * (T_a - t);
+  } else if (t < T - T_d) {
+    return 0;
+  }
+  const double tau = t - T + T_d;
+  if (tau < T_j2) {
+    return -j * tau;
+  } else if (t < T - T_j2) {
+    return decel_limit_;
+  }
+  return -j * (T - t);
+}
+
+double JerkProfile::timeAt(double position) const {
+  if (total_time_ <= 0 || position <= 0) {
+    return 0;
+  } else if (position >= distance_) {
+    return total_time_;
+  }
+  // 7区間の境目の位置と比べて区間を絞り, その中で挟み込みながらニュートン法
+  const double T = total_time_;
+  const double BOUNDARY[8] = {0,
+                              jerk_accel_time_,
+                              accel_time_ - jerk_accel_time_,
+                              accel_time_,
+                              T - decel_time_,
+                              T - decel_time_ + jerk_decel_time_,
+                              T - jerk_decel_time_,
+                              T};
+  double time_min = 0, time_max = T;
+  for (int i = 1; i < 8; ++i) {
+    if (BOUNDARY[i] > BOUNDARY[i - 1] && position < this->position(BOUNDARY[i])) {
+      time_min = BOUNDARY[i - 1];
+      time_max = BOUNDARY[i];
+      break;
+    }
+  }
+  double position_min = this->position(time_min);
+  double position_max = this->position(time_max);
+  double time = position_max > position_min
+                    ? time_min + (time_max - time_min) *
+                                     (position - position_min) /
+                                     (position_max - position_min)
+                    : time_min;
+  for (int i = 0; i < SOLVE_ITERATION; ++i) {
+    double error = this->position(time) - position;
+    if (std::fabs(error) < SOLVE_TOLERANCE) {
+      break;
+    }
+    if (error > 0) {
+      time_max = time;
+    } else {
+      time_min = time;
+    }
+    double v = velocity(time);
+    double next = v > 0 ? time - error / v : time_min - 1;
+    time = time_min < next && next < time_max ? next : (time_min + time_max) / 2;
+  }
+  return time;
+}
+
+void Trajectory2D::set(double x0, double y0, double theta0, double x1,
+                       double y1, double theta1, double velocity_first,
+                       double velocity_final, const JerkLimit &limit,
+                       double omega_max) {
+  double distance = std::hypot(x1 - x0, y1 - y0);
+  if (distance <= 0) {
+    // その場での回転は計画しない
+    stay(x0, y0, theta1);
+    return;
+  }
+  x0_ = x0;
+  y0_ = y0;
+  theta0_ = theta0;
+  unit_x_ = (x1 - x0) / distance;
+  unit_y_ = (y1 - y0) / distance;
+  double yaw = std::remainder(theta1 - theta0, 2 * M_PI);
+  yaw_per_distance_ = yaw / distance;
+  JerkLimit linear = limit;
+  if (omega_max > 0 && yaw_per_distance_ != 0) {
+    linear.velocity =
+        std::min(linear.velocity, omega_max / std::fabs(yaw_per_distance_));
+  }
+  profile_.set(distance, velocity_first, velocity_final, linear);
+}
+
+void Trajectory2D::stay(double x, double y, double theta) {
+  x0_ = x;
+  y0_ = y;
+  theta0_ = theta;
+  unit_x_ = 1;
+  unit_y_ = 0;
+  yaw_per_distance_ = 0;
+  profile_.set(0, 0, 0, JerkLimit{1, 1, 1});
+}
+
+TrajectoryPoint Trajectory2D::at(double time) const {
+  double s = profile_.position(time), v = profile_.velocity(time),
+         a = profile_.acceleration(time);
+  TrajectoryPoint point;
+  point.x = x0_ + unit_x_ * s;
+  point.y = y0_ + unit_y_ * s;
+  point.theta = theta0_ + yaw_per_distance_ * s;
+  point.vx = unit_x_ * v;
+  point.vy = unit_y_ * v;
+  point.omega = yaw_per_distance_ * v;
+  point.ax = unit_x_ * a;
+  point.ay = unit_y_ * a;
+  return point;
+}
+
+double Trajectory2D::timeAt(double x, double y) const {
+  return profile_.timeAt((x - x0_) * unit_x_ + (y - y0_) * unit_y_);
+}
+} // namespace robot_plan
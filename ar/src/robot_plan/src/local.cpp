@@ -1,25 +1,30 @@
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <geometry_msgs/Pose2D.h>
+#include <geometry_msgs/PoseArray.h>
 #include <geometry_msgs/Twist.h>
+#include <latest_value.hpp>
+#include <mpc_tracker.hpp>
+#include <periodic_timer.hpp>
 #include <pid.hpp>
+#include <planner.hpp>
+#include <ros/callback_queue.h>
 #include <ros/ros.h>
+#include <segment_planner.hpp>
 #include <std_msgs/Bool.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <std_msgs/Int32.h>
 #include <std_msgs/String.h>
 #include <vector>
 
-inline double pow2(double x) { return x * x; }
-double abs(double a) { return fabs(a); }
-
-struct AccelMap {
-  double position;
-  double velocity;
-};
-
+namespace local_planner {
 class SVelocity {
 
 public:
-  SVelocity(ros::NodeHandle *n, const std::string username, int user_rate) {
+  // 自己位置だけはpose_nのキューで, 制御とは別のスレッドから受け取る
+  SVelocity(ros::NodeHandle *n, ros::NodeHandle *pose_n,
+            const std::string username, double user_rate) {
     velocity_pub =
         n->advertise<geometry_msgs::Twist>(username + "/velocity", 1);
     goal_point_sub = n->subscribe(username + "/goal_point", 1,
@@ -30,9 +35,16 @@ public:
         n->subscribe(username + "/accel_max", 1, &SVelocity::changeAccel, this);
     emergency_stop_sub = n->subscribe(username + "/emergency_stop", 1,
                                       &SVelocity::checkEmergency, this);
+    waypoints_sub = n->subscribe(username + "/waypoints", 1,
+                                 &SVelocity::getWaypoints, this);
+    mission_sub =
+        n->subscribe(username + "/mission", 1, &SVelocity::getMission, this);
+    // 毎周期 計算時間[us], 反復回数, 制約の破れ(mpcの時だけ)
+    tracker_stats_pub = n->advertise<std_msgs::Float64MultiArray>(
+        username + "/tracker_stats", 1);
     robot_pose_sub =
-        n->subscribe("robot_pose", 1, &SVelocity::getRobotPose, this);
-    rate = user_rate * MAP_SCOPE;
+        pose_n->subscribe("robot_pose", 1, &SVelocity::getRobotPose, this);
+    period = 1.0 / user_rate;
     int start_x, start_y;
     // コート情報の取得
     std::string coat_color;
@@ -47,24 +59,65 @@ public:
     }
     n->getParam("/ar/start_x", start_x);
     n->getParam("/ar/start_y", start_y);
-    AccelMap dummy;
-    goal_point.x = dummy.position = coat * start_x;
-    dummy.velocity = 0;
-    velocity_map[0].push_back(dummy);
-    goal_point.y = dummy.position = start_y;
-    dummy.velocity = 0;
-    velocity_map[1].push_back(dummy);
-    for (int i = 0; i < 2; ++i) {
-      map_id_max[i] = velocity_map[i].size();
+    goal_point.x = coat * start_x;
+    goal_point.y = start_y;
+
+    // s_curve: 軸ごとのS字加減速, jerk: 2軸とyawをまとめた躍度制限付きの軌道
+    robot_plan::PlannerConfig &config = planner.config;
+    std::string mode;
+    n->param<std::string>("/ar/local_planner_mode", mode, "s_curve");
+    config.is_jerk_mode = mode == "jerk";
+    n->param("/ar/jerk_max", config.jerk_max, config.jerk_max);
+    n->param("/ar/omega_max", config.omega_max, config.omega_max);
+    n->param("/ar/blend_distance", config.blend_distance,
+             config.blend_distance);
+    n->param("/ar/trajectory_cache_tolerance", config.cache_distance,
+             config.cache_distance);
+    n->param("/ar/goal_reach_distance", config.reach_distance,
+             config.reach_distance);
+
+    // follow: 軌道の速度 + ROOT_FOLLOW * 位置のずれ, mpc: MpcTracker
+    std::string tracker_mode;
+    n->param<std::string>("/ar/local_tracker", tracker_mode, "follow");
+    use_mpc = tracker_mode == "mpc";
+    robot_plan::MpcConfig mpc_config;
+    n->param("/ar/mpc_horizon", mpc_config.horizon, mpc_config.horizon);
+    n->param("/ar/mpc_step", mpc_config.step, mpc_config.step);
+    n->param("/ar/mpc_motor_lag", mpc_config.motor_lag, mpc_config.motor_lag);
+    n->param("/ar/mpc_wheel_velocity_max", mpc_config.wheel_velocity_max,
+             mpc_config.wheel_velocity_max);
+    n->param("/ar/mpc_accel_max", mpc_config.accel_max, mpc_config.accel_max);
+    n->param("/ar/mpc_omega_max", mpc_config.omega_max, mpc_config.omega_max);
+    n->param("/ar/mpc_time_budget", mpc_config.time_budget,
+             mpc_config.time_budget);
+    tracker = robot_plan::MpcTracker(mpc_config);
+    mpc_reference.resize(mpc_config.horizon);
+    tracker_stats.data.resize(3);
+
+    // yawを出力しない時(MAX_MOMENT, /ar/mpc_omega_maxが0)は, jerkの軌道も
+    // 回らないyawの角速度のために直線の速度を下げないようにする
+    bool is_yaw_disabled =
+        use_mpc ? mpc_config.omega_max <= 0 : MAX_MOMENT <= 0;
+    if (is_yaw_disabled && config.omega_max > 0) {
+      ROS_INFO_STREAM("Yaw output is disabled, ignore /ar/omega_max");
+      config.omega_max = 0;
     }
+    follower.stay(toPose(goal_point), config.is_jerk_mode);
   }
 
   void getGoalPoint(const geometry_msgs::Pose2D &msg) {
+    current_point = robot_pose.read();
     goal_point = msg;
     setParam();
   }
   void getGoalVelocity(const geometry_msgs::Twist &msg) { goal_velocity = msg; }
-  void getRobotPose(const geometry_msgs::Pose2D &msg) { current_point = msg; }
+  void getRobotPose(const geometry_msgs::Pose2D &msg) { robot_pose.write(msg); }
+  void getWaypoints(const geometry_msgs::PoseArray &msg) {
+    waypoints.clear();
+    for (const geometry_msgs::Pose &pose : msg.poses) {
+      waypoints.push_back({pose.position.x, pose.position.y});
+    }
+  }
   /* void getRobotPose(const geometry_msgs::Pose &msgs) { */
   /* current_point.x = msgs.position.x; */
   /* current_point.y = msgs.position.y; */
@@ -77,63 +130,29 @@ public:
   }
 
   void control() {
+    current_point = robot_pose.read();
     if (should_stop_emergency) {
       send_twist.linear.x = send_twist.linear.y = send_twist.angular.z = 0;
       send_twist.angular.y = -1;
+      tracker.reset();
+    } else if (use_mpc) {
+      controlMpc();
     } else {
       send_twist.angular.y = WHEEL_DEBUG_MODE;
-      for (int i = 0; i < 2; ++i) {
-        int search_id_min = map_id[i] - MAP_SEARCH_RANGE;
-        int search_id_max = map_id[i] + MAP_SEARCH_RANGE;
-        if (search_id_min < 0) {
-          search_id_min = 0;
-        }
-        if (search_id_max > map_id_max[i]) {
-          search_id_max = map_id_max[i];
-        }
+      robot_plan::TrajectoryPoint point =
+          follower.follow(toPose(current_point), period);
+      send_twist.linear.x = point.vx + ROOT_FOLLOW * (point.x - current_point.x);
+      send_twist.linear.y = point.vy + ROOT_FOLLOW * (point.y - current_point.y);
+      double goal_theta = point.theta;
 
-        double dummy_current_point;
-        if (i == 0) {
-          dummy_current_point = current_point.x;
-        } else {
-          dummy_current_point = current_point.y;
-        }
-        int shortest_distance = INT_MAX;
-        double dummy_velocity;
-        for (int j = search_id_min; j < search_id_max; ++j) {
-          if (shortest_distance >
-              abs((dummy_current_point - velocity_map[i].at(j).position))) {
-            shortest_distance =
-                abs(dummy_current_point - velocity_map[i].at(j).position);
-            map_id[i] = j;
-          }
-        }
-        map_id[i] += MAP_SCOPE;
-        if (map_id[i] >= map_id_max[i] - 1) {
-          map_id[i] = map_id_max[i] - 1;
-        }
-        dummy_velocity = velocity_map[i].at(map_id[i]).velocity;
-        if (i == 0) {
-          send_twist.linear.x =
-              dummy_velocity +
-              ROOT_FOLLOW *
-                  (velocity_map[i].at(map_id[i]).position - current_point.x);
-        } else {
-          send_twist.linear.y =
-              dummy_velocity +
-              ROOT_FOLLOW *
-                  (velocity_map[i].at(map_id[i]).position - current_point.y);
-        }
-      }
-
-      if (goal_point.theta - current_point.theta > M_PI) {
-        goal_point.theta -= 2 * M_PI;
-      } else if (goal_point.theta - current_point.theta < -M_PI) {
-        goal_point.theta += 2 * M_PI;
+      if (goal_theta - current_point.theta > M_PI) {
+        goal_theta -= 2 * M_PI;
+      } else if (goal_theta - current_point.theta < -M_PI) {
+        goal_theta += 2 * M_PI;
       }
 
       send_twist.angular.y = WHEEL_DEBUG_MODE;
-      send_twist.angular.z = moment.control(goal_point.theta * 180 / M_PI,
+      send_twist.angular.z = moment.control(goal_theta * 180 / M_PI,
                                             current_point.theta * 180 / M_PI);
       if (send_twist.angular.z > MAX_MOMENT) {
         send_twist.angular.z = MAX_MOMENT;
@@ -145,133 +164,65 @@ public:
     velocity_pub.publish(send_twist);
   }
 
+  // 1周期先の点を決めてから, その先horizon段分の軌道を目標にする
+  // yawもMpcTrackerが決める(/ar/mpc_omega_maxが0なら回さない)
+  void controlMpc() {
+    robot_plan::Pose current = toPose(current_point);
+    follower.follow(current, period);
+    const robot_plan::MpcConfig &config = tracker.config();
+    for (int k = 0; k < config.horizon; ++k) {
+      mpc_reference[k] = follower.preview((k + 1) * config.step - period);
+    }
+    const robot_plan::MpcResult &result =
+        tracker.solve(current, mpc_reference, period);
+    send_twist.angular.y = WHEEL_DEBUG_MODE;
+    send_twist.linear.x = result.velocity[0];
+    send_twist.linear.y = result.velocity[1];
+    send_twist.angular.z = result.velocity[2];
+
+    tracker_stats.data[0] = result.solve_time * 1.0e+6;
+    tracker_stats.data[1] = result.iterations;
+    tracker_stats.data[2] = result.residual;
+    tracker_stats_pub.publish(tracker_stats);
+  }
+
+  // 目標点を受け取った時に呼ぶ. 起動時に作っておいた区間があればそれを使う
   void setParam() {
-    double dummy_distance =
-        hypot(goal_point.x - current_point.x, goal_point.y - current_point.y);
-    double angle =
-        atan2(goal_point.y - current_point.y, goal_point.x - current_point.x);
-    double dummy_goal_velocity =
-        hypot(goal_velocity.linear.x, goal_velocity.linear.y);
+    robot_plan::Segment segment;
+    segment.start = toPose(current_point);
+    segment.goal = toPose(goal_point);
+    segment.velocity_prev[0] = velocity_final_prev[0];
+    segment.velocity_prev[1] = velocity_final_prev[1];
+    segment.velocity_final[0] = goal_velocity.linear.x;
+    segment.velocity_final[1] = goal_velocity.linear.y;
+    segment.accel = ACCEL_MAX;
+    planner.blend(segment, waypoints);
 
-    double dummy_velocity_max =
-        sqrt((pow2(VELOCITY_MIN) + pow2(dummy_goal_velocity) +
-              ACCEL_MAX * dummy_distance) /
-             2);
-    if (dummy_velocity_max > VELOCITY_MAX) {
-      dummy_velocity_max = VELOCITY_MAX;
-    }
-    double velocity_max[2] = {dummy_velocity_max * cos(angle),
-                              dummy_velocity_max * sin(angle)};
-    double velocity_first[2] = {VELOCITY_MIN * cos(angle),
-                                VELOCITY_MIN * sin(angle)};
-    double velocity_final[2] = {goal_velocity.linear.x, goal_velocity.linear.y};
-    for (int i = 0; i < 2; ++i) {
-      if (velocity_first[i] > 0 && velocity_first[i] < velocity_final_prev[i]) {
-        velocity_first[i] = velocity_final_prev[i];
-      } else if (velocity_first[i] < 0 &&
-                 velocity_first[i] > velocity_final_prev[i]) {
-        velocity_first[i] = velocity_final_prev[i];
-      }
-      velocity_final_prev[i] = velocity_final[i];
+    const robot_plan::Segment *cached = planner.find(segment);
+    if (cached != nullptr) {
+      segment = *cached;
+    } else {
+      planner.plan(segment);
     }
-    double accel_max[2] = {ACCEL_MAX * cos(angle), ACCEL_MAX * sin(angle)};
-
-    double distance[2] = {dummy_distance * abs(cos(angle)),
-                          dummy_distance * abs(sin(angle))};
-    double accel_time[2] = {}, const_time[2] = {}, decel_time[2] = {};
-    for (int i = 0; i < 2; ++i) {
-      if (distance[i] > ERROR_DISTANCE_MAX) {
-        accel_time[i] =
-            2 * abs((velocity_max[i] - velocity_first[i]) / accel_max[i]);
-        const_time[i] = (abs(distance[i]) -
-                         (2 * pow2(velocity_max[i]) -
-                          (pow2(velocity_first[i]) + pow2(velocity_final[i]))) /
-                             abs(accel_max[i])) /
-                            abs(velocity_max[i]) +
-                        accel_time[i];
-        decel_time[i] =
-            2 * abs((velocity_max[i] - velocity_final[i]) / accel_max[i]) +
-            const_time[i];
-      } else {
-        accel_max[i] = const_time[i] = decel_time[i] = 0;
-      }
+    ROS_DEBUG_STREAM("Segment: (" << segment.start.x << ", " << segment.start.y
+                                  << ") -> (" << segment.goal.x << ", "
+                                  << segment.goal.y << "), "
+                                  << (cached != nullptr ? "cached" : "planned"));
 
-      start_point = current_point;
-      double delta_t = 1.0 / rate;
-      double dummy_start;
-      if (i == 0) {
-        dummy_start = start_point.x;
-      } else {
-        dummy_start = start_point.y;
-      }
-      velocity_map[i].resize(0);
+    velocity_final_prev[0] = segment.velocity_final[0];
+    velocity_final_prev[1] = segment.velocity_final[1];
+    follower.set(segment, planner.config.is_jerk_mode);
+  }
 
-      if (distance[i] > ERROR_DISTANCE_MAX) {
-        for (int j = 0; j * delta_t <= decel_time[i]; ++j) {
-          double time = j * delta_t;
-          AccelMap data;
-          if (time < accel_time[i]) {
-            data.position =
-                accel_max[i] * pow2(accel_time[i]) / (8 * pow2(M_PI)) *
-                    (cos(2 * M_PI / accel_time[i] * time) - 1) +
-                accel_max[i] * pow2(time) / 4 + velocity_first[i] * time;
-            data.velocity = -accel_max[i] * accel_time[i] / (4 * M_PI) *
-                                sin(2 * M_PI / accel_time[i] * time) +
-                            accel_max[i] * time / 2 + velocity_first[i];
-          } else if (time < const_time[i]) {
-            time -= accel_time[i];
-            data.position =
-                velocity_max[i] * time +
-                pow2(velocity_max[i] - velocity_first[i]) / accel_max[i] +
-                2 * velocity_first[i] * (velocity_max[i] - velocity_first[i]) /
-                    accel_max[i];
-            data.velocity = velocity_max[i];
-          } else {
-            time -= const_time[i];
-            data.position =
-                -accel_max[i] * pow2(decel_time[i] - const_time[i]) /
-                    (8 * pow2(M_PI)) *
-                    (cos(2 * M_PI / (decel_time[i] - const_time[i]) * time) -
-                     1) -
-                accel_max[i] * pow2(time) / 4 + velocity_max[i] * time +
-                velocity_max[i] * (const_time[i] - accel_time[i]) +
-                pow2(velocity_max[i] - velocity_first[i]) / accel_max[i] +
-                2 * velocity_first[i] * (velocity_max[i] - velocity_first[i]) /
-                    accel_max[i];
-            data.velocity =
-                accel_max[i] * (decel_time[i] - const_time[i]) / (4 * M_PI) *
-                    sin(2 * M_PI / (decel_time[i] - const_time[i]) * time) -
-                accel_max[i] * time / 2 + velocity_max[i];
-          }
-          data.position += dummy_start;
-          velocity_map[i].push_back(data);
-        }
-      } else {
-        AccelMap data;
-        data.position = 0;
-        data.velocity = 0;
-        data.position += dummy_start;
-        velocity_map[i].push_back(data);
-      }
-      map_id[i] = 0;
-      map_id_max[i] = velocity_map[i].size();
+  // motion_plannerの全経路を受け取り, 予定通りに進んだ時の区間を先に計算しておく
+  void getMission(const std_msgs::Float64MultiArray &msg) {
+    planner.precompute(msg.data);
+    ROS_INFO_STREAM("Trajectory Cache: " << planner.cacheSize()
+                                         << " segments");
+  }
 
-      // Debug
-      ROS_INFO_STREAM("Axis Num: " << i);
-      ROS_INFO_STREAM("SVelocity Parameter: "
-                      << "v_0 = " << velocity_first[i] << ", "
-                      << "v_m = " << velocity_max[i] << ", "
-                      << "v_f = " << velocity_final[i] << ", "
-                      << "x = " << distance[i] << ", "
-                      << "a_m = " << accel_max[i]);
-      ROS_INFO_STREAM("Accel Time: " << accel_time[i] << ", " << const_time[i]
-                                     << ", " << decel_time[i]);
-      for (int j = 0; j < map_id_max[i]; ++j) {
-        AccelMap data = velocity_map[i].at(j);
-        ROS_INFO_STREAM(delta_t * j << ", " << data.position << ", "
-                                    << data.velocity);
-      }
-    }
+  static robot_plan::Pose toPose(const geometry_msgs::Pose2D &pose) {
+    return robot_plan::Pose{pose.x, pose.y, pose.theta};
   }
 
   ~SVelocity() {
@@ -280,21 +231,23 @@ public:
   }
 
 private:
-  int rate = 0;
-  geometry_msgs::Pose2D current_point = {}, goal_point = {}, start_point = {};
+  double period = 0; // controlを呼ぶ周期[s]
+  geometry_msgs::Pose2D current_point = {}, goal_point = {};
+  robot_plan::LatestValue<geometry_msgs::Pose2D> robot_pose;
   ros::Subscriber goal_point_sub, robot_pose_sub, goal_velocity_sub,
-      accel_max_sub, emergency_stop_sub;
-  ros::Publisher velocity_pub;
+      accel_max_sub, emergency_stop_sub, waypoints_sub, mission_sub;
+  ros::Publisher velocity_pub, tracker_stats_pub;
   geometry_msgs::Twist send_twist, goal_velocity;
   double velocity_final_prev[2] = {};
-  constexpr static double ERROR_DISTANCE_MAX = 50, ERROR_ANGLE_MAX = 1.0;
-  constexpr static double VELOCITY_MIN = 400, VELOCITY_MAX = 3000;
   double ACCEL_MAX = 500;
   constexpr static double ROOT_FOLLOW = 1.7;
-  std::vector<AccelMap> velocity_map[2];
-  constexpr static int MAP_SCOPE = 1, MAP_SEARCH_RANGE = 5 * MAP_SCOPE;
-  int map_id[2] = {};
-  int map_id_max[2] = {};
+  robot_plan::SegmentPlanner planner;
+  robot_plan::SegmentFollower follower;
+  bool use_mpc = false;
+  robot_plan::MpcTracker tracker;
+  std::vector<robot_plan::TrajectoryPoint> mpc_reference;
+  std_msgs::Float64MultiArray tracker_stats;
+  std::vector<robot_plan::Waypoint> waypoints; // 次の目標点から止まる点まで
   bool should_stop_emergency = false;
 
   /* arrc::PidVelocity moment{12, 0, 0}; */
@@ -304,17 +257,53 @@ private:
   constexpr static int WHEEL_DEBUG_MODE = 0;
 };
 
-int main(int argc, char **argv) {
-  ros::init(argc, argv, "local_planner");
-  ros::NodeHandle n;
+// local_plannerの制御ループ. runningがfalseになるかROSが終了するまで回る
+// 目標点などは自分のキューで周期の頭に, 自己位置は別のスレッドで受け取る
+void run(ros::NodeHandle &n, const std::atomic<bool> &running) {
+  ros::NodeHandle nh(n), pose_nh(n);
+  ros::CallbackQueue queue, pose_queue;
+  nh.setCallbackQueue(&queue);
+  pose_nh.setCallbackQueue(&pose_queue);
 
-  constexpr int FREQ = 15;
-  SVelocity controller(&n, "wheel", FREQ);
+  // 自己位置(50Hz)より速く回して, 届いた位置をすぐ次の指令に使う
+  double rate = 100;
+  int priority = 0;
+  nh.param("/ar/control_rate", rate, rate);
+  nh.param("/ar/control_priority", priority, priority);
+  SVelocity controller(&nh, &pose_nh, "wheel", rate);
+  // 1秒ごとに 周期数, 間に合わなかった回数, ジッタ平均, 最大, 処理時間平均, 最大[us]
+  ros::Publisher loop_stats_pub =
+      nh.advertise<std_msgs::Float64MultiArray>("wheel/loop_stats", 1);
+
+  // 自己位置は別のスレッドで受け取り, 制御のスレッドはロックを取らずに読む
+  ros::AsyncSpinner pose_spinner(1, &pose_queue);
+  pose_spinner.start();
+  if (priority > 0 && !robot_plan::setRealtimePriority(priority)) {
+    ROS_WARN_STREAM("local_planner: cannot use SCHED_FIFO " << priority);
+  }
 
-  ros::Rate loop_rate(FREQ);
-  while (ros::ok()) {
-    ros::spinOnce();
+  robot_plan::PeriodicTimer timer(rate);
+  // /use_sim_timeの時(wheel_simulator)はシミュレーションの時間で回す
+  bool is_sim_time = ros::Time::isSimTime();
+  ros::Rate sim_rate(rate);
+  while (ros::ok() && running) {
+    queue.callAvailable();
     controller.control();
-    loop_rate.sleep();
+    const robot_plan::LoopStats &stats = timer.stats();
+    if (stats.cycles >= rate) {
+      std_msgs::Float64MultiArray msg;
+      msg.data = {(double)stats.cycles, (double)stats.overruns,
+                  stats.jitter_mean * 1.0e+6, stats.jitter_max * 1.0e+6,
+                  stats.exec_mean * 1.0e+6,   stats.exec_max * 1.0e+6};
+      loop_stats_pub.publish(msg);
+      timer.resetStats();
+    }
+    if (is_sim_time) {
+      sim_rate.sleep();
+    } else {
+      timer.wait();
+    }
   }
+  pose_spinner.stop();
 }
+} // namespace local_planner
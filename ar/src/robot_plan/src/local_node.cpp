@@ -0,0 +1,10 @@
+#include <atomic>
+#include <planner.hpp>
+#include <ros/ros.h>
+
+int main(int argc, char **argv) {
+  ros::init(argc, argv, "local_planner");
+  ros::NodeHandle n;
+  std::atomic<bool> running(true);
+  local_planner::run(n, running);
+}
@@ -0,0 +1,87 @@
+#include <mission_graph.hpp>
+
+namespace motion_planner {
+constexpr double MissionGraph::ON_DEPART;
+
+int MissionGraph::add(int action_type, int action_value, int goal,
+                      double distance_to_go, const std::vector<int> &depends,
+                      bool is_blocking) {
+  // まだ足していない動作を書くとat()が投げる
+  for (int id : depends) {
+    states_.at(id);
+  }
+  actions_.push_back(MissionAction{action_type, action_value, goal,
+                                   distance_to_go, depends, is_blocking});
+  states_.push_back(ActionState::WAITING);
+  return size() - 1;
+}
+
+void MissionGraph::waitAt(int goal, const std::vector<int> &actions) {
+  for (int id : actions) {
+    states_.at(id);
+  }
+  waits_.push_back(Wait{goal, actions});
+}
+
+void MissionGraph::restart() {
+  for (ActionState &state : states_) {
+    state = ActionState::WAITING;
+  }
+}
+
+void MissionGraph::update(int goal, double distance_to_go,
+                          std::vector<int> &started) {
+  started.clear();
+  for (int id = 0; id < size(); ++id) {
+    const MissionAction &action = actions_[id];
+    bool is_triggered =
+        goal > action.goal ||
+        (goal == action.goal && distance_to_go <= action.distance_to_go);
+    if (states_[id] == ActionState::WAITING && is_triggered &&
+        isDone(action.depends)) {
+      states_[id] = ActionState::RUNNING;
+      started.push_back(id);
+    }
+  }
+}
+
+void MissionGraph::finish(int id) { states_[id] = ActionState::DONE; }
+
+bool MissionGraph::canLeave(int goal) const {
+  for (int id = 0; id < size(); ++id) {
+    if (actions_[id].goal == goal && actions_[id].is_blocking &&
+        states_[id] != ActionState::DONE) {
+      return false;
+    }
+  }
+  for (const Wait &wait : waits_) {
+    if (wait.goal == goal && !isDone(wait.actions)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MissionGraph::isStop(int goal) const {
+  for (const MissionAction &action : actions_) {
+    if (action.goal == goal && action.is_blocking) {
+      return true;
+    }
+  }
+  for (const Wait &wait : waits_) {
+    if (wait.goal == goal) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MissionGraph::isDone(const std::vector<int> &ids) const {
+  for (int id : ids) {
+    if (states_[id] != ActionState::DONE) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace motion_planner
@@ -1,18 +1,26 @@
+#include <action_executor.hpp>
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
 #include <geometry_msgs/Pose.h>
 #include <geometry_msgs/Pose2D.h>
+#include <geometry_msgs/PoseArray.h>
 #include <geometry_msgs/Twist.h>
+#include <goal_manager.hpp>
+#include <motor_serial/motor_commands.h>
 #include <motor_serial/motor_serial.h>
 #include <pigpiod.hpp>
+#include <planner.hpp>
+#include <ros/callback_queue.h>
 #include <ros/ros.h>
 #include <sstream>
 #include <std_msgs/Bool.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <std_msgs/Int32.h>
 #include <std_msgs/String.h>
 #include <vector>
 
-double abs(double a) { return fabs(a); }
-
+namespace motion_planner {
 class Ptp {
 public:
   Ptp(ros::NodeHandle *n, const std::string usename) {
@@ -23,6 +31,10 @@ public:
     accel_max_pub = n->advertise<std_msgs::Int32>(usename + "/accel_max", 1);
     emergency_stop_pub =
         n->advertise<std_msgs::Bool>(usename + "/emergency_stop", 1);
+    waypoints_pub =
+        n->advertise<geometry_msgs::PoseArray>(usename + "/waypoints", 1);
+    mission_pub = n->advertise<std_msgs::Float64MultiArray>(
+        usename + "/mission", 1, true);
     robot_pose_sub = n->subscribe("robot_pose", 1, &Ptp::getRobotPose, this);
   }
 
@@ -36,21 +48,21 @@ public:
 
   bool should_stop_emergency = false;
   bool checkReachGoal(double error_distance, double error_angle) {
-    double diff_yaw = (goal_point.theta - current_point.theta) / M_PI * 180;
-    diff_yaw = diff_yaw - (int)diff_yaw / 180 * 360;
     /* ROS_INFO_STREAM("x:" << goal_point.x << ", " << current_point.x << ", "
      */
     /*                      << goal_point.y << ", " << current_point.y << ",
      * yaw: " */
     /*                      << goal_point.theta << ", " << current_point.theta);
      */
-    if (hypot(goal_point.x - current_point.x, goal_point.y - current_point.y) <
-            error_distance &&
-        abs(diff_yaw) < error_angle) {
-      return true;
-    } else {
-      return false;
-    }
+    return reachGoal(goal_point.x, goal_point.y, goal_point.theta,
+                     current_point.x, current_point.y, current_point.theta,
+                     error_distance, error_angle);
+  }
+
+  // 今向かっている目標点までの残りの距離[mm]
+  double distanceToGoal() const {
+    return std::hypot(goal_point.x - current_point.x,
+                      goal_point.y - current_point.y);
   }
 
   void sendEmergencyStatus() {
@@ -72,6 +84,55 @@ public:
     goal_velocity_pub.publish(goal_velocity);
   }
 
+  // 次の目標点から止まる点までの列. local_plannerが角の速さを決めるのに使う
+  void sendWaypoints(const geometry_msgs::PoseArray &waypoints) {
+    waypoints_pub.publish(waypoints);
+  }
+
+  // 全経路. 起動時に1度だけ送り, local_plannerが区間を先に計算しておく
+  void sendMission(const GoalManager goal_map[], int num_map) {
+    std_msgs::Float64MultiArray mission;
+    for (int i = 0; i < num_map; ++i) {
+      goal_map[i].appendMission(i, mission.data);
+    }
+    mission_pub.publish(mission);
+  }
+
+  // 今の目標点を送って次へ進める
+  void sendGoal(GoalManager &goals) {
+    const GoalInfo &now = goals.now;
+    sendAccelMax(now.accel);
+
+    geometry_msgs::Twist dummy_velocity;
+    dummy_velocity.linear.x = now.velocity_x;
+    dummy_velocity.linear.y = now.velocity_y;
+    sendNextVelocity(dummy_velocity);
+
+    // 通過するだけの点が続く間は先まで送り, 角で止まらずに曲がらせる
+    goals.passWaypoints(pass_goals);
+    geometry_msgs::PoseArray waypoints;
+    for (const GoalInfo &goal : pass_goals) {
+      geometry_msgs::Pose pose;
+      pose.position.x = goal.x;
+      pose.position.y = goal.y;
+      pose.orientation.z = sin(goal.yaw / 180.0 * M_PI / 2);
+      pose.orientation.w = cos(goal.yaw / 180.0 * M_PI / 2);
+      waypoints.poses.push_back(pose);
+    }
+    sendWaypoints(waypoints);
+
+    geometry_msgs::Pose2D dummy_goal;
+    dummy_goal.x = now.x;
+    dummy_goal.y = now.y;
+    dummy_goal.theta = now.yaw / 180.0 * M_PI;
+    sendNextGoal(dummy_goal);
+
+    driving_goal = goals.id();
+    goals.next();
+  }
+
+  int driving_goal = 0; // 今向かっている点の, GoalManagerでの番号
+
   void sendNextGoal(geometry_msgs::Pose2D point) {
     goal_point = point;
     ROS_INFO_STREAM("Next Goal Point is " << goal_point.x << ", "
@@ -92,94 +153,12 @@ public:
 
 private:
   ros::Publisher goal_point_pub, goal_velocity_pub, accel_max_pub,
-      emergency_stop_pub;
+      emergency_stop_pub, waypoints_pub, mission_pub;
   ros::Subscriber robot_pose_sub;
   geometry_msgs::Pose2D goal_point = {}, current_point = {};
   geometry_msgs::Twist goal_velocity;
   std_msgs::Int32 accel_max;
-};
-
-struct GoalInfo {
-  int x;
-  int y;
-  int yaw; // degree あとでradに変換する
-  int action_type;
-  int action_value; // 必要なら使う e.g. 高さ
-  int velocity_x;
-  int velocity_y;
-  int accel;
-};
-
-class GoalManager {
-public:
-  GoalManager(int coat) {
-    coat_reverse_ = coat;
-    restart();
-  }
-  void add(GoalInfo goal) {
-    goal.x = coat_reverse_ * goal.x;
-    goal.yaw = coat_reverse_ * goal.yaw;
-    map_.push_back(goal);
-  }
-  void add(int x, int y, int yaw, int accel = 100, int action_type = 0,
-           int action_value = 0, int velocity_x = 0, int velocity_y = 0) {
-    GoalInfo dummy_goal;
-    dummy_goal.x = coat_reverse_ * x;
-    dummy_goal.y = y;
-    dummy_goal.yaw = coat_reverse_ * yaw;
-    dummy_goal.action_type = action_type;
-    dummy_goal.action_value = action_value;
-    dummy_goal.velocity_x = velocity_x * coat_reverse_;
-    dummy_goal.velocity_y = velocity_y;
-    dummy_goal.accel = accel;
-    map_.push_back(dummy_goal);
-  }
-
-  void show() {
-    for (x : map_) {
-      ROS_INFO_STREAM(x.x << ", " << x.y);
-    }
-  }
-
-  void next() {
-    if (map_id_ < map_.size() - 1) {
-      ++map_id_;
-      now = map_.at(map_id_);
-    }
-  }
-
-  void restart() {
-    map_id_ = 0;
-    if (map_.size() > 0) {
-      now = map_.at(map_id_);
-    }
-  };
-
-  void reset() { map_.resize(0); }
-
-  void getPtp(Ptp &controller) {
-    controller.sendAccelMax(now.accel);
-
-    geometry_msgs::Twist dummy_velocity;
-    dummy_velocity.linear.x = now.velocity_x;
-    dummy_velocity.linear.y = now.velocity_y;
-    controller.sendNextVelocity(dummy_velocity);
-
-    geometry_msgs::Pose2D dummy_goal;
-    dummy_goal.x = now.x;
-    dummy_goal.y = now.y;
-    dummy_goal.theta = now.yaw / 180.0 * M_PI;
-    controller.sendNextGoal(dummy_goal);
-
-    next();
-  }
-
-  GoalInfo now;
-
-private:
-  std::vector<GoalInfo> map_;
-  int map_id_ = 0;
-  int coat_reverse_;
+  std::vector<GoalInfo> pass_goals;
 };
 
 using namespace ros;
@@ -196,33 +175,154 @@ enum Switch {
 };
 Switch ALL_SWITCH[] = {START,    EMERGENCY, RESET,   CALIBRATION,
                        HUNGER_1, HUNGER_2,  HUNGER_3};
+// pigpiodが無い時(wheel_simulatorで試す時)は負のエラーが返るので, 押されていない
+// ことにする
+int readSwitch(Switch pin) {
+  int level = Pi::gpio().read(pin);
+  return level < 0 ? 0 : level;
+}
 
+// 1回しか送らないコマンドと読み出しはサービスで返信を待つ
+// 待つのはActionExecutorのスレッドで, メインループは止めない
 ros::ServiceClient motor_speed;
-int send(int id, int cmd, int data) {
+bool call(int id, int cmd, int data, int &response) {
   motor_serial::motor_serial srv;
   srv.request.id = id;
   srv.request.cmd = cmd;
   srv.request.data = data;
-  motor_speed.call(srv);
-  return srv.response.data;
+  bool ok = motor_speed.call(srv);
+  response = srv.response.data;
+  return ok;
+}
+
+ActionExecutor::Task sendTask(int id, int cmd, int data) {
+  return [id, cmd, data](int &response) {
+    return call(id, cmd, data, response);
+  };
+}
+
+// 機構ごとに指令の列を持ち, 同じ機構は順番に, 違う機構は並行して送る
+enum Mechanism { TWO_STAGE, HUNGER, TOWEL, NUM_MECHANISM };
+// サービスの返信を待つ上限[s]
+constexpr double SEND_TIMEOUT = 0.5;
+// 失敗と時間切れはログに残すだけで, 経路は今まで通り先へ進める
+void send(ActionExecutor &executor, Mechanism mechanism, int id, int cmd,
+          int data) {
+  executor.start(mechanism, sendTask(id, cmd, data), SEND_TIMEOUT,
+                 [id, cmd](ActionStatus status, int) {
+                   if (status == ActionStatus::FAILED) {
+                     ROS_WARN_STREAM("motor_serial failed: id " << id
+                                                                << ", cmd "
+                                                                << cmd);
+                   } else if (status == ActionStatus::TIMEOUT) {
+                     ROS_WARN_STREAM("motor_serial timeout: id " << id
+                                                                 << ", cmd "
+                                                                 << cmd);
+                   }
+                 });
+}
+
+// 機構の状態を読んで止まったら次へ進む. 読む間隔[s]と, 続けて満たす回数
+constexpr double CHECK_INTERVAL = 0.05;
+constexpr int CHECK_SETTLE = 2;
+
+// 2段目昇降(mdd2): 左右の高さ(cmd 33, [cm])が目標からerror_max以内で,
+// モーターの指令(cmd 34, PWM)がspeed_max以内. dataは左右の平均の高さ
+ActionExecutor::Task liftReached(int id, int goal, int error_max,
+                                 int speed_max) {
+  return [=](int &height) {
+    constexpr int NUM_SIDE = 2;
+    bool is_reached = true;
+    int sum = 0;
+    for (int i = 0; i < NUM_SIDE; ++i) {
+      int side_height, speed;
+      if (!call(id, 33, 10 + i, side_height) || !call(id, 34, i, speed)) {
+        return false;
+      }
+      sum += side_height;
+      is_reached = is_reached && std::abs(side_height - goal) <= error_max &&
+                   std::abs(speed) <= speed_max;
+    }
+    height = sum / NUM_SIDE;
+    return is_reached;
+  };
+}
+
+// ハンガー(mdd1): 同じ速さをもう一度送り, 返ってくる今の速さ(cmd 20)が0なら
+// 進む向きのリミットスイッチに当たって止まっている
+ActionExecutor::Task hangerStopped(int id, int speed) {
+  return [=](int &current_speed) {
+    return call(id, 20, speed, current_speed) && current_speed == 0;
+  };
+}
+
+// 時間切れは止まったのが読めなかっただけなので, 経路はタイマーで先へ進める
+void waitMechanism(ActionExecutor &executor, Mechanism mechanism,
+                   ActionExecutor::Task condition, double timeout,
+                   const std::string name) {
+  executor.waitUntil(mechanism, condition, CHECK_INTERVAL, CHECK_SETTLE,
+                     timeout, [name](ActionStatus status, int data) {
+                       if (status == ActionStatus::DONE) {
+                         ROS_INFO_STREAM(name << " done: " << data);
+                       } else if (status != ActionStatus::CANCELED) {
+                         ROS_WARN_STREAM(name << " not settled: " << data);
+                       }
+                     });
+}
+
+// 決まった時間だけ機構の列を止める. 動き終わりが読めないサーボに使う
+ActionExecutor::Task sleepTask(double time) {
+  return [time](int &) { return ros::Duration(time).sleep(); };
+}
+
+// 最後に始めた指令と待ちが全部終わり, 止まったのが読めた
+bool isSettled(const ActionExecutor &executor, Mechanism mechanism) {
+  return executor.idle(mechanism) &&
+         executor.status(mechanism) == ActionStatus::DONE;
+}
+
+// 繰り返し送る目標値はトピックで, 返信を待たない
+ros::Publisher motor_pub;
+void post(const std::vector<motor_serial::motor_command> &commands) {
+  motor_serial::motor_commands msg;
+  msg.commands = commands;
+  motor_pub.publish(msg);
 }
 
+motor_serial::motor_command command(int id, int cmd, int data) {
+  motor_serial::motor_command dummy;
+  dummy.id = id;
+  dummy.cmd = cmd;
+  dummy.data = data;
+  return dummy;
+}
+
+// 同じ色ならkeep alive(TAPE_KEEP_ALIVE[s])ごとにしか送らない
+constexpr double TAPE_KEEP_ALIVE = 1.0;
 void lightTape(int type) {
-  if (Pi::gpio().read(EMERGENCY) == 0) {
-    send(4, 100, 0);
-    send(4, 101, 0);
-  } else {
-    send(4, 100, type);
-    send(4, 101, type);
+  static int prev_type = -1;
+  static double prev_time = 0;
+  if (readSwitch(EMERGENCY) == 0) {
+    type = 0;
+  }
+  double now = ros::Time::now().toSec();
+  if (type == prev_type && now - prev_time < TAPE_KEEP_ALIVE) {
+    return;
   }
+  prev_type = type;
+  prev_time = now;
+  post({command(4, 100, type), command(4, 101, type)});
 }
 
 bool can_starts_game = false;
 void checkGlobalMessage(const std_msgs::String msg) { can_starts_game = true; }
 
-int main(int argc, char **argv) {
-  ros::init(argc, argv, "motion_planner");
-  ros::NodeHandle n;
+// motion_plannerの本体. スタートスイッチを待ってから目標点を順に送り, 着いた点の
+// 動作をする. runningがfalseになるかROSが終了するまで回る
+void run(ros::NodeHandle &nh, const std::atomic<bool> &running) {
+  ros::NodeHandle n(nh);
+  ros::CallbackQueue queue;
+  n.setCallbackQueue(&queue);
   Ptp planner(&n, "wheel");
   ros::Subscriber global_message_sub =
       n.subscribe("global_message", 1, checkGlobalMessage);
@@ -230,6 +330,8 @@ int main(int argc, char **argv) {
       n.advertise<std_msgs::String>("global_message", 1);
   std_msgs::String global_message;
   motor_speed = n.serviceClient<motor_serial::motor_serial>("motor_speed");
+  motor_pub = n.advertise<motor_serial::motor_commands>("motor_commands", 10);
+  ActionExecutor executor(NUM_MECHANISM);
 
   // コート情報の取得
   std::string coat_color;
@@ -256,14 +358,23 @@ int main(int argc, char **argv) {
   n.getParam("/ar/start_x", start_x);
   n.getParam("/ar/start_y", start_y);
   n.getParam("/ar/start_yaw", start_yaw);
+  // wheel_simulatorで試す時は, 最初の1回だけスタートスイッチを押したことにする
+  bool auto_start = false;
+  n.param("/ar/auto_start", auto_start, auto_start);
+  double mission_start = -1;
 
   // パラメータ
-  constexpr double ERROR_DISTANCE_MAX = 400, ERROR_ANGLE_MAX = 10000;
+  // 目標点からこの距離[mm]以内に入ったら次の目標点を送る. local_plannerも同じ値で
+  // 起動時の軌道を作るので, /ar/goal_reach_distanceで両方に渡す
+  double ERROR_DISTANCE_MAX = 400;
+  n.param("/ar/goal_reach_distance", ERROR_DISTANCE_MAX, ERROR_DISTANCE_MAX);
+  constexpr double ERROR_ANGLE_MAX = 10000;
   constexpr int MAX_ACCEL_NOMAL = 1000;
   // 2段目昇降機構
   constexpr int TWO_STAGE_ID = 2, TWO_STAGE_HUNGER = 75, TWO_STAGE_TOWEL = 77,
                 TWO_STAGE_SHEET = 77, TWO_STAGE_READY = 0,
                 TWO_STAGE_ERROR_MAX = 1;  // cm
+  constexpr int TWO_STAGE_SPEED_MAX = 60; // PWM(最大250), 1cmずれると50
   constexpr double TWO_STAGE_TIME = 0.08; // 0.06;
                                           // ハンガー
   constexpr int HUNGER_POSITION_Y = 4500 - 500 - 100;
@@ -274,7 +385,7 @@ int main(int argc, char **argv) {
   constexpr int TOWEL_POSITION_Y = 7100;
   constexpr int TOWEL_ID = 2, NUM_TOWEL = 3;
   constexpr int TOWEL_ANGLE[NUM_TOWEL] = {50, 50, 0};
-  send(TOWEL_ID, 10, 0);
+  send(executor, TOWEL, TOWEL_ID, 10, 0);
   constexpr double TOWEL_WAIT_TIME = 3;
   // 3段目昇降機構
   constexpr int THREE_STAGE_ID = 1, THREE_STAGE_SHEET = 74;
@@ -284,11 +395,12 @@ int main(int argc, char **argv) {
   constexpr double SHEET_STAGE_TIME = 0.06;
 
   // 座標追加
-  // add(int x, int y, int yaw, int action_type = 0, int action_value = 0,
-  // int velocity_x = 0, int velocity_y = 0)
+  // add(int x, int y, int yaw, int accel = 100, int action_type = 0,
+  // int action_value = 0, int velocity_x = 0, int velocity_y = 0)
   // action_type
   // 0: 通過, 1: 2段目昇降, 2: ハンガー, 3: バスタオル, 4: 3段目昇降, 5:
-  // シーツ, 10: 一定時間待機, 11: スタートスイッチ
+  // シーツ, 10: 2段目昇降が止まるまで待機, 11: スタートスイッチ
+  // 待ち時間のaction_value(2, 10)は, 止まったのが読めない時の上限[s]
   constexpr int NUM_MAP = 3;
   // map_type
   // 0: ハンガー, 1: シーツ
@@ -296,52 +408,60 @@ int main(int argc, char **argv) {
   GoalManager goal_map[NUM_MAP] = {GoalManager(coat), GoalManager(coat),
                                    GoalManager(coat)};
   //位置: 後判定
-  goal_map[0].add(start_x, start_y, start_yaw, 11); // Move: スタートゾーン
-  goal_map[0].add(3650, HUNGER_POSITION_Y, start_yaw);
-  goal_map[0].add(3650, HUNGER_POSITION_Y, start_yaw, 1,
-                  TWO_STAGE_HUNGER); // Move: 小ポール横 -> Start: 昇降
-  goal_map[0].add(
-      3650, HUNGER_POSITION_Y, start_yaw, 10,
-      TWO_STAGE_HUNGER *
-          TWO_STAGE_TIME); // Move: 小ポール横 -> Wait: 昇降完了タイマー
-  goal_map[0].add(
-      2850, 3850, start_yaw, 2,
-      HUNGER_WAIT_TIME); // Move: ハンガー手前 -> Wait:ハンガー完了タイマー
-  goal_map[0].add(2050, 3850, start_yaw, 2,
-                  HUNGER_WAIT_TIME); // Move: 次ハンガー手前 -> Wait:ハンガー
-  goal_map[0].add(2050, HUNGER_POSITION_Y, start_yaw, 2,
-                  HUNGER_WAIT_TIME); // Move: 次ハンガー手前 -> Wait: ハンガー
-  goal_map[0].add(2050, HUNGER_POSITION_Y, start_yaw, 1,
-                  TWO_STAGE_READY); // Move: 次ハンガー手前 -> Wait: ハンガー
-  goal_map[0].add(
-      start_x + 200, start_y - 200, start_yaw, 10,
-      TWO_STAGE_HUNGER *
-          TWO_STAGE_TIME); // Move: スタートゾーン -> Wait: スタートスイッチ
+  // goal_map[0]は止まる点だけを並べ, 機構の動作はactionsの依存グラフで走りながら
+  // 動かす. 止まる点では, その点で待つと決めた動作だけを待つ
+  goal_map[0].add(start_x, start_y, start_yaw, MAX_ACCEL_NOMAL,
+                  11); // 0 Move: スタートゾーン
+  goal_map[0].add(3650, HUNGER_POSITION_Y, start_yaw,
+                  MAX_ACCEL_NOMAL); // 1 Move: 小ポール横
+  goal_map[0].add(2850, 3850, start_yaw,
+                  MAX_ACCEL_NOMAL); // 2 Move: ハンガー手前
+  goal_map[0].add(2050, 3850, start_yaw,
+                  MAX_ACCEL_NOMAL); // 3 Move: 次ハンガー手前
+  goal_map[0].add(2050, HUNGER_POSITION_Y, start_yaw,
+                  MAX_ACCEL_NOMAL); // 4 Move: 次ハンガー横
   goal_map[0].add(start_x + 200, start_y - 200, start_yaw,
-                  11); // Move: スタートゾーン -> Wait: スタートスイッチ
+                  MAX_ACCEL_NOMAL); // 5 Move: スタートゾーン
+  goal_map[0].add(start_x + 200, start_y - 200, start_yaw, MAX_ACCEL_NOMAL,
+                  11); // 6 Wait: スタートスイッチ
+  MissionGraph &hunger_actions = goal_map[0].actions;
+  // 小ポールへ向かい始めたら上げ, 着いたら上がりきるのだけ待ってハンガー
+  int lift_up =
+      hunger_actions.add(1, TWO_STAGE_HUNGER, 1, MissionGraph::ON_DEPART);
+  int hunger_1 =
+      hunger_actions.add(2, HUNGER_WAIT_TIME, 1, 0, {lift_up}, true);
+  int hunger_2 =
+      hunger_actions.add(2, HUNGER_WAIT_TIME, 2, 0, {hunger_1}, true);
+  int hunger_3 =
+      hunger_actions.add(2, HUNGER_WAIT_TIME, 3, 0, {hunger_2}, true);
+  // 最後のハンガーを離れたら, スタートゾーンへ戻りながら下げる
+  hunger_actions.add(1, TWO_STAGE_READY, 4, MissionGraph::ON_DEPART,
+                     {hunger_3});
   goal_map[0].restart();
 
-  goal_map[1].add(start_x, start_y, start_yaw, 11); // Move: スタートゾーン
-  goal_map[1].add(5400, 7500, start_yaw);
-  goal_map[1].add(3600, 7500, start_yaw);
-  goal_map[1].add(3600, 7500, start_yaw, 1, TWO_STAGE_TOWEL);
-  goal_map[1].add(3600, TOWEL_POSITION_Y, start_yaw, 10,
+  goal_map[1].add(start_x, start_y, start_yaw, MAX_ACCEL_NOMAL,
+                  11); // Move: スタートゾーン
+  goal_map[1].add(5400, 7500, start_yaw, MAX_ACCEL_NOMAL);
+  goal_map[1].add(3600, 7500, start_yaw, MAX_ACCEL_NOMAL);
+  goal_map[1].add(3600, 7500, start_yaw, MAX_ACCEL_NOMAL, 1, TWO_STAGE_TOWEL);
+  goal_map[1].add(3600, TOWEL_POSITION_Y, start_yaw, MAX_ACCEL_NOMAL, 10,
                   TWO_STAGE_TOWEL *
                       TWO_STAGE_TIME); // Move: 小ポール横 -> Start: 昇降
-  goal_map[1].add(2850, 7500, start_yaw, 3, TOWEL_ANGLE[0]);
-  goal_map[1].add(2850, 7500, start_yaw);
-  goal_map[1].add(2050, TOWEL_POSITION_Y, start_yaw, 3, TOWEL_ANGLE[1]);
-  goal_map[1].add(2100, 7500, start_yaw);
-  goal_map[1].add(2100, TOWEL_POSITION_Y, start_yaw, 3, TOWEL_ANGLE[2]);
-  goal_map[1].add(2100, 7500, start_yaw);
-  goal_map[1].add(2100, 7500, start_yaw, 1,
+  goal_map[1].add(2850, 7500, start_yaw, MAX_ACCEL_NOMAL, 3, TOWEL_ANGLE[0]);
+  goal_map[1].add(2850, 7500, start_yaw, MAX_ACCEL_NOMAL);
+  goal_map[1].add(2050, TOWEL_POSITION_Y, start_yaw, MAX_ACCEL_NOMAL, 3,
+                  TOWEL_ANGLE[1]);
+  goal_map[1].add(2100, 7500, start_yaw, MAX_ACCEL_NOMAL);
+  goal_map[1].add(2100, TOWEL_POSITION_Y, start_yaw, MAX_ACCEL_NOMAL, 3, TOWEL_ANGLE[2]);
+  goal_map[1].add(2100, 7500, start_yaw, MAX_ACCEL_NOMAL);
+  goal_map[1].add(2100, 7500, start_yaw, MAX_ACCEL_NOMAL, 1,
                   TWO_STAGE_READY); // Move: 次ハンガー手前 -> Wait: ハンガー
   goal_map[1].add(
-      5400, 7500, start_yaw, 10,
+      5400, 7500, start_yaw, MAX_ACCEL_NOMAL, 10,
       TWO_STAGE_TOWEL *
           TWO_STAGE_TIME); // Move: スタートゾーン -> Wait: スタートスイッチ
-  goal_map[1].add(start_x + 200, start_y - 200, start_yaw);
-  goal_map[1].add(start_x + 200, start_y - 200, start_yaw,
+  goal_map[1].add(start_x + 200, start_y - 200, start_yaw, MAX_ACCEL_NOMAL);
+  goal_map[1].add(start_x + 200, start_y - 200, start_yaw, MAX_ACCEL_NOMAL,
                   11); // Move: スタートゾーン -> Wait: スタートスイッチ
   goal_map[1].restart();
 
@@ -356,9 +476,56 @@ int main(int argc, char **argv) {
                   11); // Move: スタートゾーン
   goal_map[2].restart();
 
+  // 予定通りに進んだ時の軌道をlocal_plannerに先に計算させておく
+  planner.sendMission(goal_map, NUM_MAP);
+
   bool changed_phase = true;
+  bool is_hunger_back = false; // ハンガーを伸ばし終えて縮めている
   double start;
 
+  // 2段目昇降: 高さを送り, 止まるまで機構の列で読み続ける
+  auto move_lift = [&executor](int height) {
+    send(executor, TWO_STAGE, TWO_STAGE_ID, 30, height);
+    waitMechanism(executor, TWO_STAGE,
+                  liftReached(TWO_STAGE_ID, height, TWO_STAGE_ERROR_MAX,
+                              TWO_STAGE_SPEED_MAX),
+                  TWO_STAGE_TOWEL * TWO_STAGE_TIME, "Two Stage");
+  };
+  // 依存グラフの動作を機構の列にまとめて並べる. 列が空いたら動作も終わり
+  auto start_action = [&](const MissionAction &action) -> Mechanism {
+    switch (action.action_type) {
+    case 1:
+      move_lift(action.action_value);
+      return TWO_STAGE;
+    case 2:
+      // 伸ばして先のリミットスイッチまで, 縮めて手前のリミットスイッチまで
+      send(executor, HUNGER, HUNGER_ID, 20, HUNGER_SPEED);
+      waitMechanism(executor, HUNGER, hangerStopped(HUNGER_ID, HUNGER_SPEED),
+                    action.action_value, "Hunger Forward");
+      send(executor, HUNGER, HUNGER_ID, 20, -HUNGER_SPEED);
+      waitMechanism(executor, HUNGER, hangerStopped(HUNGER_ID, -HUNGER_SPEED),
+                    action.action_value, "Hunger Back");
+      return HUNGER;
+    case 3:
+      executor.start(TOWEL, sleepTask(TOWEL_WAIT_TIME),
+                     TOWEL_WAIT_TIME + SEND_TIMEOUT);
+      send(executor, TOWEL, TOWEL_ID, 10, action.action_value);
+      executor.start(TOWEL, sleepTask(TOWEL_WAIT_TIME),
+                     TOWEL_WAIT_TIME + SEND_TIMEOUT);
+      send(executor, TOWEL, TOWEL_ID, 10, 0);
+      return TOWEL;
+    default:
+      ROS_WARN_STREAM("Unknown Action: " << action.action_type);
+      return NUM_MECHANISM;
+    }
+  };
+  struct RunningAction {
+    int id;
+    Mechanism mechanism;
+  };
+  std::vector<RunningAction> running_actions;
+  std::vector<int> started_actions;
+
   // スイッチ基板
   constexpr double FREQ = 10;
   ros::Rate loop_rate(FREQ);
@@ -367,9 +534,10 @@ int main(int argc, char **argv) {
     Pi::gpio().set(pin, IN, PULL_DOWN);
   }
 
-  while (ros::ok()) {
+  while (ros::ok() && running) {
     loop_rate.sleep();
-    if (Pi::gpio().read(START) == 1) {
+    executor.poll();
+    if (readSwitch(START) == 1 || auto_start) {
       break;
     }
     planner.should_stop_emergency = true;
@@ -379,10 +547,11 @@ int main(int argc, char **argv) {
   global_message_pub.publish(global_message);
 
   ros::Duration(1.0).sleep();
-  goal_map[map_type].getPtp(planner);
+  planner.sendGoal(goal_map[map_type]);
 
-  while (ros::ok()) {
-    ros::spinOnce();
+  while (ros::ok() && running) {
+    queue.callAvailable();
+    executor.poll();
     /* if (Pi::gpio().read(RESET)) { */
     /*   global_message.data = "Robo_Pose Reset Both"; */
     /*   global_message_pub.publish(global_message); */
@@ -400,30 +569,67 @@ int main(int argc, char **argv) {
 
     double now = ros::Time::now().toSec();
 
+    // 依存グラフの動作: 区間の残りの距離で始め, 機構の列が空いたら終わり
+    MissionGraph &actions = goal_map[map_type].actions;
+    bool is_reached =
+        planner.checkReachGoal(ERROR_DISTANCE_MAX, ERROR_ANGLE_MAX);
+    actions.update(planner.driving_goal,
+                   is_reached ? 0 : planner.distanceToGoal(), started_actions);
+    for (int id : started_actions) {
+      running_actions.push_back(
+          RunningAction{id, start_action(actions.action(id))});
+    }
+    for (auto it = running_actions.begin(); it != running_actions.end();) {
+      if (it->mechanism == NUM_MECHANISM || executor.idle(it->mechanism)) {
+        actions.finish(it->id);
+        it = running_actions.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    // 依存グラフのハンガーは止まらずに動かすので, 動いている間はここで光らせる
+    bool is_hunger_running = false;
+    for (const RunningAction &action : running_actions) {
+      is_hunger_running = is_hunger_running || action.mechanism == HUNGER;
+    }
+
     bool can_send_next_goal = false;
     if (goal_map[map_type].now.action_type == 11) {
       planner.should_stop_emergency = true;
-      if (Pi::gpio().read(START) == 1 && Pi::gpio().read(EMERGENCY) == 1) {
-        if (Pi::gpio().read(HUNGER_1) == 1) {
+      if ((readSwitch(START) == 1 && readSwitch(EMERGENCY) == 1) ||
+          (auto_start && mission_start < 0)) {
+        if (readSwitch(HUNGER_1) == 1) {
           map_type = 0;
-        } else if (Pi::gpio().read(HUNGER_2) == 1) {
+        } else if (readSwitch(HUNGER_2) == 1) {
           map_type = 1;
-        } else if (Pi::gpio().read(HUNGER_3) == 1) {
+        } else if (readSwitch(HUNGER_3) == 1) {
           map_type = 2;
         }
         map_type = 2;
         global_message.data = "Robot Pose Reset";
         global_message_pub.publish(global_message);
         goal_map[map_type].restart();
+        // 前の回の指令が機構の列に残っていると, 新しい動作がそれを待って
+        // canLeaveが古い状態を返すので捨てる
+        executor.cancel();
+        running_actions.clear();
         can_send_next_goal = true;
         changed_phase = true;
+        mission_start = now;
       }
     }
 
-    if (planner.checkReachGoal(ERROR_DISTANCE_MAX, ERROR_ANGLE_MAX) ||
-        planner.should_stop_emergency) {
+    if (is_reached || planner.should_stop_emergency) {
       switch (goal_map[map_type].now.action_type) {
       case 0: {
+        if (is_hunger_running) {
+          lightTape(1);
+        }
+        // この点で待つ並行動作が終わるまで止まる
+        if (!actions.canLeave(planner.driving_goal)) {
+          planner.should_stop_emergency = true;
+          break;
+        }
         can_send_next_goal = true;
         changed_phase = true;
         break;
@@ -431,8 +637,8 @@ int main(int argc, char **argv) {
       case 1: {
         /* planner.should_stop_emergency = true; */
         start = now;
-        // 伸縮
-        send(TWO_STAGE_ID, 30, goal_map[map_type].now.action_value);
+        // 伸縮. 走りながら高さを読み, 止まるのはaction 10で待つ
+        move_lift(goal_map[map_type].now.action_value);
         can_send_next_goal = true;
         changed_phase = true;
         break;
@@ -440,19 +646,28 @@ int main(int argc, char **argv) {
       case 2: {
         planner.should_stop_emergency = true;
         lightTape(1);
+        const double wait_time = goal_map[map_type].now.action_value;
         if (changed_phase) {
-          // 伸ばす(取り付け)
-          send(HUNGER_ID, 20, HUNGER_SPEED);
+          // 伸ばす(取り付け). 先のリミットスイッチに当たるまで
+          send(executor, HUNGER, HUNGER_ID, 20, HUNGER_SPEED);
+          waitMechanism(executor, HUNGER,
+                        hangerStopped(HUNGER_ID, HUNGER_SPEED), wait_time,
+                        "Hunger Forward");
           start = now;
           changed_phase = false;
+          is_hunger_back = false;
         }
-        // 取り付くまでタイマー待機
-        if (now - start > goal_map[map_type].now.action_value &&
-            now - start <= goal_map[map_type].now.action_value * 2) {
-          // 縮める
-          send(HUNGER_ID, 20, -HUNGER_SPEED);
-          // 縮むまでタイマー待機
-        } else if (now - start > goal_map[map_type].now.action_value * 2) {
+        if (!is_hunger_back &&
+            (isSettled(executor, HUNGER) || now - start > wait_time)) {
+          // 縮める. 手前のリミットスイッチに当たるまで
+          send(executor, HUNGER, HUNGER_ID, 20, -HUNGER_SPEED);
+          waitMechanism(executor, HUNGER,
+                        hangerStopped(HUNGER_ID, -HUNGER_SPEED), wait_time,
+                        "Hunger Back");
+          start = now;
+          is_hunger_back = true;
+        } else if (is_hunger_back &&
+                   (isSettled(executor, HUNGER) || now - start > wait_time)) {
           can_send_next_goal = true;
           changed_phase = true;
         }
@@ -466,19 +681,20 @@ int main(int argc, char **argv) {
           start = now;
           changed_phase = false;
         }
-        // 取り付くまでタイマー待機
-        if (now - start > TOWEL_WAIT_TIME) {
-          send(TOWEL_ID, 10, goal_map[map_type].now.action_value);
-        } else if (now - start > TOWEL_WAIT_TIME * 2) {
-          send(TOWEL_ID, 10, 0);
+        // サーボは角度が読めないのでタイマー待機
+        if (now - start > TOWEL_WAIT_TIME * 2) {
+          send(executor, TOWEL, TOWEL_ID, 10, 0);
           can_send_next_goal = true;
           changed_phase = true;
+        } else if (now - start > TOWEL_WAIT_TIME) {
+          post({command(TOWEL_ID, 10, goal_map[map_type].now.action_value)});
         }
         break;
       }
       case 10: {
         planner.should_stop_emergency = true;
-        if (now - start > goal_map[map_type].now.action_value) {
+        if (isSettled(executor, TWO_STAGE) ||
+            now - start > goal_map[map_type].now.action_value) {
           planner.should_stop_emergency = true;
           can_send_next_goal = true;
           changed_phase = true;
@@ -499,11 +715,16 @@ int main(int argc, char **argv) {
         global_message.data = ss.str();
         global_message_pub.publish(global_message);
 
-        goal_map[map_type].getPtp(planner);
+        planner.sendGoal(goal_map[map_type]);
+        // 最後のスタートスイッチ待ちまで来たら1回分の試合が終わり
+        if (goal_map[map_type].now.action_type == 11 && mission_start >= 0) {
+          ROS_INFO_STREAM("Mission Time: " << now - mission_start << " s");
+        }
       }
     } else {
-      lightTape(nomal_led);
+      lightTape(is_hunger_running ? 1 : nomal_led);
     }
     loop_rate.sleep();
   }
 }
+} // namespace motion_planner
@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mpc_tracker.hpp>
+
+namespace robot_plan {
+namespace {
+constexpr double INVERCE_ROOT_2 = 0.70710678118654752440;
+// MDDと同じ並び, 駆動輪の速度 = DRIVE_MATRIX * ロボット座標の速度
+constexpr double DRIVE_MATRIX[MpcTracker::NUM_WHEEL][MpcTracker::NUM_AXIS] = {
+    {INVERCE_ROOT_2, -INVERCE_ROOT_2, -1},
+    {-INVERCE_ROOT_2, -INVERCE_ROOT_2, -1},
+    {-INVERCE_ROOT_2, INVERCE_ROOT_2, -1},
+    {INVERCE_ROOT_2, INVERCE_ROOT_2, -1},
+};
+// ADMMの定数. 位置は[mm], 速度は[mm/s]のまま扱う
+constexpr double RHO = 0.03, SIGMA = 1.0e-6, ALPHA = 1.6;
+constexpr double PRIMAL_TOLERANCE = 1.0, DUAL_TOLERANCE = 1.0e-2;
+
+double clamp(double value, double lower, double upper) {
+  return value < lower ? lower : (value > upper ? upper : value);
+}
+} // namespace
+
+// yawは角度にturn_radiusをかけて[mm]にし, 3軸とも同じモデルで扱う
+// 1段の間指令uを保つと v' = a v + (1 - a) u, 位置はその積分
+MpcTracker::MpcTracker(const MpcConfig &config)
+    : config_(config), n_(NUM_AXIS * config.horizon),
+      m_((NUM_WHEEL + NUM_AXIS + 1) * config.horizon) {
+  const int N = config_.horizon;
+  const double dt = config_.step, lag = config_.motor_lag;
+  const double a = lag > 0 ? std::exp(-dt / lag) : 0;
+  const double from_velocity = lag * (1 - a), from_command = dt - lag * (1 - a);
+  position_.assign(N * N, 0);
+  velocity_.assign(N * N, 0);
+  position_v0_.assign(N, 0);
+  velocity_v0_.assign(N, 0);
+  for (int i = -1; i < N; ++i) {
+    // i = -1: 初速だけ1, それ以外: i段目の指令だけ1
+    double p = 0, v = i < 0 ? 1 : 0;
+    for (int k = 0; k < N; ++k) {
+      double u = k == i ? 1 : 0;
+      p += from_velocity * v + from_command * u;
+      v = a * v + (1 - a) * u;
+      if (i < 0) {
+        position_v0_[k] = p;
+        velocity_v0_[k] = v;
+      } else {
+        position_[k * N + i] = p;
+        velocity_[k * N + i] = v;
+      }
+    }
+  }
+  hessian_.assign(N * N, 0);
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < N; ++j) {
+      double sum = 0;
+      for (int k = 0; k < N; ++k) {
+        sum += config_.position_weight * position_[k * N + i] *
+                   position_[k * N + j] +
+               config_.velocity_weight * velocity_[k * N + i] *
+                   velocity_[k * N + j];
+      }
+      hessian_[i * N + j] = sum;
+    }
+    // 指令の変化(u[i] - u[i - 1])^2, u[-1]は前の指令
+    hessian_[i * N + i] += config_.smooth_weight * (i + 1 < N ? 2 : 1);
+    if (i > 0) {
+      hessian_[i * N + i - 1] -= config_.smooth_weight;
+      hessian_[(i - 1) * N + i] -= config_.smooth_weight;
+    }
+  }
+  kkt_.assign(n_ * n_, 0);
+  q_.assign(n_, 0);
+  lower_.assign(m_, 0);
+  upper_.assign(m_, 0);
+  x_.assign(n_, 0);
+  rhs_.assign(n_, 0);
+  z_.assign(m_, 0);
+  y_.assign(m_, 0);
+  ax_.assign(m_, 0);
+  z_prev_.assign(m_, 0);
+  reset();
+}
+
+void MpcTracker::reset() {
+  std::fill(model_velocity_, model_velocity_ + NUM_AXIS, 0);
+  std::fill(command_, command_ + NUM_AXIS, 0);
+  std::fill(x_.begin(), x_.end(), 0);
+  std::fill(z_.begin(), z_.end(), 0);
+  std::fill(y_.begin(), y_.end(), 0);
+  result_ = MpcResult{};
+}
+
+const MpcResult &MpcTracker::solve(const Pose &current,
+                                   const std::vector<TrajectoryPoint> &reference,
+                                   double period) {
+  auto start = std::chrono::steady_clock::now();
+  const int N = config_.horizon;
+  const double radius = config_.turn_radius;
+
+  // 前の指令でperiodの間に進んだはずの速度
+  const double a =
+      config_.motor_lag > 0 ? std::exp(-period / config_.motor_lag) : 0;
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    model_velocity_[c] = command_[c] + (model_velocity_[c] - command_[c]) * a;
+  }
+
+  // フィールド座標の速度から駆動輪の速さへ(ロボット座標に回してからDRIVE_MATRIX)
+  double cos_theta = std::cos(current.theta),
+         sin_theta = std::sin(current.theta);
+  for (int i = 0; i < NUM_WHEEL; ++i) {
+    wheel_[i][0] =
+        DRIVE_MATRIX[i][0] * cos_theta + DRIVE_MATRIX[i][1] * sin_theta;
+    wheel_[i][1] =
+        -DRIVE_MATRIX[i][0] * sin_theta + DRIVE_MATRIX[i][1] * cos_theta;
+    wheel_[i][2] = DRIVE_MATRIX[i][2];
+  }
+  setBounds(period);
+
+  // 1次の項: 指令が0の時の予測と目標のずれ
+  double p0[NUM_AXIS] = {current.x, current.y, current.theta * radius};
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    double *q = &q_[c * N];
+    std::fill(q, q + N, 0);
+    for (int k = 0; k < N; ++k) {
+      const TrajectoryPoint &point = reference[k];
+      double target_position, target_velocity;
+      if (c == 0) {
+        target_position = point.x;
+        target_velocity = point.vx;
+      } else if (c == 1) {
+        target_position = point.y;
+        target_velocity = point.vy;
+      } else {
+        target_position =
+            (current.theta + std::remainder(point.theta - current.theta,
+                                            2 * M_PI)) *
+            radius;
+        target_velocity = point.omega * radius;
+      }
+      double position_error =
+          p0[c] + position_v0_[k] * model_velocity_[c] - target_position;
+      double velocity_error =
+          velocity_v0_[k] * model_velocity_[c] - target_velocity;
+      for (int i = 0; i < N; ++i) {
+        q[i] += config_.position_weight * position_[k * N + i] *
+                    position_error +
+                config_.velocity_weight * velocity_[k * N + i] *
+                    velocity_error;
+      }
+    }
+    q[0] -= config_.smooth_weight * command_[c];
+  }
+
+  // 前の解を1段ずらして初期値にする
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    double *u = &x_[c * N];
+    std::rotate(u, u + 1, u + N);
+    if (N > 1) {
+      u[N - 1] = u[N - 2];
+    }
+  }
+  multiplyA(x_, z_);
+  for (int r = 0; r < m_; ++r) {
+    z_[r] = clamp(z_[r], lower_[r], upper_[r]);
+  }
+
+  result_.iterations = 0;
+  result_.residual = 0;
+  if (factorize()) {
+    const auto deadline =
+        start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(config_.time_budget));
+    while (result_.iterations < config_.max_iterations) {
+      ++result_.iterations;
+      for (int r = 0; r < m_; ++r) {
+        ax_[r] = RHO * z_[r] - y_[r];
+      }
+      multiplyAt(ax_, rhs_);
+      for (int i = 0; i < n_; ++i) {
+        rhs_[i] += SIGMA * x_[i] - q_[i];
+      }
+      solveFactor(rhs_);
+      multiplyA(rhs_, ax_);
+      for (int i = 0; i < n_; ++i) {
+        x_[i] = ALPHA * rhs_[i] + (1 - ALPHA) * x_[i];
+      }
+      double primal = 0;
+      for (int r = 0; r < m_; ++r) {
+        double relaxed = ALPHA * ax_[r] + (1 - ALPHA) * z_[r];
+        z_prev_[r] = z_[r];
+        z_[r] = clamp(relaxed + y_[r] / RHO, lower_[r], upper_[r]);
+        y_[r] += RHO * (relaxed - z_[r]);
+        primal = std::max(primal, std::fabs(ax_[r] - z_[r]));
+        z_prev_[r] = RHO * (z_[r] - z_prev_[r]);
+      }
+      multiplyAt(z_prev_, rhs_);
+      double dual = 0;
+      for (int i = 0; i < n_; ++i) {
+        dual = std::max(dual, std::fabs(rhs_[i]));
+      }
+      result_.residual = primal;
+      if ((primal < PRIMAL_TOLERANCE && dual < DUAL_TOLERANCE) ||
+          std::chrono::steady_clock::now() > deadline) {
+        break;
+      }
+    }
+  }
+
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    result_.velocity[c] = x_[c * N];
+  }
+  clip(result_.velocity, period);
+  std::copy(result_.velocity, result_.velocity + NUM_AXIS, command_);
+  result_.solve_time = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  return result_;
+}
+
+// 制約の並び: 駆動輪(段 x 輪), 指令の変化(軸 x 段), angular.z(段)
+void MpcTracker::setBounds(double period) {
+  const int N = config_.horizon;
+  for (int r = 0; r < NUM_WHEEL * N; ++r) {
+    lower_[r] = -config_.wheel_velocity_max;
+    upper_[r] = config_.wheel_velocity_max;
+  }
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    for (int k = 0; k < N; ++k) {
+      int r = NUM_WHEEL * N + c * N + k;
+      // 最初の段は前の指令からperiodの間の変化
+      double change = config_.accel_max * (k == 0 ? period : config_.step);
+      double center = k == 0 ? command_[c] : 0;
+      lower_[r] = center - change;
+      upper_[r] = center + change;
+    }
+  }
+  for (int k = 0; k < N; ++k) {
+    int r = (NUM_WHEEL + NUM_AXIS) * N + k;
+    lower_[r] = -config_.omega_max;
+    upper_[r] = config_.omega_max;
+  }
+}
+
+void MpcTracker::multiplyA(const std::vector<double> &x,
+                           std::vector<double> &ax) const {
+  const int N = config_.horizon;
+  for (int k = 0; k < N; ++k) {
+    for (int i = 0; i < NUM_WHEEL; ++i) {
+      double sum = 0;
+      for (int c = 0; c < NUM_AXIS; ++c) {
+        sum += wheel_[i][c] * x[c * N + k];
+      }
+      ax[k * NUM_WHEEL + i] = sum;
+    }
+  }
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    for (int k = 0; k < N; ++k) {
+      ax[NUM_WHEEL * N + c * N + k] =
+          x[c * N + k] - (k > 0 ? x[c * N + k - 1] : 0);
+    }
+  }
+  for (int k = 0; k < N; ++k) {
+    ax[(NUM_WHEEL + NUM_AXIS) * N + k] = x[2 * N + k];
+  }
+}
+
+void MpcTracker::multiplyAt(const std::vector<double> &y,
+                            std::vector<double> &aty) const {
+  const int N = config_.horizon;
+  std::fill(aty.begin(), aty.end(), 0);
+  for (int k = 0; k < N; ++k) {
+    for (int i = 0; i < NUM_WHEEL; ++i) {
+      for (int c = 0; c < NUM_AXIS; ++c) {
+        aty[c * N + k] += wheel_[i][c] * y[k * NUM_WHEEL + i];
+      }
+    }
+  }
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    for (int k = 0; k < N; ++k) {
+      double value = y[NUM_WHEEL * N + c * N + k];
+      aty[c * N + k] += value;
+      if (k > 0) {
+        aty[c * N + k - 1] -= value;
+      }
+    }
+  }
+  for (int k = 0; k < N; ++k) {
+    aty[2 * N + k] += y[(NUM_WHEEL + NUM_AXIS) * N + k];
+  }
+}
+
+void MpcTracker::addAtA(std::vector<double> &matrix, double scale) const {
+  const int N = config_.horizon;
+  for (int k = 0; k < N; ++k) {
+    for (int c = 0; c < NUM_AXIS; ++c) {
+      for (int d = 0; d < NUM_AXIS; ++d) {
+        double sum = 0;
+        for (int i = 0; i < NUM_WHEEL; ++i) {
+          sum += wheel_[i][c] * wheel_[i][d];
+        }
+        matrix[(c * N + k) * n_ + d * N + k] += scale * sum;
+      }
+    }
+  }
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    for (int k = 0; k < N; ++k) {
+      int i = c * N + k;
+      matrix[i * n_ + i] += scale;
+      if (k > 0) {
+        matrix[(i - 1) * n_ + i - 1] += scale;
+        matrix[i * n_ + i - 1] -= scale;
+        matrix[(i - 1) * n_ + i] -= scale;
+      }
+    }
+  }
+  for (int k = 0; k < N; ++k) {
+    int i = 2 * N + k;
+    matrix[i * n_ + i] += scale;
+  }
+}
+
+// (H + σI + ρA^T A)をコレスキー分解してkkt_の下三角に入れる
+// 駆動輪の制約が向きで変わるので毎回作り直す(変数は3 * horizon個だけ)
+bool MpcTracker::factorize() {
+  const int N = config_.horizon;
+  std::fill(kkt_.begin(), kkt_.end(), 0);
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    for (int i = 0; i < N; ++i) {
+      for (int j = 0; j < N; ++j) {
+        kkt_[(c * N + i) * n_ + c * N + j] = hessian_[i * N + j];
+      }
+    }
+  }
+  for (int i = 0; i < n_; ++i) {
+    kkt_[i * n_ + i] += SIGMA;
+  }
+  addAtA(kkt_, RHO);
+  for (int j = 0; j < n_; ++j) {
+    double diagonal = kkt_[j * n_ + j];
+    for (int k = 0; k < j; ++k) {
+      diagonal -= kkt_[j * n_ + k] * kkt_[j * n_ + k];
+    }
+    if (diagonal <= 0) {
+      return false;
+    }
+    diagonal = std::sqrt(diagonal);
+    kkt_[j * n_ + j] = diagonal;
+    for (int i = j + 1; i < n_; ++i) {
+      double sum = kkt_[i * n_ + j];
+      for (int k = 0; k < j; ++k) {
+        sum -= kkt_[i * n_ + k] * kkt_[j * n_ + k];
+      }
+      kkt_[i * n_ + j] = sum / diagonal;
+    }
+  }
+  return true;
+}
+
+void MpcTracker::solveFactor(std::vector<double> &x) const {
+  for (int i = 0; i < n_; ++i) {
+    double sum = x[i];
+    for (int k = 0; k < i; ++k) {
+      sum -= kkt_[i * n_ + k] * x[k];
+    }
+    x[i] = sum / kkt_[i * n_ + i];
+  }
+  for (int i = n_ - 1; i >= 0; --i) {
+    double sum = x[i];
+    for (int k = i + 1; k < n_; ++k) {
+      sum -= kkt_[k * n_ + i] * x[k];
+    }
+    x[i] = sum / kkt_[i * n_ + i];
+  }
+}
+
+// 反復が途中で終わった時も, 最初の段の指令は必ず制限の中に入れる
+// 前の指令から解へ向かう線分の上で, 駆動輪の制限に当たる所までにする
+void MpcTracker::clip(double velocity[NUM_AXIS], double period) const {
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    double change = config_.accel_max * period;
+    velocity[c] =
+        clamp(velocity[c], command_[c] - change, command_[c] + change);
+  }
+  velocity[2] = clamp(velocity[2], -config_.omega_max, config_.omega_max);
+  const double limit = config_.wheel_velocity_max;
+  double ratio = 1, wheel_max = 0;
+  for (int i = 0; i < NUM_WHEEL; ++i) {
+    double from = 0, to = 0;
+    for (int c = 0; c < NUM_AXIS; ++c) {
+      from += wheel_[i][c] * command_[c];
+      to += wheel_[i][c] * velocity[c];
+    }
+    if (std::fabs(to) > limit) {
+      double bound = to > 0 ? limit : -limit;
+      ratio = std::min(ratio, std::fabs(from) < limit
+                                  ? (bound - from) / (to - from)
+                                  : 0.0);
+    }
+  }
+  for (int c = 0; c < NUM_AXIS; ++c) {
+    velocity[c] = command_[c] + ratio * (velocity[c] - command_[c]);
+  }
+  // 向きが変わって前の指令も制限の外なら, 全体を縮める
+  for (int i = 0; i < NUM_WHEEL; ++i) {
+    double wheel = 0;
+    for (int c = 0; c < NUM_AXIS; ++c) {
+      wheel += wheel_[i][c] * velocity[c];
+    }
+    wheel_max = std::max(wheel_max, std::fabs(wheel));
+  }
+  if (wheel_max > limit) {
+    for (int c = 0; c < NUM_AXIS; ++c) {
+      velocity[c] *= limit / wheel_max;
+    }
+  }
+}
+} // namespace robot_plan
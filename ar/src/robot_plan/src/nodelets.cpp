@@ -0,0 +1,51 @@
+#include <atomic>
+#include <nodelet/nodelet.h>
+#include <planner.hpp>
+#include <pluginlib/class_list_macros.h>
+#include <ros/ros.h>
+#include <thread>
+
+// dead_reckoningと同じプロセスで動かして, robot_poseなどをコピー無しで受け取る
+// ループはノードの時と同じものを専用のスレッドで回す
+namespace robot_plan {
+class LocalPlanner : public nodelet::Nodelet {
+public:
+  ~LocalPlanner() {
+    running_ = false;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+private:
+  void onInit() override {
+    running_ = true;
+    thread_ =
+        std::thread([this] { local_planner::run(getNodeHandle(), running_); });
+  }
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+class MotionPlanner : public nodelet::Nodelet {
+public:
+  ~MotionPlanner() {
+    running_ = false;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+private:
+  void onInit() override {
+    running_ = true;
+    thread_ =
+        std::thread([this] { motion_planner::run(getNodeHandle(), running_); });
+  }
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+} // namespace robot_plan
+
+PLUGINLIB_EXPORT_CLASS(robot_plan::LocalPlanner, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(robot_plan::MotionPlanner, nodelet::Nodelet)
@@ -0,0 +1,60 @@
+#include <periodic_timer.hpp>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+namespace robot_plan {
+namespace {
+constexpr int64_t NANO = 1000000000;
+
+int64_t now() {
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * NANO + time.tv_nsec;
+}
+
+void sleepUntil(int64_t deadline) {
+  timespec time;
+  time.tv_sec = deadline / NANO;
+  time.tv_nsec = deadline % NANO;
+  // シグナルで起こされたら同じ時刻まで眠り直す
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr) != 0) {
+  }
+}
+} // namespace
+
+PeriodicTimer::PeriodicTimer(double rate)
+    : period_(NANO / rate), deadline_(now() + period_), wake_(now()) {}
+
+void PeriodicTimer::wait() {
+  int64_t start = now();
+  double exec = (start - wake_) * 1.0e-9;
+  if (start < deadline_) {
+    sleepUntil(deadline_);
+    wake_ = now();
+  } else {
+    ++stats_.overruns;
+    // 遅れを取り戻そうとして続けて回らないように, 今から数え直す
+    deadline_ = start;
+    wake_ = start;
+  }
+  double jitter = (wake_ - deadline_) * 1.0e-9;
+  deadline_ += period_;
+
+  ++stats_.cycles;
+  stats_.jitter_mean += (jitter - stats_.jitter_mean) / stats_.cycles;
+  stats_.exec_mean += (exec - stats_.exec_mean) / stats_.cycles;
+  if (jitter > stats_.jitter_max) {
+    stats_.jitter_max = jitter;
+  }
+  if (exec > stats_.exec_max) {
+    stats_.exec_max = exec;
+  }
+}
+
+bool setRealtimePriority(int priority) {
+  sched_param param = {};
+  param.sched_priority = priority;
+  return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+} // namespace robot_plan
@@ -0,0 +1,161 @@
+#include <cmath>
+#include <s_curve.hpp>
+
+namespace robot_plan {
+namespace {
+inline double pow2(double x) { return x * x; }
+constexpr int SOLVE_ITERATION = 20;
+constexpr double SOLVE_TOLERANCE = 1.0e-6;
+} // namespace
+
+void SCurve::set(double start_position, double distance, double velocity_first,
+                 double velocity_max, double velocity_final, double accel_max) {
+  // 距離が短くて最高速度が初速か終速を下回る時は, 元の式だと加速の向きが逆になって
+  // 位置が飛ぶ. 加速度を上げて減速(か加速)だけでちょうど進むようにする
+  if (distance > 0 && std::fabs(velocity_max) < std::fabs(velocity_first)) {
+    velocity_max = velocity_first;
+    accel_max = (pow2(velocity_first) - pow2(velocity_final)) / distance *
+                (velocity_first < 0 ? -1 : 1);
+  } else if (distance > 0 &&
+             std::fabs(velocity_max) < std::fabs(velocity_final)) {
+    velocity_max = velocity_final;
+    accel_max = (pow2(velocity_final) - pow2(velocity_first)) / distance *
+                (velocity_final < 0 ? -1 : 1);
+  }
+  start_position_ = start_position;
+  velocity_first_ = velocity_first;
+  velocity_max_ = velocity_max;
+  velocity_final_ = velocity_final;
+  accel_max_ = accel_max;
+  accel_time_ = 2 * std::fabs((velocity_max - velocity_first) / accel_max);
+  const_time_ = (distance - (2 * pow2(velocity_max) -
+                             (pow2(velocity_first) + pow2(velocity_final))) /
+                                std::fabs(accel_max)) /
+                    std::fabs(velocity_max) +
+                accel_time_;
+  decel_time_ =
+      2 * std::fabs((velocity_max - velocity_final) / accel_max) + const_time_;
+  direction_ = velocity_max < 0 ? -1 : 1;
+  accel_position_ = relativePosition(accel_time_);
+  const_position_ = relativePosition(const_time_);
+  decel_position_ = relativePosition(decel_time_);
+}
+
+void SCurve::stay(double position) {
+  start_position_ = position;
+  velocity_first_ = velocity_max_ = velocity_final_ = accel_max_ = 0;
+  accel_time_ = const_time_ = decel_time_ = 0;
+  accel_position_ = const_position_ = decel_position_ = 0;
+  direction_ = 1;
+}
+
+// 区間の分け方は時刻順に 加速 -> 等速 -> 減速
+// 距離が足りずに等速の終わりが加速の終わりより前になっても同じ順で判定する
+double SCurve::relativePosition(double time) const {
+  const double a = accel_max_, v_0 = velocity_first_, v_m = velocity_max_;
+  // 加速が終わるまでに進む距離
+  const double accel_distance =
+      pow2(v_m - v_0) / a + 2 * v_0 * (v_m - v_0) / a;
+  if (time < accel_time_) {
+    return a * pow2(accel_time_) / (8 * pow2(M_PI)) *
+               (std::cos(2 * M_PI / accel_time_ * time) - 1) +
+           a * pow2(time) / 4 + v_0 * time;
+  } else if (time < const_time_) {
+    return v_m * (time - accel_time_) + accel_distance;
+  }
+  const double period = decel_time_ - const_time_;
+  time -= const_time_;
+  return -a * pow2(period) / (8 * pow2(M_PI)) *
+             (std::cos(2 * M_PI / period * time) - 1) -
+         a * pow2(time) / 4 + v_m * time + v_m * (const_time_ - accel_time_) +
+         accel_distance;
+}
+
+double SCurve::position(double time) const {
+  if (time <= 0) {
+    return start_position_;
+  } else if (time >= decel_time_) {
+    return start_position_ + decel_position_;
+  }
+  return start_position_ + relativePosition(time);
+}
+
+double SCurve::velocity(double time) const {
+  if (time <= 0) {
+    return decel_time_ > 0 ? velocity_first_ : 0;
+  } else if (time >= decel_time_) {
+    return velocity_final_;
+  }
+  const double a = accel_max_;
+  if (time < accel_time_) {
+    return -a * accel_time_ / (4 * M_PI) *
+               std::sin(2 * M_PI / accel_time_ * time) +
+           a * time / 2 + velocity_first_;
+  } else if (time < const_time_) {
+    return velocity_max_;
+  }
+  const double period = decel_time_ - const_time_;
+  time -= const_time_;
+  return a * period / (4 * M_PI) * std::sin(2 * M_PI / period * time) -
+         a * time / 2 + velocity_max_;
+}
+
+double SCurve::acceleration(double time) const {
+  if (time <= 0 || time >= decel_time_) {
+    return 0;
+  }
+  const double a = accel_max_;
+  if (time < accel_time_) {
+    return a / 2 * (1 - std::cos(2 * M_PI / accel_time_ * time));
+  } else if (time < const_time_) {
+    return 0;
+  }
+  const double period = decel_time_ - const_time_;
+  return -a / 2 * (1 - std::cos(2 * M_PI / period * (time - const_time_)));
+}
+
+double SCurve::timeAt(double position) const {
+  const double target = position - start_position_;
+  if (decel_time_ <= 0 || direction_ * target <= 0) {
+    return 0;
+  } else if (direction_ * target >= direction_ * decel_position_) {
+    return decel_time_;
+  }
+  // 区間の境目の位置と比べて, 探す区間を1つに絞る
+  if (accel_time_ < const_time_) {
+    if (direction_ * target < direction_ * accel_position_) {
+      return solve(target, 0, accel_time_);
+    } else if (direction_ * target < direction_ * const_position_) {
+      return accel_time_ + (target - accel_position_) / velocity_max_;
+    }
+    return solve(target, const_time_, decel_time_);
+  }
+  return solve(target, 0, decel_time_);
+}
+
+// 挟み込みながらニュートン法, 繰り返しは固定回数なので計算量は一定
+double SCurve::solve(double target, double time_min, double time_max) const {
+  // 区間の両端の位置から直線で当たりを付ける
+  double position_min = relativePosition(time_min);
+  double position_max = relativePosition(time_max);
+  double time = position_max != position_min
+                    ? time_min + (time_max - time_min) * (target - position_min) /
+                                     (position_max - position_min)
+                    : time_min;
+  for (int i = 0; i < SOLVE_ITERATION; ++i) {
+    double error = relativePosition(time) - target;
+    if (std::fabs(error) < SOLVE_TOLERANCE) {
+      break;
+    }
+    if (direction_ * error > 0) {
+      time_max = time;
+    } else {
+      time_min = time;
+    }
+    double v = velocity(time);
+    double next = v != 0 ? time - error / v : time_min - 1;
+    time = time_min < next && next < time_max ? next : (time_min + time_max) / 2;
+  }
+  return time;
+}
+} // namespace robot_plan
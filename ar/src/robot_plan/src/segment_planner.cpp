@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cmath>
+#include <segment_planner.hpp>
+
+namespace robot_plan {
+namespace {
+inline double pow2(double x) { return x * x; }
+// これより近い点は同じ点として扱う
+constexpr double SAME_POINT_DISTANCE = 1.0;
+} // namespace
+
+// goal_velocityの指定がなく目標点を通過するだけなら,
+// 先の点までの形から角を曲がれる速さを決めてその速さで通り抜ける
+void SegmentPlanner::blend(Segment &segment,
+                           const std::vector<Waypoint> &pass_waypoints) const {
+  if (segment.velocity_final[0] != 0 || segment.velocity_final[1] != 0 ||
+      pass_waypoints.size() < 2 ||
+      std::hypot(pass_waypoints.front().x - segment.goal.x,
+                 pass_waypoints.front().y - segment.goal.y) >
+          SAME_POINT_DISTANCE) {
+    return;
+  }
+  std::vector<Waypoint> points = {{segment.start.x, segment.start.y}};
+  points.insert(points.end(), pass_waypoints.begin(), pass_waypoints.end());
+  double velocity_first =
+      std::hypot(segment.velocity_prev[0], segment.velocity_prev[1]);
+  if (velocity_first < config.velocity_min) {
+    velocity_first = config.velocity_min;
+  }
+  double speed =
+      blendVelocities(points, velocity_first, config.velocity_max,
+                      segment.accel, config.blend_distance)[1];
+  double angle = std::atan2(segment.goal.y - segment.start.y,
+                            segment.goal.x - segment.start.x);
+  segment.velocity_final[0] = speed * std::cos(angle);
+  segment.velocity_final[1] = speed * std::sin(angle);
+}
+
+void SegmentPlanner::plan(Segment &segment) const {
+  if (config.is_jerk_mode) {
+    planTrajectory(segment);
+  } else {
+    planSCurve(segment);
+  }
+}
+
+void SegmentPlanner::planSCurve(Segment &segment) const {
+  const Pose &start = segment.start, &goal = segment.goal;
+  double dummy_distance = std::hypot(goal.x - start.x, goal.y - start.y);
+  double angle = std::atan2(goal.y - start.y, goal.x - start.x);
+  double dummy_goal_velocity =
+      std::hypot(segment.velocity_final[0], segment.velocity_final[1]);
+  double dummy_velocity_max =
+      std::sqrt((pow2(config.velocity_min) + pow2(dummy_goal_velocity) +
+                 segment.accel * dummy_distance) /
+                2);
+  if (dummy_velocity_max > config.velocity_max) {
+    dummy_velocity_max = config.velocity_max;
+  }
+  double velocity_max[2] = {dummy_velocity_max * std::cos(angle),
+                            dummy_velocity_max * std::sin(angle)};
+  double velocity_first[2] = {config.velocity_min * std::cos(angle),
+                              config.velocity_min * std::sin(angle)};
+  for (int i = 0; i < 2; ++i) {
+    if (velocity_first[i] > 0 && velocity_first[i] < segment.velocity_prev[i]) {
+      velocity_first[i] = segment.velocity_prev[i];
+    } else if (velocity_first[i] < 0 &&
+               velocity_first[i] > segment.velocity_prev[i]) {
+      velocity_first[i] = segment.velocity_prev[i];
+    }
+  }
+  double accel_max[2] = {segment.accel * std::cos(angle),
+                         segment.accel * std::sin(angle)};
+
+  double distance[2] = {dummy_distance * std::fabs(std::cos(angle)),
+                        dummy_distance * std::fabs(std::sin(angle))};
+  double dummy_start[2] = {start.x, start.y};
+  for (int i = 0; i < 2; ++i) {
+    if (distance[i] > config.error_distance) {
+      segment.curve[i].set(dummy_start[i], distance[i], velocity_first[i],
+                           velocity_max[i], segment.velocity_final[i],
+                           accel_max[i]);
+    } else {
+      segment.curve[i].stay(dummy_start[i]);
+    }
+  }
+}
+
+// 直線上の道のりで速度計画を立てるので, 速度と加速度の制限は合成した大きさにかかる
+void SegmentPlanner::planTrajectory(Segment &segment) const {
+  const Pose &start = segment.start, &goal = segment.goal;
+  double distance = std::hypot(goal.x - start.x, goal.y - start.y);
+  double velocity_first =
+      std::hypot(segment.velocity_prev[0], segment.velocity_prev[1]);
+  if (velocity_first < config.velocity_min) {
+    velocity_first = config.velocity_min;
+  }
+  double goal_velocity_norm =
+      std::hypot(segment.velocity_final[0], segment.velocity_final[1]);
+  if (distance > config.error_distance) {
+    segment.trajectory.set(
+        start.x, start.y, start.theta, goal.x, goal.y, goal.theta,
+        velocity_first, goal_velocity_norm,
+        JerkLimit{config.velocity_max, segment.accel, config.jerk_max},
+        config.omega_max);
+  } else {
+    segment.trajectory.stay(start.x, start.y, goal.theta);
+  }
+}
+
+void SegmentPlanner::precompute(const std::vector<double> &mission) {
+  cache_.clear();
+  int num_goal = mission.size() / MISSION_FIELDS;
+  std::vector<Waypoint> pass_waypoints;
+  Segment segment;
+  for (int i = 0; i < num_goal; ++i) {
+    const double *goal = &mission[i * MISSION_FIELDS];
+    if (i == 0 || goal[0] != mission[(i - 1) * MISSION_FIELDS]) {
+      // 経路の最初の点はスタート位置で, そこに止まっているところから始まる
+      segment.start = Pose{goal[1], goal[2], goal[3]};
+      segment.velocity_final[0] = segment.velocity_final[1] = 0;
+    } else {
+      segment.start = reachPose(segment);
+    }
+    segment.velocity_prev[0] = segment.velocity_final[0];
+    segment.velocity_prev[1] = segment.velocity_final[1];
+    segment.goal = Pose{goal[1], goal[2], goal[3]};
+    segment.accel = goal[4];
+    segment.velocity_final[0] = goal[5];
+    segment.velocity_final[1] = goal[6];
+    // motion_plannerがこの目標点と一緒に送る列と同じもの
+    pass_waypoints.clear();
+    for (int j = i; j < num_goal; ++j) {
+      const double *next = &mission[j * MISSION_FIELDS];
+      if (next[0] != goal[0]) {
+        break;
+      }
+      pass_waypoints.push_back({next[1], next[2]});
+      if (next[7] == 0) {
+        break;
+      }
+    }
+    blend(segment, pass_waypoints);
+    plan(segment);
+    cache_.push_back(segment);
+  }
+}
+
+// 計画した軌道を制御周期の刻みで進み, 目標点からreach_distance以内に入った所
+// motion_plannerはそこで次の目標点を送るので, 次の区間はそこから始まる
+Pose SegmentPlanner::reachPose(const Segment &segment) const {
+  constexpr double STEP = 0.01;
+  const Pose &goal = segment.goal;
+  double total_time =
+      config.is_jerk_mode ? segment.trajectory.totalTime()
+                          : std::max(segment.curve[0].totalTime(),
+                                     segment.curve[1].totalTime());
+  Pose pose = segment.start;
+  for (double time = 0;; time += STEP) {
+    time = std::min(time, total_time);
+    if (config.is_jerk_mode) {
+      TrajectoryPoint point = segment.trajectory.at(time);
+      pose = Pose{point.x, point.y, point.theta};
+    } else {
+      pose = Pose{segment.curve[0].position(time),
+                  segment.curve[1].position(time), goal.theta};
+    }
+    if (std::hypot(goal.x - pose.x, goal.y - pose.y) < config.reach_distance ||
+        time >= total_time) {
+      return pose;
+    }
+  }
+}
+
+const Segment *SegmentPlanner::find(const Segment &segment) const {
+  for (const Segment &cached : cache_) {
+    if (std::hypot(cached.goal.x - segment.goal.x,
+                   cached.goal.y - segment.goal.y) < SAME_POINT_DISTANCE &&
+        std::fabs(std::remainder(cached.goal.theta - segment.goal.theta,
+                                 2 * M_PI)) < config.cache_angle &&
+        cached.accel == segment.accel &&
+        std::hypot(cached.start.x - segment.start.x,
+                   cached.start.y - segment.start.y) < config.cache_distance &&
+        std::fabs(std::remainder(cached.start.theta - segment.start.theta,
+                                 2 * M_PI)) < config.cache_angle &&
+        std::hypot(cached.velocity_prev[0] - segment.velocity_prev[0],
+                   cached.velocity_prev[1] - segment.velocity_prev[1]) <
+            config.cache_velocity &&
+        std::hypot(cached.velocity_final[0] - segment.velocity_final[0],
+                   cached.velocity_final[1] - segment.velocity_final[1]) <
+            config.cache_velocity) {
+      return &cached;
+    }
+  }
+  return nullptr;
+}
+
+void SegmentFollower::set(const Segment &segment, bool is_jerk_mode) {
+  segment_ = segment;
+  is_jerk_mode_ = is_jerk_mode;
+  curve_time_[0] = curve_time_[1] = trajectory_time_ = 0;
+}
+
+void SegmentFollower::stay(const Pose &pose, bool is_jerk_mode) {
+  segment_.start = segment_.goal = pose;
+  segment_.curve[0].stay(pose.x);
+  segment_.curve[1].stay(pose.y);
+  segment_.trajectory.stay(pose.x, pose.y, pose.theta);
+  is_jerk_mode_ = is_jerk_mode;
+  curve_time_[0] = curve_time_[1] = trajectory_time_ = 0;
+}
+
+TrajectoryPoint SegmentFollower::follow(const Pose &current, double period) {
+  if (is_jerk_mode_) {
+    const Trajectory2D &trajectory = segment_.trajectory;
+    trajectory_time_ =
+        nextTime(trajectory.timeAt(current.x, current.y), trajectory_time_,
+                 trajectory.totalTime(), period);
+    return trajectory.at(trajectory_time_);
+  }
+  TrajectoryPoint point = {};
+  double dummy_current[2] = {current.x, current.y};
+  double *position[2] = {&point.x, &point.y};
+  double *velocity[2] = {&point.vx, &point.vy};
+  double *accel[2] = {&point.ax, &point.ay};
+  for (int i = 0; i < 2; ++i) {
+    const SCurve &curve = segment_.curve[i];
+    curve_time_[i] = nextTime(curve.timeAt(dummy_current[i]), curve_time_[i],
+                              curve.totalTime(), period);
+    *position[i] = curve.position(curve_time_[i]);
+    *velocity[i] = curve.velocity(curve_time_[i]);
+    *accel[i] = curve.acceleration(curve_time_[i]);
+  }
+  point.theta = segment_.goal.theta;
+  return point;
+}
+
+TrajectoryPoint SegmentFollower::preview(double offset) const {
+  if (is_jerk_mode_) {
+    const Trajectory2D &trajectory = segment_.trajectory;
+    return trajectory.at(
+        std::min(trajectory_time_ + offset, trajectory.totalTime()));
+  }
+  TrajectoryPoint point = {};
+  double *position[2] = {&point.x, &point.y};
+  double *velocity[2] = {&point.vx, &point.vy};
+  double *accel[2] = {&point.ax, &point.ay};
+  for (int i = 0; i < 2; ++i) {
+    const SCurve &curve = segment_.curve[i];
+    double time = std::min(curve_time_[i] + offset, curve.totalTime());
+    *position[i] = curve.position(time);
+    *velocity[i] = curve.velocity(time);
+    *accel[i] = curve.acceleration(time);
+  }
+  point.theta = segment_.goal.theta;
+  return point;
+}
+
+double SegmentFollower::nextTime(double time, double prev_time,
+                                 double total_time, double period) const {
+  double search_range = SEARCH_RANGE * period;
+  if (time < prev_time - search_range) {
+    time = prev_time - search_range;
+  } else if (time > prev_time + search_range) {
+    time = prev_time + search_range;
+  }
+  return std::min(time + period, total_time);
+}
+} // namespace robot_plan
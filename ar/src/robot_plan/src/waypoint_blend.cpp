@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <cmath>
+#include <waypoint_blend.hpp>
+
+namespace robot_plan {
+namespace {
+// これより近い点は同じ点として扱う
+constexpr double SAME_POINT_DISTANCE = 1.0;
+} // namespace
+
+std::vector<double> blendVelocities(const std::vector<Waypoint> &points,
+                                    double velocity_first, double velocity_max,
+                                    double accel_max, double blend_distance) {
+  std::vector<double> velocity(points.size(), 0);
+  if (points.size() < 2) {
+    return velocity;
+  }
+  // 同じ位置に続けて置かれた点(その場で昇降するだけなど)はまとめる
+  std::vector<Waypoint> corner;
+  std::vector<int> corner_id(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (corner.empty() ||
+        std::hypot(points[i].x - corner.back().x,
+                   points[i].y - corner.back().y) > SAME_POINT_DISTANCE) {
+      corner.push_back(points[i]);
+    }
+    corner_id[i] = corner.size() - 1;
+  }
+
+  int n = corner.size();
+  std::vector<double> speed(n, velocity_max);
+  std::vector<double> length(n, 0); // corner[k]からcorner[k + 1]まで
+  for (int k = 0; k + 1 < n; ++k) {
+    length[k] =
+        std::hypot(corner[k + 1].x - corner[k].x, corner[k + 1].y - corner[k].y);
+  }
+  speed[0] = velocity_first;
+  speed[n - 1] = 0;
+  // 角: 速度ベクトルの変化2v sin(θ/2)を, blend_distance / vの間に加速度accel_maxで
+  for (int k = 1; k + 1 < n; ++k) {
+    double in = std::atan2(corner[k].y - corner[k - 1].y,
+                           corner[k].x - corner[k - 1].x);
+    double out = std::atan2(corner[k + 1].y - corner[k].y,
+                            corner[k + 1].x - corner[k].x);
+    double turn = std::fabs(std::sin(std::remainder(out - in, 2 * M_PI) / 2));
+    if (turn > 1.0e-6) {
+      speed[k] = std::min(
+          speed[k], std::sqrt(accel_max * blend_distance / (2 * turn)));
+    }
+  }
+  // 後ろから: 次の点の速さまで落としきれる
+  for (int k = n - 2; k > 0; --k) {
+    speed[k] = std::min(
+        speed[k], std::sqrt(speed[k + 1] * speed[k + 1] + accel_max * length[k]));
+  }
+  // 前から: 前の点の速さから上げきれる
+  for (int k = 1; k + 1 < n; ++k) {
+    speed[k] = std::min(speed[k], std::sqrt(speed[k - 1] * speed[k - 1] +
+                                            accel_max * length[k - 1]));
+  }
+
+  for (size_t i = 0; i < points.size(); ++i) {
+    velocity[i] = speed[corner_id[i]];
+  }
+  // 今の位置と同じ点は今の速さのまま
+  for (size_t i = 0; i < points.size() && corner_id[i] == 0; ++i) {
+    velocity[i] = velocity_first;
+  }
+  return velocity;
+}
+} // namespace robot_plan
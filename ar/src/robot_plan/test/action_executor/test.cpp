@@ -0,0 +1,191 @@
+#include "../../include/action_executor.hpp"
+#include "../check.hpp"
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace motion_planner;
+using namespace robot_plan_test;
+using namespace std;
+
+double since(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// 返信にtime[s]かかるサービスの代わり
+ActionExecutor::Task reply(double time, int value, bool ok = true) {
+  return [=](int &data) {
+    this_thread::sleep_for(chrono::duration<double>(time));
+    data = value;
+    return ok;
+  };
+}
+
+// 全部のchannelが空になるまでpollする
+void pollUntilIdle(ActionExecutor &executor, int num_channel) {
+  auto start = chrono::steady_clock::now();
+  while (since(start) < 2) {
+    executor.poll();
+    bool is_idle = true;
+    for (int i = 0; i < num_channel; ++i) {
+      is_idle = is_idle && executor.idle(i);
+    }
+    if (is_idle) {
+      executor.poll();
+      return;
+    }
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+}
+
+int main() {
+  // startはすぐ戻り, 違うchannelは並行に進む
+  {
+    ActionExecutor executor(2);
+    vector<int> done;
+    thread::id main_id = this_thread::get_id();
+    bool is_main_thread = true;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < 2; ++i) {
+      executor.start(i, reply(0.1, 10 + i), 1.0,
+                     [&, i](ActionStatus status, int data) {
+                       check(status == ActionStatus::DONE, "done", i, 0);
+                       check(data == 10 + i, "data", data, 10 + i);
+                       is_main_thread =
+                           is_main_thread && this_thread::get_id() == main_id;
+                       done.push_back(i);
+                     });
+    }
+    check(since(start) < 0.02, "start returns", since(start), 0);
+    pollUntilIdle(executor, 2);
+    check(since(start) < 0.18, "parallel", since(start), 0.1);
+    check(done.size() == 2, "callbacks", done.size(), 2);
+    check(is_main_thread, "callback thread", 0, 0);
+    check(executor.status(0) == ActionStatus::DONE && executor.data(1) == 11,
+          "status", (int)executor.status(0), executor.data(1));
+  }
+
+  // 同じchannelは足した順に1つずつ. 結果を取りこぼさない
+  {
+    ActionExecutor executor(1);
+    vector<int> order;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < 3; ++i) {
+      executor.start(0, reply(0.03, i), 1.0,
+                     [&](ActionStatus, int data) { order.push_back(data); });
+    }
+    this_thread::sleep_for(chrono::milliseconds(150));
+    pollUntilIdle(executor, 1);
+    check(since(start) >= 0.09, "serial", since(start), 0.09);
+    check(order == vector<int>({0, 1, 2}), "order", order.size(), 3);
+  }
+
+  // 失敗と時間切れ. 時間切れの後に戻ってきた結果は捨てる
+  {
+    ActionExecutor executor(2);
+    ActionStatus failed = ActionStatus::IDLE, timeout = ActionStatus::IDLE;
+    int num_callback = 0;
+    executor.start(0, reply(0.01, 0, false), 1.0, [&](ActionStatus status, int) {
+      failed = status;
+      ++num_callback;
+    });
+    executor.start(1, reply(0.2, 5), 0.05, [&](ActionStatus status, int) {
+      timeout = status;
+      ++num_callback;
+    });
+    auto start = chrono::steady_clock::now();
+    while (timeout == ActionStatus::IDLE && since(start) < 1) {
+      executor.poll();
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    check(since(start) < 0.15, "timeout early", since(start), 0.05);
+    check(!executor.idle(1), "busy after timeout", 0, 0);
+    pollUntilIdle(executor, 2);
+    check(failed == ActionStatus::FAILED, "failed", (int)failed, 0);
+    check(timeout == ActionStatus::TIMEOUT, "timeout", (int)timeout, 0);
+    check(executor.status(1) == ActionStatus::TIMEOUT, "late result",
+          (int)executor.status(1), 0);
+    check(num_callback == 2, "callback once", num_callback, 2);
+  }
+
+  // 状態を読んで待つ: 続けて条件を満たすまで. 途中で外れたら数え直す
+  {
+    ActionExecutor executor(1);
+    vector<int> readings = {0, 1, 0, 1, 1, 1, 0};
+    size_t read_count = 0;
+    ActionStatus status = ActionStatus::IDLE;
+    executor.waitUntil(0,
+                       [&](int &data) {
+                         data = readings[read_count++ % readings.size()];
+                         return data == 1;
+                       },
+                       0.005, 2, 1.0,
+                       [&](ActionStatus result, int) { status = result; });
+    pollUntilIdle(executor, 1);
+    check(status == ActionStatus::DONE, "wait done", (int)status, 0);
+    check(read_count == 5, "settle", read_count, 5);
+
+    // 満たされなければ時間切れ. pollを呼ばなくても読むのをやめる
+    read_count = 0;
+    status = ActionStatus::IDLE;
+    executor.waitUntil(0,
+                       [&](int &data) {
+                         ++read_count;
+                         return false;
+                       },
+                       0.005, 1, 0.05,
+                       [&](ActionStatus result, int) { status = result; });
+    this_thread::sleep_for(chrono::milliseconds(150));
+    size_t stopped_count = read_count;
+    check(executor.idle(0), "wait stops", read_count, 0);
+    this_thread::sleep_for(chrono::milliseconds(30));
+    check(read_count == stopped_count, "no more read", read_count,
+          stopped_count);
+    executor.poll();
+    check(status == ActionStatus::TIMEOUT, "wait timeout", (int)status, 0);
+
+    // 待っている間でも壊せる
+    executor.waitUntil(0, [](int &) { return false; }, 10, 1, 100);
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+
+  // 取り消し: 待っている指令は捨て, 実行中の結果は使わない. 読んで待つのはすぐ戻る
+  {
+    ActionExecutor executor(3);
+    executor.start(2, reply(0, 7), 1.0);
+    pollUntilIdle(executor, 3);
+    int num_canceled = 0, num_other = 0;
+    auto count = [&](ActionStatus status, int) {
+      status == ActionStatus::CANCELED ? ++num_canceled : ++num_other;
+    };
+    executor.start(0, reply(0.1, 1), 1.0, count);
+    executor.start(0, reply(0.01, 2), 1.0, count);
+    executor.start(0, reply(0.01, 3), 1.0, count);
+    executor.waitUntil(1, [](int &) { return false; }, 0.05, 1, 10, count);
+    this_thread::sleep_for(chrono::milliseconds(20));
+    auto start = chrono::steady_clock::now();
+    executor.cancel();
+    while (!executor.idle(1) && since(start) < 1) {
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    check(since(start) < 0.02, "cancel wait", since(start), 0);
+    check(!executor.idle(0), "busy until return", 0, 0);
+    pollUntilIdle(executor, 3);
+    check(num_canceled == 4 && num_other == 0, "cancel callbacks",
+          num_canceled, num_other);
+    check(executor.status(0) == ActionStatus::CANCELED &&
+              executor.status(1) == ActionStatus::CANCELED,
+          "cancel status", (int)executor.status(0), (int)executor.status(1));
+    check(executor.status(2) == ActionStatus::DONE, "idle not canceled",
+          (int)executor.status(2), 0);
+
+    // 取り消した後の指令は普通に進む
+    executor.start(0, reply(0.01, 4), 1.0, count);
+    pollUntilIdle(executor, 3);
+    check(executor.status(0) == ActionStatus::DONE && executor.data(0) == 4,
+          "after cancel", (int)executor.status(0), executor.data(0));
+  }
+
+  return result();
+}
@@ -0,0 +1,373 @@
+// robot_planの計算部分の速さを測る. ROSもmasterも要らない
+// 1回あたりの時間[ns]と, 1回あたりにnewした回数を出す
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <goal_manager.hpp>
+#include <mpc_tracker.hpp>
+#include <new>
+#include <random>
+#include <segment_planner.hpp>
+#include <vector>
+
+using namespace robot_plan;
+using namespace motion_planner;
+
+namespace {
+long allocations = 0;
+}
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  void *p = std::malloc(size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+// 最適化で計算が消えないように結果をここに足す
+volatile double sink = 0;
+
+template <class F> void bench(const char *name, int num_op, F func) {
+  func(num_op / 10); // 温める
+  long allocations_start = allocations;
+  auto start = std::chrono::steady_clock::now();
+  func(num_op);
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  printf("%-28s %10.1f ns/op %8.2f allocs/op\n", name, ns / num_op,
+         (double)(allocations - allocations_start) / num_op);
+}
+
+// コートは12m x 10m, 座標は[mm]
+struct Field {
+  std::mt19937 engine{2019};
+  std::uniform_real_distribution<double> x{0, 12000}, y{0, 10000},
+      theta{-M_PI, M_PI};
+  Pose pose() { return Pose{x(engine), y(engine), theta(engine)}; }
+};
+
+// local_plannerのsetParamと同じ流れ: 角の速さを決め, 作っておいた区間を探し,
+// 無ければ計画する
+void benchSetParam(const char *name, bool is_jerk_mode) {
+  SegmentPlanner planner;
+  planner.config.is_jerk_mode = is_jerk_mode;
+  Field field;
+  constexpr int NUM_GOAL = 1024;
+  std::vector<Segment> segments(NUM_GOAL);
+  std::vector<std::vector<Waypoint>> waypoints(NUM_GOAL);
+  for (int i = 0; i < NUM_GOAL; ++i) {
+    segments[i].start = field.pose();
+    segments[i].goal = field.pose();
+    segments[i].velocity_prev[0] = segments[i].velocity_prev[1] = 0;
+    segments[i].velocity_final[0] = segments[i].velocity_final[1] = 0;
+    segments[i].accel = 1000;
+    // 半分は次の点で止まり, 半分は2点通過してから止まる
+    waypoints[i].push_back({segments[i].goal.x, segments[i].goal.y});
+    for (int j = 0; j < (i % 2) * 2; ++j) {
+      Pose pass = field.pose();
+      waypoints[i].push_back({pass.x, pass.y});
+    }
+  }
+  bench(name, 200000, [&](int num_op) {
+    for (int i = 0; i < num_op; ++i) {
+      Segment segment = segments[i % NUM_GOAL];
+      planner.blend(segment, waypoints[i % NUM_GOAL]);
+      if (planner.find(segment) == nullptr) {
+        planner.plan(segment);
+      }
+      sink = sink + segment.velocity_final[0];
+    }
+  });
+}
+
+// local_plannerのcontrolと同じ流れ: 1周期ごとに軌道上の点を探して指令を出す
+// ロボットは指令通りに動くとして位置を進める
+void benchControl(const char *name, bool is_jerk_mode) {
+  SegmentPlanner planner;
+  planner.config.is_jerk_mode = is_jerk_mode;
+  Field field;
+  constexpr int NUM_GOAL = 256;
+  constexpr double PERIOD = 0.01, ROOT_FOLLOW = 1.7;
+  std::vector<Segment> segments(NUM_GOAL);
+  for (Segment &segment : segments) {
+    segment.start = field.pose();
+    segment.goal = field.pose();
+    segment.velocity_prev[0] = segment.velocity_prev[1] = 0;
+    segment.velocity_final[0] = segment.velocity_final[1] = 0;
+    segment.accel = 1000;
+    planner.plan(segment);
+  }
+  bench(name, 1000000, [&](int num_op) {
+    SegmentFollower follower;
+    Pose current = segments[0].start;
+    int id = 0;
+    follower.set(segments[id], is_jerk_mode);
+    for (int i = 0; i < num_op; ++i) {
+      TrajectoryPoint point = follower.follow(current, PERIOD);
+      current.x += (point.vx + ROOT_FOLLOW * (point.x - current.x)) * PERIOD;
+      current.y += (point.vy + ROOT_FOLLOW * (point.y - current.y)) * PERIOD;
+      current.theta = point.theta;
+      // 500周期(5s)ごとに次の区間へ
+      if (i % 500 == 499) {
+        id = (id + 1) % NUM_GOAL;
+        Pose start = segments[id].start;
+        current = start;
+        follower.set(segments[id], is_jerk_mode);
+      }
+      sink = sink + point.vx;
+    }
+  });
+}
+
+// /ar/local_tracker: mpcの時のcontrol. ロボットは指令に1次遅れで追いつく
+void benchControlMpc() {
+  SegmentPlanner planner;
+  Field field;
+  constexpr int NUM_GOAL = 64;
+  constexpr double PERIOD = 0.01;
+  std::vector<Segment> segments(NUM_GOAL);
+  for (Segment &segment : segments) {
+    segment.start = field.pose();
+    segment.goal = field.pose();
+    segment.goal.theta = segment.start.theta;
+    segment.velocity_prev[0] = segment.velocity_prev[1] = 0;
+    segment.velocity_final[0] = segment.velocity_final[1] = 0;
+    segment.accel = 1000;
+    planner.plan(segment);
+  }
+  MpcTracker tracker;
+  const MpcConfig &config = tracker.config();
+  std::vector<TrajectoryPoint> reference(config.horizon);
+  double solve_time_max = 0;
+  long iterations = 0, num_solve = 0;
+  bench("control mpc", 100000, [&](int num_op) {
+    SegmentFollower follower;
+    Pose current = segments[0].start;
+    double velocity[2] = {};
+    const double lag = 1 - std::exp(-PERIOD / config.motor_lag);
+    int id = 0;
+    follower.set(segments[id], false);
+    tracker.reset();
+    for (int i = 0; i < num_op; ++i) {
+      follower.follow(current, PERIOD);
+      for (int k = 0; k < config.horizon; ++k) {
+        reference[k] = follower.preview((k + 1) * config.step - PERIOD);
+      }
+      const MpcResult &result = tracker.solve(current, reference, PERIOD);
+      for (int c = 0; c < 2; ++c) {
+        velocity[c] += (result.velocity[c] - velocity[c]) * lag;
+      }
+      current.x += velocity[0] * PERIOD;
+      current.y += velocity[1] * PERIOD;
+      solve_time_max = std::max(solve_time_max, result.solve_time);
+      iterations += result.iterations;
+      ++num_solve;
+      if (i % 500 == 499) {
+        id = (id + 1) % NUM_GOAL;
+        current = segments[id].start;
+        velocity[0] = velocity[1] = 0;
+        follower.set(segments[id], false);
+        tracker.reset();
+      }
+      sink = sink + result.velocity[0];
+    }
+  });
+  printf("%-28s %10.1f us max %8.2f iterations/op\n", "  mpc solve",
+         solve_time_max * 1.0e+6, (double)iterations / num_solve);
+}
+
+// motion_plannerと同じ形の経路を作る
+void makeMap(GoalManager &goals, Field &field, int num_goal) {
+  for (int i = 0; i < num_goal; ++i) {
+    Pose pose = field.pose();
+    // 3点に1点は止まって何かする
+    goals.add(pose.x, pose.y, 180, 1000, i % 3 == 2 ? 2 : 0);
+  }
+  goals.restart();
+}
+
+void benchMission() {
+  Field field;
+  constexpr int NUM_MAP = 3, NUM_GOAL = 15;
+  GoalManager goal_map[NUM_MAP] = {GoalManager(1), GoalManager(1),
+                                   GoalManager(1)};
+  std::vector<double> mission;
+  for (int i = 0; i < NUM_MAP; ++i) {
+    makeMap(goal_map[i], field, NUM_GOAL);
+    goal_map[i].appendMission(i, mission);
+  }
+  SegmentPlanner planner;
+  bench("precompute mission", 2000, [&](int num_op) {
+    for (int i = 0; i < num_op; ++i) {
+      planner.precompute(mission);
+      sink = sink + planner.cacheSize();
+    }
+  });
+  // 一番最後の区間で見つかる, 一番遅い場合
+  Segment last;
+  planner.precompute(mission);
+  const double *goal = &mission[mission.size() - SegmentPlanner::MISSION_FIELDS];
+  const double *prev =
+      &mission[mission.size() - 2 * SegmentPlanner::MISSION_FIELDS];
+  last.start = Pose{prev[1], prev[2], prev[3]};
+  last.goal = Pose{goal[1], goal[2], goal[3]};
+  last.velocity_prev[0] = last.velocity_prev[1] = 0;
+  last.velocity_final[0] = last.velocity_final[1] = 0;
+  last.accel = goal[4];
+  bench("cache find (last)", 1000000, [&](int num_op) {
+    for (int i = 0; i < num_op; ++i) {
+      sink = sink + (planner.find(last) != nullptr);
+    }
+  });
+}
+
+// local_plannerを全経路に沿って動かし, 作っておいた区間が使われた割合を数える
+// motion_plannerと同じく目標点から400mm以内に入ったら次の目標点へ進む
+// ロボットは追従の指令に1次遅れ(MOTOR_LAG[s])で追いつく
+void benchCacheHit(double reach_distance, double cache_distance) {
+  constexpr int NUM_MAP = 3, NUM_GOAL = 15, NUM_TRIAL = 10;
+  constexpr double PERIOD = 0.01, ROOT_FOLLOW = 1.7, MOTOR_LAG = 0.1,
+                   REACH_DISTANCE = 400, TIMEOUT = 30;
+  constexpr int F = SegmentPlanner::MISSION_FIELDS;
+  Field field;
+  SegmentPlanner planner;
+  planner.config.reach_distance = reach_distance;
+  planner.config.cache_distance = cache_distance;
+  int num_hit = 0, num_segment = 0;
+  for (int trial = 0; trial < NUM_TRIAL; ++trial) {
+    GoalManager goal_map[NUM_MAP] = {GoalManager(1), GoalManager(1),
+                                     GoalManager(1)};
+    std::vector<double> mission;
+    for (int i = 0; i < NUM_MAP; ++i) {
+      makeMap(goal_map[i], field, NUM_GOAL);
+      goal_map[i].appendMission(i, mission);
+    }
+    planner.precompute(mission);
+    int num_point = mission.size() / F;
+    Pose current = {};
+    double velocity[2] = {}, velocity_final_prev[2] = {};
+    std::vector<Waypoint> waypoints;
+    SegmentFollower follower;
+    for (int i = 0; i < num_point; ++i) {
+      const double *goal = &mission[i * F];
+      if (i == 0 || goal[0] != mission[(i - 1) * F]) {
+        current = Pose{goal[1], goal[2], goal[3]};
+        velocity[0] = velocity[1] = 0;
+        velocity_final_prev[0] = velocity_final_prev[1] = 0;
+      }
+      // local_plannerのsetParamと同じ
+      Segment segment;
+      segment.start = current;
+      segment.goal = Pose{goal[1], goal[2], goal[3]};
+      segment.velocity_prev[0] = velocity_final_prev[0];
+      segment.velocity_prev[1] = velocity_final_prev[1];
+      segment.velocity_final[0] = goal[5];
+      segment.velocity_final[1] = goal[6];
+      segment.accel = goal[4];
+      waypoints.clear();
+      for (int j = i; j < num_point; ++j) {
+        const double *next = &mission[j * F];
+        if (next[0] != goal[0]) {
+          break;
+        }
+        waypoints.push_back({next[1], next[2]});
+        if (next[7] == 0) {
+          break;
+        }
+      }
+      planner.blend(segment, waypoints);
+      const Segment *cached = planner.find(segment);
+      if (cached != nullptr) {
+        segment = *cached;
+        ++num_hit;
+      } else {
+        planner.plan(segment);
+      }
+      ++num_segment;
+      velocity_final_prev[0] = segment.velocity_final[0];
+      velocity_final_prev[1] = segment.velocity_final[1];
+      follower.set(segment, false);
+      const double lag = 1 - std::exp(-PERIOD / MOTOR_LAG);
+      for (double time = 0;
+           time < TIMEOUT && std::hypot(segment.goal.x - current.x,
+                                        segment.goal.y - current.y) >=
+                                 REACH_DISTANCE;
+           time += PERIOD) {
+        TrajectoryPoint point = follower.follow(current, PERIOD);
+        double command[2] = {point.vx + ROOT_FOLLOW * (point.x - current.x),
+                             point.vy + ROOT_FOLLOW * (point.y - current.y)};
+        for (int c = 0; c < 2; ++c) {
+          velocity[c] += (command[c] - velocity[c]) * lag;
+        }
+        current.x += velocity[0] * PERIOD;
+        current.y += velocity[1] * PERIOD;
+        current.theta = point.theta;
+      }
+    }
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "cache hit reach %.0f tol %.0f", reach_distance,
+           cache_distance);
+  printf("%-28s %10.1f %% (%d/%d)\n", name, 100.0 * num_hit / num_segment,
+         num_hit, num_segment);
+}
+
+// motion_plannerが目標点を1つ送るたびにすること
+void benchGoalManager() {
+  Field field;
+  GoalManager goals(1);
+  makeMap(goals, field, 30);
+  std::vector<GoalInfo> pass_goals;
+  bench("GoalManager next+waypoints", 1000000, [&](int num_op) {
+    for (int i = 0; i < num_op; ++i) {
+      goals.passWaypoints(pass_goals);
+      goals.next();
+      if (i % 30 == 29) {
+        goals.restart();
+      }
+      sink = sink + pass_goals.size();
+    }
+  });
+}
+
+void benchReachGoal() {
+  Field field;
+  constexpr int NUM_POSE = 1024;
+  std::vector<Pose> poses(NUM_POSE);
+  for (Pose &pose : poses) {
+    pose = field.pose();
+  }
+  bench("checkReachGoal", 10000000, [&](int num_op) {
+    int reach = 0;
+    for (int i = 0; i < num_op; ++i) {
+      const Pose &goal = poses[i % NUM_POSE],
+                 &current = poses[(i + 1) % NUM_POSE];
+      reach += reachGoal(goal.x, goal.y, goal.theta, current.x, current.y,
+                         current.theta, 400, 10000);
+    }
+    sink = sink + reach;
+  });
+}
+
+int main() {
+  benchSetParam("setParam s_curve", false);
+  benchSetParam("setParam jerk", true);
+  benchControl("control s_curve", false);
+  benchControl("control jerk", true);
+  benchControlMpc();
+  benchMission();
+  // reach 0は目標点にぴったり着いてから次へ進むとして作った場合
+  for (double reach_distance : {0.0, 400.0}) {
+    for (double cache_distance : {100.0, 200.0, 400.0}) {
+      benchCacheHit(reach_distance, cache_distance);
+    }
+  }
+  benchGoalManager();
+  benchReachGoal();
+}
@@ -0,0 +1,25 @@
+#ifndef ROBOT_PLAN_TEST_CHECK_HPP
+#define ROBOT_PLAN_TEST_CHECK_HPP
+#include <iostream>
+
+// robot_planのテストで共通の判定. okでなければnameと比べた値を表示して数える
+namespace robot_plan_test {
+inline int &numNg() {
+  static int ng = 0;
+  return ng;
+}
+
+inline void check(bool ok, const char *name, double a, double b) {
+  if (!ok) {
+    ++numNg();
+    std::cout << "NG " << name << ": " << a << ", " << b << std::endl;
+  }
+}
+
+// 最後に呼ぶ. 全て通っていれば"All OK"を表示して0を返す
+inline int result() {
+  std::cout << (numNg() == 0 ? "All OK" : "NG") << std::endl;
+  return numNg() == 0 ? 0 : 1;
+}
+} // namespace robot_plan_test
+#endif
@@ -0,0 +1,124 @@
+#include "../../include/jerk_trajectory.hpp"
+#include "../../include/s_curve.hpp"
+#include "../check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+using namespace robot_plan;
+using namespace robot_plan_test;
+using namespace std;
+
+inline double pow2(double x) { return x * x; }
+
+// 制限を守っているか, 速度と位置が途切れていないか, 終点で止まっているか
+void testProfile(double distance, double v_0, double v_1,
+                 const JerkLimit &limit) {
+  JerkProfile profile;
+  profile.set(distance, v_0, v_1, limit);
+  double total = profile.totalTime();
+  check(total > 0, "total time", total, distance);
+  constexpr double DT = 1.0e-4;
+  const double EPS = 1.0e-6 * (1 + limit.velocity);
+  double prev_position = profile.position(0);
+  double prev_velocity = profile.velocity(0);
+  double prev_accel = profile.acceleration(0);
+  for (double t = DT; t <= total; t += DT) {
+    double p = profile.position(t), v = profile.velocity(t),
+           a = profile.acceleration(t);
+    check(v <= limit.velocity + EPS && v >= -EPS, "velocity limit", v,
+          limit.velocity);
+    check(fabs(a) <= limit.accel + EPS, "accel limit", a, limit.accel);
+    check(fabs(a - prev_accel) / DT <= limit.jerk * (1 + 1.0e-3),
+          "jerk limit", (a - prev_accel) / DT, limit.jerk);
+    // 位置は速度の, 速度は加速度の積分になっている
+    check(fabs(p - prev_position - (v + prev_velocity) / 2 * DT) < 1.0e-6,
+          "position", p - prev_position, (v + prev_velocity) / 2 * DT);
+    check(fabs(v - prev_velocity - (a + prev_accel) / 2 * DT) <
+              limit.jerk * DT * DT + 1.0e-6,
+          "velocity", v - prev_velocity, (a + prev_accel) / 2 * DT);
+    if (v > 1.0) {
+      check(fabs(profile.timeAt(p) - t) < 1.0e-4, "timeAt", profile.timeAt(p),
+            t);
+    }
+    prev_position = p;
+    prev_velocity = v;
+    prev_accel = a;
+  }
+  check(fabs(profile.position(total) - distance) < 1.0e-6, "final position",
+        profile.position(total), distance);
+  check(fabs(profile.position(total - DT) - distance) < limit.velocity * DT,
+        "reach", profile.position(total - DT), distance);
+}
+
+// SVelocityと同じ分け方(軸ごとに加速度をcos, sinで割る)で遅い方の軸が着く時間
+double sCurveTime(double dx, double dy, double accel) {
+  constexpr double VELOCITY_MIN = 400, VELOCITY_MAX = 3000;
+  double distance = hypot(dx, dy), angle = atan2(dy, dx);
+  double v_m = min(sqrt((pow2(VELOCITY_MIN) + accel * distance) / 2),
+                   VELOCITY_MAX);
+  double c[2] = {cos(angle), sin(angle)};
+  double time = 0;
+  for (int i = 0; i < 2; ++i) {
+    if (distance * fabs(c[i]) > 50) {
+      SCurve curve;
+      curve.set(0, distance * fabs(c[i]), VELOCITY_MIN * c[i], v_m * c[i], 0,
+                accel * c[i]);
+      time = max(time, curve.totalTime());
+    }
+  }
+  return time;
+}
+
+int main() {
+  const JerkLimit LIMIT[] = {{3000, 500, 2000}, {3000, 1500, 6000},
+                             {1000, 500, 500}};
+  const double DISTANCE[] = {10, 100, 800, 3000, 8000};
+  const double VELOCITY[][2] = {{400, 0}, {0, 0}, {400, 300}, {0, 800},
+                                {2500, 0}};
+  for (const JerkLimit &limit : LIMIT) {
+    for (double distance : DISTANCE) {
+      for (const auto &velocity : VELOCITY) {
+        testProfile(distance, velocity[0], velocity[1], limit);
+      }
+    }
+  }
+
+  // x, y, yawが同時に着いて, 合成した速度が制限を超えない
+  Trajectory2D trajectory;
+  JerkLimit limit = {3000, 500, 2000};
+  trajectory.set(5400, 2040, M_PI, 2000, 4500, M_PI / 2, 400, 0, limit, 1.0);
+  double total = trajectory.totalTime();
+  for (double t = 0; t <= total; t += 1.0e-3) {
+    TrajectoryPoint point = trajectory.at(t);
+    check(hypot(point.vx, point.vy) <= limit.velocity + 1.0e-6, "2d velocity",
+          hypot(point.vx, point.vy), limit.velocity);
+    check(hypot(point.ax, point.ay) <= limit.accel + 1.0e-6, "2d accel",
+          hypot(point.ax, point.ay), limit.accel);
+    check(fabs(point.omega) <= 1.0 + 1.0e-6, "omega", point.omega, 1.0);
+    if (t > 0 && t < total - 0.01) {
+      check(fabs(trajectory.timeAt(point.x, point.y) - t) < 1.0e-4,
+            "2d timeAt", trajectory.timeAt(point.x, point.y), t);
+    }
+  }
+  TrajectoryPoint end = trajectory.at(total);
+  check(fabs(end.x - 2000) < 1.0e-6 && fabs(end.y - 4500) < 1.0e-6,
+        "2d final", end.x, end.y);
+  check(fabs(end.theta - M_PI / 2) < 1.0e-9, "2d final yaw", end.theta,
+        M_PI / 2);
+
+  // 今までの軸ごとのS字加減速との移動時間の比較
+  printf("%-18s %10s %10s\n", "move [mm]", "s_curve", "jerk");
+  const double MOVE[][2] = {{1000, 0}, {1000, 1000}, {3000, 1000},
+                            {500, 2500}, {4000, 3000}};
+  for (const auto &move : MOVE) {
+    Trajectory2D jerk;
+    jerk.set(0, 0, 0, move[0], move[1], 0, 400, 0, limit, 0);
+    double s_curve = sCurveTime(move[0], move[1], limit.accel);
+    printf("(%5.0f, %5.0f)     %9.3fs %9.3fs\n", move[0], move[1], s_curve,
+           jerk.totalTime());
+  }
+
+  return result();
+}
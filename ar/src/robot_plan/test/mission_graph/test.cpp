@@ -0,0 +1,95 @@
+#include "../../include/goal_manager.hpp"
+#include "../check.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace motion_planner;
+using namespace robot_plan_test;
+using namespace std;
+
+int main() {
+  // motion_plannerのハンガーの経路と同じ形
+  GoalManager goals(1);
+  goals.add(5400, 2040, 180, 1000, 11); // 0 スタートゾーン
+  goals.add(3650, 3900, 180, 1000);     // 1 小ポール横
+  goals.add(2850, 3850, 180, 1000);     // 2 ハンガー手前
+  goals.add(2050, 3850, 180, 1000);     // 3 次ハンガー手前
+  goals.add(2050, 3900, 180, 1000);     // 4 次ハンガー横
+  goals.add(5600, 1840, 180, 1000);     // 5 スタートゾーン
+  goals.add(5600, 1840, 180, 1000, 11); // 6 スタートスイッチ
+  MissionGraph &actions = goals.actions;
+  int lift_up = actions.add(1, 75, 1, MissionGraph::ON_DEPART);
+  int hunger_1 = actions.add(2, 4, 1, 0, {lift_up}, true);
+  int hunger_2 = actions.add(2, 4, 2, 0, {hunger_1}, true);
+  int lift_down = actions.add(1, 0, 4, 1000, {hunger_2});
+  actions.waitAt(5, {lift_down});
+  goals.restart();
+
+  // 止まって待つ点は通過させない
+  vector<double> mission;
+  goals.appendMission(0, mission);
+  const int FIELDS = 8;
+  bool expected_pass[] = {true, false, false, true, true, false, false};
+  for (int i = 0; i < 7; ++i) {
+    check(mission[i * FIELDS + 7] == expected_pass[i], "pass", i,
+          mission[i * FIELDS + 7]);
+  }
+
+  vector<int> started;
+  // スタートゾーンにいる間は何も始めない
+  actions.update(0, 0, started);
+  check(started.empty(), "not yet", started.size(), 0);
+  // 小ポールへ向かい始めたら昇降だけ始める. ハンガーは着いてから
+  actions.update(1, 3000, started);
+  check(started == vector<int>({lift_up}), "lift on depart", started.size(),
+        1);
+  check(actions.state(lift_up) == ActionState::RUNNING, "running",
+        (int)actions.state(lift_up), 0);
+  actions.update(1, 100, started);
+  check(started.empty(), "hunger waits arrival", started.size(), 0);
+  // 着いても昇降が終わるまでハンガーは始めず, 点も離れない
+  actions.update(1, 0, started);
+  check(started.empty(), "hunger waits lift", started.size(), 0);
+  check(!actions.canLeave(1), "stay for hunger", 0, 0);
+  check(actions.canLeave(0), "leave start", 0, 0);
+  actions.finish(lift_up);
+  actions.update(1, 0, started);
+  check(started == vector<int>({hunger_1}), "hunger after lift",
+        started.size(), 1);
+  check(!actions.canLeave(1), "stay while hunger", 0, 0);
+  actions.finish(hunger_1);
+  check(actions.canLeave(1), "leave after hunger", 0, 0);
+
+  // 通過した区間の動作も, 依存が終われば後から始める
+  actions.update(2, 0, started);
+  check(started == vector<int>({hunger_2}), "hunger 2", started.size(), 1);
+  actions.update(4, 2000, started);
+  check(started.empty(), "lift down waits hunger", started.size(), 0);
+  actions.finish(hunger_2);
+  actions.update(4, 2000, started);
+  check(started.empty(), "lift down distance", started.size(), 0);
+  actions.update(5, 4000, started);
+  check(started == vector<int>({lift_down}), "lift down after passing",
+        started.size(), 1);
+  check(!actions.canLeave(5), "wait lift down", 0, 0);
+  actions.finish(lift_down);
+  check(actions.canLeave(5), "leave after lift down", 0, 0);
+
+  // restartで最初からやり直す
+  goals.restart();
+  for (int id = 0; id < actions.size(); ++id) {
+    check(actions.state(id) == ActionState::WAITING, "restart", id, 0);
+  }
+
+  // まだ無い動作には依存できない(依存は輪にならない)
+  bool is_thrown = false;
+  try {
+    actions.add(1, 0, 2, 0, {actions.size()});
+  } catch (const out_of_range &) {
+    is_thrown = true;
+  }
+  check(is_thrown, "depends on later", 0, 0);
+
+  return result();
+}
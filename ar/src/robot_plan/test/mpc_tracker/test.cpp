@@ -0,0 +1,189 @@
+#include "../../include/mpc_tracker.hpp"
+#include "../check.hpp"
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace robot_plan;
+using namespace robot_plan_test;
+using namespace std;
+
+constexpr double PERIOD = 0.01, ROOT_FOLLOW = 1.7;
+
+// MpcTrackerと同じ1次遅れで指令に追いつくロボット
+struct Robot {
+  Pose pose;
+  double velocity[3];
+  void step(const double command[3], double dt, double lag) {
+    double a = exp(-dt / lag);
+    for (int c = 0; c < 3; ++c) {
+      velocity[c] = command[c] + (velocity[c] - command[c]) * a;
+    }
+    pose.x += velocity[0] * dt;
+    pose.y += velocity[1] * dt;
+  }
+};
+
+double maxWheel(const double velocity[3], double theta) {
+  constexpr double R = 0.70710678118654752440;
+  const double drive[4][3] = {{R, -R, -1}, {-R, -R, -1}, {-R, R, -1}, {R, R, -1}};
+  // MDDと同じ向きでフィールドからロボットの座標にする
+  double vx = velocity[0] * cos(theta) - velocity[1] * sin(theta);
+  double vy = velocity[0] * sin(theta) + velocity[1] * cos(theta);
+  double wheel_max = 0;
+  for (int i = 0; i < 4; ++i) {
+    double wheel = drive[i][0] * vx + drive[i][1] * vy + drive[i][2] * velocity[2];
+    wheel_max = max(wheel_max, fabs(wheel));
+  }
+  return wheel_max;
+}
+
+vector<TrajectoryPoint> preview(const SegmentFollower &follower,
+                                const MpcConfig &config) {
+  vector<TrajectoryPoint> reference(config.horizon);
+  for (int k = 0; k < config.horizon; ++k) {
+    reference[k] = follower.preview((k + 1) * config.step - PERIOD);
+  }
+  return reference;
+}
+
+// 区間を最後まで追いかけて, 軌道からの一番大きいずれと最後のずれを返す
+void track(bool use_mpc, const Segment &segment, const MpcConfig &config,
+           double &error_max, double &error_final, int &iterations_max,
+           double &wheel_max, double &change_max) {
+  SegmentFollower follower;
+  follower.set(segment, false);
+  MpcTracker tracker(config);
+  Robot robot{segment.start, {0, 0, 0}};
+  double command[3] = {}, prev[3] = {};
+  error_max = wheel_max = change_max = 0;
+  iterations_max = 0;
+  for (int i = 0; i < 600; ++i) {
+    TrajectoryPoint point = follower.follow(robot.pose, PERIOD);
+    if (use_mpc) {
+      const MpcResult &result =
+          tracker.solve(robot.pose, preview(follower, config), PERIOD);
+      for (int c = 0; c < 3; ++c) {
+        command[c] = result.velocity[c];
+      }
+      iterations_max = max(iterations_max, result.iterations);
+    } else {
+      command[0] = point.vx + ROOT_FOLLOW * (point.x - robot.pose.x);
+      command[1] = point.vy + ROOT_FOLLOW * (point.y - robot.pose.y);
+    }
+    for (int c = 0; c < 3; ++c) {
+      change_max = max(change_max, fabs(command[c] - prev[c]) / PERIOD);
+      prev[c] = command[c];
+    }
+    wheel_max = max(wheel_max, maxWheel(command, robot.pose.theta));
+    robot.step(command, PERIOD, config.motor_lag);
+    // 1周期先の点と比べるので, 動いた後の位置で測る
+    error_max = max(error_max,
+                    hypot(point.x - robot.pose.x, point.y - robot.pose.y));
+  }
+  error_final = hypot(segment.goal.x - robot.pose.x,
+                      segment.goal.y - robot.pose.y);
+}
+
+int main() {
+  MpcConfig config;
+  config.motor_lag = 0.1;
+
+  // 目標の上で止まっていれば何もしない
+  {
+    MpcTracker tracker(config);
+    Pose pose{1000, 2000, M_PI};
+    TrajectoryPoint point = {1000, 2000, M_PI, 0, 0, 0, 0, 0};
+    vector<TrajectoryPoint> reference(config.horizon, point);
+    const MpcResult &result = tracker.solve(pose, reference, PERIOD);
+    check(fabs(result.velocity[0]) < 1 && fabs(result.velocity[1]) < 1 &&
+              result.velocity[2] == 0,
+          "stay", result.velocity[0], result.velocity[1]);
+    check(result.iterations <= config.max_iterations, "iterations",
+          result.iterations, config.max_iterations);
+  }
+
+  // 遠くの目標へは駆動輪と加速度の制限の中で向かう. 向きによって効く輪が変わる
+  for (double theta : {M_PI, M_PI / 4, 0.3}) {
+    MpcTracker tracker(config);
+    Robot robot{Pose{0, 0, theta}, {0, 0, 0}};
+    TrajectoryPoint point = {8000, 3000, theta, 0, 0, 0, 0, 0};
+    vector<TrajectoryPoint> reference(config.horizon, point);
+    double prev[3] = {}, wheel_max = 0, change_max = 0;
+    for (int i = 0; i < 800; ++i) {
+      const MpcResult &result = tracker.solve(robot.pose, reference, PERIOD);
+      for (int c = 0; c < 3; ++c) {
+        change_max =
+            max(change_max, fabs(result.velocity[c] - prev[c]) / PERIOD);
+        prev[c] = result.velocity[c];
+      }
+      wheel_max = max(wheel_max, maxWheel(result.velocity, theta));
+      robot.step(result.velocity, PERIOD, config.motor_lag);
+    }
+    check(wheel_max <= config.wheel_velocity_max + 1e-6, "wheel limit",
+          wheel_max, theta);
+    check(change_max <= config.accel_max + 1e-6, "accel limit", change_max,
+          theta);
+    check(wheel_max > config.wheel_velocity_max * 0.95, "use wheel limit",
+          wheel_max, theta);
+    check(hypot(robot.pose.x - 8000, robot.pose.y - 3000) < 50, "reach far",
+          robot.pose.x, robot.pose.y);
+  }
+
+  // 反復を打ち切っても制限は守る
+  {
+    MpcConfig short_config = config;
+    short_config.max_iterations = 2;
+    MpcTracker tracker(short_config);
+    Pose pose{0, 0, 0.5};
+    TrajectoryPoint point = {6000, -4000, 0.5, 0, 0, 0, 0, 0};
+    vector<TrajectoryPoint> reference(short_config.horizon, point);
+    double prev[3] = {};
+    for (int i = 0; i < 50; ++i) {
+      const MpcResult &result = tracker.solve(pose, reference, PERIOD);
+      check(result.iterations <= 2, "iteration cap", result.iterations, 2);
+      check(maxWheel(result.velocity, pose.theta) <=
+                short_config.wheel_velocity_max + 1e-6,
+            "cap wheel limit", maxWheel(result.velocity, pose.theta), 0);
+      for (int c = 0; c < 3; ++c) {
+        check(fabs(result.velocity[c] - prev[c]) <=
+                  short_config.accel_max * PERIOD + 1e-6,
+              "cap accel limit", result.velocity[c], prev[c]);
+        prev[c] = result.velocity[c];
+      }
+    }
+  }
+
+  // S字加減速の区間: 遅れのあるロボットでも比例追従よりずれが小さい
+  {
+    SegmentPlanner planner;
+    Segment segment;
+    segment.start = Pose{0, 0, M_PI};
+    segment.goal = Pose{3000, 1500, M_PI};
+    segment.velocity_prev[0] = segment.velocity_prev[1] = 0;
+    segment.velocity_final[0] = segment.velocity_final[1] = 0;
+    segment.accel = 1000;
+    planner.plan(segment);
+    double follow_error, follow_final, mpc_error, mpc_final;
+    double wheel_max, change_max, dummy_wheel, dummy_change;
+    int iterations_max, dummy;
+    track(false, segment, config, follow_error, follow_final, dummy,
+          dummy_wheel, dummy_change);
+    track(true, segment, config, mpc_error, mpc_final, iterations_max,
+          wheel_max, change_max);
+    printf("tracking error [mm]: follow %.1f (final %.1f), mpc %.1f (final "
+           "%.1f), iterations %d\n",
+           follow_error, follow_final, mpc_error, mpc_final, iterations_max);
+    check(mpc_error < follow_error, "better than follow", mpc_error,
+          follow_error);
+    check(mpc_final < 5, "mpc final", mpc_final, 0);
+    check(wheel_max <= config.wheel_velocity_max + 1e-6, "track wheel",
+          wheel_max, 0);
+    check(change_max <= config.accel_max + 1e-6, "track accel", change_max, 0);
+    check(iterations_max <= config.max_iterations, "track iterations",
+          iterations_max, 0);
+  }
+
+  return result();
+}
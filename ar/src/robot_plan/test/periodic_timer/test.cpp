@@ -0,0 +1,77 @@
+#include "../../include/latest_value.hpp"
+#include "../../include/periodic_timer.hpp"
+#include "../check.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+using namespace robot_plan;
+using namespace robot_plan_test;
+using namespace std;
+
+struct Pose {
+  long x, y, theta; // 書く時に全部同じ値にして, 混ざっていないか見る
+};
+
+int main() {
+  // 書いたものの途中が読めてはいけない, 読む値は古くならない
+  LatestValue<Pose> pose;
+  constexpr long NUM_WRITE = 2000000;
+  atomic<bool> done(false);
+  thread writer([&] {
+    for (long i = 1; i <= NUM_WRITE; ++i) {
+      pose.write({i, i, i});
+    }
+    done = true;
+  });
+  long prev = 0, torn = 0, back = 0;
+  while (!done) {
+    const Pose &p = pose.read();
+    if (p.x != p.y || p.x != p.theta) {
+      ++torn;
+    }
+    if (p.x < prev) {
+      ++back;
+    }
+    prev = p.x;
+  }
+  writer.join();
+  check(torn == 0, "torn read", torn, 0);
+  check(back == 0, "older value", back, 0);
+  check(pose.read().x == NUM_WRITE, "latest", pose.read().x, NUM_WRITE);
+
+  // 200Hzで回して, 周期がずれていかない
+  constexpr double RATE = 200;
+  constexpr int NUM_CYCLE = 100;
+  PeriodicTimer timer(RATE);
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < NUM_CYCLE; ++i) {
+    timer.wait();
+  }
+  double elapsed =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  check(fabs(elapsed - NUM_CYCLE / RATE) < 0.02, "period", elapsed,
+        NUM_CYCLE / RATE);
+  check(timer.stats().cycles == NUM_CYCLE, "cycles", timer.stats().cycles,
+        NUM_CYCLE);
+  check(timer.stats().jitter_mean < timer.period(), "jitter",
+        timer.stats().jitter_mean, timer.period());
+  printf("jitter mean %.1f us, max %.1f us\n",
+         timer.stats().jitter_mean * 1.0e+6, timer.stats().jitter_max * 1.0e+6);
+
+  // 周期より長い処理は数えて, その後はまた周期通りに回る
+  timer.resetStats();
+  timer.wait();
+  this_thread::sleep_for(chrono::milliseconds(12));
+  timer.wait();
+  check(timer.stats().overruns == 1, "overrun", timer.stats().overruns, 1);
+  check(timer.stats().exec_max > 0.01, "exec", timer.stats().exec_max, 0.01);
+  timer.wait();
+  timer.wait();
+  check(timer.stats().overruns == 1, "recover", timer.stats().overruns, 1);
+
+  return result();
+}
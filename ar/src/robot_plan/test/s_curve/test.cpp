@@ -0,0 +1,134 @@
+#include "../../include/s_curve.hpp"
+#include "../check.hpp"
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace robot_plan;
+using namespace robot_plan_test;
+using namespace std;
+
+inline double pow2(double x) { return x * x; }
+
+// 以前のlocal.cppのsetParamと同じ, 1/rate間隔で位置と速度を並べたもの
+struct AccelMap {
+  double position;
+  double velocity;
+};
+vector<AccelMap> sampleMap(double start, double v_0, double v_m, double v_f,
+                           double a, double accel_time, double const_time,
+                           double decel_time, double rate) {
+  vector<AccelMap> map;
+  double delta_t = 1.0 / rate;
+  for (int j = 0; j * delta_t <= decel_time; ++j) {
+    double time = j * delta_t;
+    AccelMap data;
+    if (time < accel_time) {
+      data.position = a * pow2(accel_time) / (8 * pow2(M_PI)) *
+                          (cos(2 * M_PI / accel_time * time) - 1) +
+                      a * pow2(time) / 4 + v_0 * time;
+      data.velocity = -a * accel_time / (4 * M_PI) *
+                          sin(2 * M_PI / accel_time * time) +
+                      a * time / 2 + v_0;
+    } else if (time < const_time) {
+      time -= accel_time;
+      data.position = v_m * time + pow2(v_m - v_0) / a +
+                      2 * v_0 * (v_m - v_0) / a;
+      data.velocity = v_m;
+    } else {
+      time -= const_time;
+      data.position =
+          -a * pow2(decel_time - const_time) / (8 * pow2(M_PI)) *
+              (cos(2 * M_PI / (decel_time - const_time) * time) - 1) -
+          a * pow2(time) / 4 + v_m * time + v_m * (const_time - accel_time) +
+          pow2(v_m - v_0) / a + 2 * v_0 * (v_m - v_0) / a;
+      data.velocity = a * (decel_time - const_time) / (4 * M_PI) *
+                          sin(2 * M_PI / (decel_time - const_time) * time) -
+                      a * time / 2 + v_m;
+    }
+    data.position += start;
+    map.push_back(data);
+  }
+  return map;
+}
+
+// local.cppのsetParamと同じ決め方で1軸分を作って, 前のサンプル列と比べる
+void testAxis(double start, double distance, double angle, double v_f,
+              double accel, double rate) {
+  constexpr double VELOCITY_MIN = 400, VELOCITY_MAX = 3000;
+  double v_m = sqrt((pow2(VELOCITY_MIN) + pow2(v_f) + accel * distance) / 2);
+  if (v_m > VELOCITY_MAX) {
+    v_m = VELOCITY_MAX;
+  }
+  double c = cos(angle);
+  double axis_distance = distance * fabs(c);
+  SCurve curve;
+  curve.set(start, axis_distance, VELOCITY_MIN * c, v_m * c, v_f * c,
+            accel * c);
+  // 最高速度が初速か終速より小さい時は前の式だと位置が飛んでいたので比べない
+  bool is_same = v_m >= VELOCITY_MIN && v_m >= v_f;
+  vector<AccelMap> map =
+      sampleMap(start, VELOCITY_MIN * c, v_m * c, v_f * c, accel * c,
+                curve.accelTime(), curve.constTime(), curve.decelTime(), rate);
+
+  for (size_t j = 0; j < map.size(); ++j) {
+    double time = j / rate;
+    double position = curve.position(time), velocity = curve.velocity(time);
+    if (is_same) {
+      check(fabs(position - map[j].position) < 1.0e-6, "position", position,
+            map[j].position);
+      check(fabs(velocity - map[j].velocity) < 1.0e-6, "velocity", velocity,
+            map[j].velocity);
+    }
+    // 戻らずに進む
+    if (j > 0) {
+      double prev = curve.position(time - 1 / rate);
+      check((position - prev) * c >= -1.0e-9, "monotone", prev, position);
+    }
+    // 加速度は速度の数値微分と比べる
+    constexpr double h = 1.0e-6;
+    if (time > h && time < curve.totalTime() - h) {
+      double diff = (curve.velocity(time + h) - curve.velocity(time - h)) / 2 / h;
+      check(fabs(curve.acceleration(time) - diff) < 1.0e-2 * fabs(accel) + 1.0e-3,
+            "acceleration", curve.acceleration(time), diff);
+    }
+    // 位置から時刻に戻せるか
+    if (time < curve.totalTime() && fabs(velocity) > 1.0) {
+      double inverse = curve.timeAt(position);
+      check(fabs(inverse - time) < 1.0e-4, "timeAt", inverse, time);
+    }
+  }
+  check(fabs(curve.finalPosition() - (start + distance * c)) < 1.0e-6,
+        "final position", curve.finalPosition(), start + distance * c);
+}
+
+int main() {
+  const double START[] = {0, 5400, -2000};
+  const double DISTANCE[] = {100, 800, 3000, 8000};
+  const double ANGLE[] = {0, 0.6, 2.4, -1.2, M_PI};
+  const double FINAL[] = {0, 300};
+  const double ACCEL[] = {500, 1500};
+  const double RATE[] = {15, 100};
+  for (double start : START) {
+    for (double distance : DISTANCE) {
+      for (double angle : ANGLE) {
+        for (double v_f : FINAL) {
+          for (double accel : ACCEL) {
+            for (double rate : RATE) {
+              testAxis(start, distance, angle, v_f, accel, rate);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // 止まっている時は位置が変わらない
+  SCurve stay;
+  stay.stay(123);
+  check(stay.position(1.0) == 123 && stay.velocity(1.0) == 0, "stay",
+        stay.position(1.0), stay.velocity(1.0));
+  check(stay.timeAt(500) == 0, "stay timeAt", stay.timeAt(500), 0);
+
+  return result();
+}
@@ -0,0 +1,57 @@
+#include "../../include/waypoint_blend.hpp"
+#include "../check.hpp"
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace robot_plan;
+using namespace robot_plan_test;
+using namespace std;
+
+constexpr double VELOCITY_MIN = 400, VELOCITY_MAX = 3000;
+constexpr double ACCEL = 1000, BLEND = 400;
+
+vector<double> blend(const vector<Waypoint> &points) {
+  return blendVelocities(points, VELOCITY_MIN, VELOCITY_MAX, ACCEL, BLEND);
+}
+
+int main() {
+  // 一直線なら角で落とさず, 加速と最後の停止だけで決まる
+  vector<double> v = blend({{0, 0}, {1000, 0}, {2000, 0}, {6000, 0}});
+  check(fabs(v[1] - sqrt(VELOCITY_MIN * VELOCITY_MIN + ACCEL * 1000)) < 1e-9,
+        "straight accel", v[1], 0);
+  check(fabs(v[2] - sqrt(v[1] * v[1] + ACCEL * 1000)) < 1e-9, "straight accel 2",
+        v[2], 0);
+  check(v[3] == 0, "stop at last", v[3], 0);
+  v = blend({{0, 0}, {4000, 0}, {5000, 0}});
+  check(fabs(v[1] - sqrt(ACCEL * 1000)) < 1e-9, "straight decel", v[1], 0);
+
+  // 直角は2v sin(45°)をBLENDの間に変える速さ
+  v = blend({{0, 0}, {3000, 0}, {3000, 3000}, {3000, 6000}});
+  check(fabs(v[1] - sqrt(ACCEL * BLEND / (2 * sin(M_PI / 4)))) < 1e-9,
+        "right angle", v[1], sqrt(ACCEL * BLEND / (2 * sin(M_PI / 4))));
+
+  // 折り返しが一番遅い
+  vector<double> back = blend({{0, 0}, {3000, 0}, {0, 0}});
+  check(back[1] < v[1], "turn back", back[1], v[1]);
+  check(fabs(back[1] - sqrt(ACCEL * BLEND / 2)) < 1e-9, "turn back value",
+        back[1], sqrt(ACCEL * BLEND / 2));
+
+  // 同じ位置の点は同じ速さ, 今の位置と同じ点は今の速さ
+  v = blend({{0, 0}, {0, 0}, {3000, 0}, {3000, 0}, {3000, 3000}});
+  check(v[1] == VELOCITY_MIN, "same as start", v[1], VELOCITY_MIN);
+  check(v[2] == v[3] && v[2] > 0, "same point", v[2], v[3]);
+  check(v[4] == 0, "stop at last", v[4], 0);
+
+  // 点が1つ(次で止まる)なら0
+  v = blend({{0, 0}, {3000, 0}});
+  check(v[1] == 0, "single goal", v[1], 0);
+
+  // goal_map[1]のタオル側の経路(スタート -> (5400, 7500) -> (3600, 7500))
+  v = blend({{5400, 2040}, {5400, 7500}, {3600, 7500}});
+  printf("goal_map[1] corner: %.0f mm/s\n", v[1]);
+  check(v[1] > VELOCITY_MIN, "goal_map[1]", v[1], VELOCITY_MIN);
+
+  return result();
+}
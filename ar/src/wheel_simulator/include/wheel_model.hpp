@@ -0,0 +1,53 @@
+#ifndef WHEEL_SIMULATOR_WHEEL_MODEL_HPP
+#define WHEEL_SIMULATOR_WHEEL_MODEL_HPP
+#include <random>
+
+// 足回りMDD(ar/mdd_slave/wheel/four_omuni.cpp)の代わりに動く4輪オムニの運動学モデル
+// 指令の受け取り方, 駆動輪への振り分け(DRIVE_MATRIX), 計測輪からのオドメトリは
+// MDDと同じ計算をして, その間の実機の部分(モーターの遅れ, 滑り, 計測輪の誤差)を作る
+namespace wheel_simulator {
+struct Pose {
+  double x, y, theta;
+};
+
+struct ModelConfig {
+  double motor_lag = 0.05;      // 駆動輪の速度の1次遅れの時定数[s]
+  double slip = 0;              // 駆動輪の空回りの割合, 実際に進むのは(1 - slip)倍
+  double encoder_noise = 0;     // 計測輪の読みの誤差, 進んだ距離に対する標準偏差の割合
+  double drive_radius = 312;    // 中心から駆動輪まで[mm], angular.zを角速度に直す
+  double measure_radius = 312;  // 中心から計測輪まで[mm], MDDのMEASURE_RADIUS
+  unsigned int seed = 0;
+};
+
+class WheelModel {
+public:
+  static constexpr int NUM_WHEEL = 4, NUM_AXIS = 3;
+
+  explicit WheelModel(const ModelConfig &config);
+
+  // /wheel/velocityと同じ: フィールド座標の速度[mm/s]と回転の指令
+  // stopはangular.y == -1の時で, 駆動輪の指令を0にする
+  void setCommand(double velocity_x, double velocity_y, double omega,
+                  bool stop);
+  // /wheel/reset_robot_poseと同じ. その位置に置き直したものとして実際の位置も変える
+  void reset(const Pose &pose);
+  // dt[s]だけ進める
+  void step(double dt);
+
+  // MDDが/wheel/robot_poseで送るオドメトリの位置
+  const Pose &pose() const { return pose_; }
+  // 誤差の無い実際の位置
+  const Pose &truePose() const { return true_pose_; }
+  double wheelVelocity(int id) const { return wheel_velocity_[id]; }
+
+private:
+  ModelConfig config_;
+  std::mt19937 engine_;
+  std::normal_distribution<double> noise_{0, 1};
+  double command_[NUM_AXIS] = {};
+  bool stop_ = false;
+  double wheel_velocity_[NUM_WHEEL] = {};
+  Pose pose_, true_pose_;
+};
+} // namespace wheel_simulator
+#endif
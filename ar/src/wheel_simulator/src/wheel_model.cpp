@@ -0,0 +1,96 @@
+#include <cmath>
+#include <wheel_model.hpp>
+
+namespace wheel_simulator {
+namespace {
+constexpr double INVERCE_ROOT_2 = 0.70710678118654752440;
+// MDDと同じ並び, 駆動輪の速度 = DRIVE_MATRIX * ロボット座標の速度
+constexpr double DRIVE_MATRIX[WheelModel::NUM_WHEEL][WheelModel::NUM_AXIS] = {
+    {INVERCE_ROOT_2, -INVERCE_ROOT_2, -1},
+    {-INVERCE_ROOT_2, -INVERCE_ROOT_2, -1},
+    {-INVERCE_ROOT_2, INVERCE_ROOT_2, -1},
+    {INVERCE_ROOT_2, INVERCE_ROOT_2, -1},
+};
+// DRIVE_MATRIXの列どうしは直交していて, 列の大きさの2乗がこれ
+// 駆動輪の速度からロボットの速度へはDRIVE_MATRIXの転置をこれで割る
+constexpr double DRIVE_NORM[WheelModel::NUM_AXIS] = {2, 2, 4};
+
+void normalize(double &theta) {
+  if (theta > M_PI) {
+    theta -= 2 * M_PI;
+  } else if (theta <= -M_PI) {
+    theta += 2 * M_PI;
+  }
+}
+} // namespace
+
+WheelModel::WheelModel(const ModelConfig &config)
+    : config_(config), engine_(config.seed) {
+  // MDDは電源を入れた時(0, 0, π)から数える
+  reset(Pose{0, 0, M_PI});
+}
+
+void WheelModel::setCommand(double velocity_x, double velocity_y,
+                            double omega, bool stop) {
+  command_[0] = velocity_x;
+  command_[1] = velocity_y;
+  command_[2] = omega;
+  stop_ = stop;
+}
+
+void WheelModel::reset(const Pose &pose) { pose_ = true_pose_ = pose; }
+
+void WheelModel::step(double dt) {
+  // Move: MDDと同じく, オドメトリの向きでフィールドからロボットの座標にする
+  double robot_velocity[NUM_AXIS] = {
+      command_[0] * cos(pose_.theta) - command_[1] * sin(pose_.theta),
+      command_[0] * sin(pose_.theta) + command_[1] * cos(pose_.theta),
+      command_[2]};
+  double lag = 1 - exp(-dt / config_.motor_lag);
+  for (int i = 0; i < NUM_WHEEL; ++i) {
+    double drive_goal = 0;
+    for (int j = 0; j < NUM_AXIS && !stop_; ++j) {
+      drive_goal += DRIVE_MATRIX[i][j] * robot_velocity[j];
+    }
+    wheel_velocity_[i] += (drive_goal - wheel_velocity_[i]) * lag;
+  }
+
+  // 駆動輪の速度から実際に進んだ量(ロボット座標)
+  double move[NUM_AXIS] = {};
+  for (int j = 0; j < NUM_AXIS; ++j) {
+    for (int i = 0; i < NUM_WHEEL; ++i) {
+      move[j] += DRIVE_MATRIX[i][j] * wheel_velocity_[i];
+    }
+    move[j] *= (1 - config_.slip) * dt / DRIVE_NORM[j];
+  }
+  double true_theta = move[2] / config_.drive_radius;
+  true_pose_.theta += true_theta;
+  normalize(true_pose_.theta);
+  true_pose_.x += move[0] * cos(true_pose_.theta) -
+                  move[1] * sin(true_pose_.theta);
+  true_pose_.y += move[0] * sin(true_pose_.theta) +
+                  move[1] * cos(true_pose_.theta);
+
+  // 計測輪の読み. MDDのオドメトリの式を逆にたどったもの
+  double turn = config_.measure_radius * true_theta;
+  double measure_diff[NUM_WHEEL] = {move[0] - turn, -move[1] - turn,
+                                    -move[0] - turn, move[1] - turn};
+  for (int i = 0; i < NUM_WHEEL; ++i) {
+    measure_diff[i] +=
+        config_.encoder_noise * fabs(measure_diff[i]) * noise_(engine_);
+  }
+
+  // Odometry: MDDと同じ
+  double robot_x = measure_diff[0] / 2 - measure_diff[2] / 2;
+  double robot_y = -measure_diff[1] / 2 + measure_diff[3] / 2;
+  double robot_theta = 0;
+  for (int i = 0; i < NUM_WHEEL; ++i) {
+    robot_theta += -measure_diff[i];
+  }
+  robot_theta /= config_.measure_radius * NUM_WHEEL;
+  pose_.theta += robot_theta;
+  normalize(pose_.theta);
+  pose_.x += robot_x * cos(pose_.theta) - robot_y * sin(pose_.theta);
+  pose_.y += robot_x * sin(pose_.theta) + robot_y * cos(pose_.theta);
+}
+} // namespace wheel_simulator
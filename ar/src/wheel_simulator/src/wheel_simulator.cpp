@@ -0,0 +1,93 @@
+#include <chrono>
+#include <geometry_msgs/Pose2D.h>
+#include <geometry_msgs/Twist.h>
+#include <ros/ros.h>
+#include <rosgraph_msgs/Clock.h>
+#include <thread>
+#include <wheel_model.hpp>
+
+// 足回りMDDの代わりに/wheel/velocityを受けて/wheel/robot_poseを返す
+// ~publish_clockの時は/clockも出して時間を進める側になり,
+// ~real_time_factor倍の速さで回す(/use_sim_timeをtrueにして他のノードを起動する)
+namespace {
+wheel_simulator::WheelModel *g_model;
+
+void getTwist(const geometry_msgs::Twist &msg) {
+  g_model->setCommand(msg.linear.x, msg.linear.y, msg.angular.z,
+                      (int)msg.angular.y == -1);
+}
+
+void resetRobotPose(const geometry_msgs::Pose2D &msg) {
+  g_model->reset(wheel_simulator::Pose{msg.x, msg.y, msg.theta});
+}
+
+geometry_msgs::Pose2D toMsg(const wheel_simulator::Pose &pose) {
+  geometry_msgs::Pose2D msg;
+  msg.x = pose.x;
+  msg.y = pose.y;
+  msg.theta = pose.theta;
+  return msg;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  ros::init(argc, argv, "wheel_simulator");
+  ros::NodeHandle n, pn("~");
+
+  wheel_simulator::ModelConfig config;
+  int seed = 0;
+  pn.param("motor_lag", config.motor_lag, config.motor_lag);
+  pn.param("slip", config.slip, config.slip);
+  pn.param("encoder_noise", config.encoder_noise, config.encoder_noise);
+  pn.param("drive_radius", config.drive_radius, config.drive_radius);
+  pn.param("measure_radius", config.measure_radius, config.measure_radius);
+  pn.param("seed", seed, seed);
+  config.seed = seed;
+  // MDDのメインループの代わりの周期と, /wheel/robot_poseを送る周期(MDDは50Hz)
+  double rate = 1000, topic_rate = 50;
+  pn.param("rate", rate, rate);
+  pn.param("topic_rate", topic_rate, topic_rate);
+  bool publish_clock = false;
+  double real_time_factor = 1;
+  pn.param("publish_clock", publish_clock, publish_clock);
+  pn.param("real_time_factor", real_time_factor, real_time_factor);
+  if (!publish_clock || real_time_factor <= 0) {
+    real_time_factor = 1;
+  }
+
+  wheel_simulator::WheelModel model(config);
+  g_model = &model;
+  ros::Subscriber velocity_sub = n.subscribe("wheel/velocity", 1, getTwist);
+  ros::Subscriber reset_sub =
+      n.subscribe("wheel/reset_robot_pose", 1, resetRobotPose);
+  ros::Publisher robot_pose_pub =
+      n.advertise<geometry_msgs::Pose2D>("wheel/robot_pose", 1);
+  ros::Publisher true_pose_pub =
+      n.advertise<geometry_msgs::Pose2D>("wheel/true_robot_pose", 1);
+  ros::Publisher clock_pub = n.advertise<rosgraph_msgs::Clock>("/clock", 1);
+
+  const double dt = 1.0 / rate;
+  const int topic_step = rate / topic_rate;
+  const auto wall_period = std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(dt / real_time_factor));
+  // シミュレーションの時間は0だと未設定と見なされるので1sから始める
+  double sim_time = 1;
+  auto wall_deadline = std::chrono::steady_clock::now();
+  for (long i = 0; ros::ok(); ++i) {
+    if (publish_clock) {
+      rosgraph_msgs::Clock clock;
+      clock.clock.fromSec(sim_time);
+      clock_pub.publish(clock);
+    }
+    ros::spinOnce();
+    model.step(dt);
+    sim_time += dt;
+    if (i % topic_step == 0) {
+      robot_pose_pub.publish(toMsg(model.pose()));
+      true_pose_pub.publish(toMsg(model.truePose()));
+    }
+    wall_deadline += wall_period;
+    std::this_thread::sleep_until(wall_deadline);
+  }
+}
@@ -0,0 +1,87 @@
+#include "../../include/wheel_model.hpp"
+#include <cmath>
+#include <iostream>
+
+using namespace wheel_simulator;
+using namespace std;
+
+int ng = 0;
+void check(bool ok, const char *name, double a, double b) {
+  if (!ok) {
+    ++ng;
+    cout << "NG " << name << ": " << a << ", " << b << endl;
+  }
+}
+
+constexpr double DT = 0.001;
+
+void run(WheelModel &model, double time) {
+  for (int i = 0; i < time / DT; ++i) {
+    model.step(DT);
+  }
+}
+
+int main() {
+  // MDDと同じく(0, 0, π)から. スタート位置に置き直す
+  WheelModel model{ModelConfig()};
+  check(model.pose().theta == M_PI, "initial", model.pose().theta, M_PI);
+  model.reset(Pose{5400, 2040, M_PI});
+
+  // フィールドのx方向に1000mm/s, 遅れ(0.05s)の後はその速さで進む
+  model.setCommand(1000, 0, 0, false);
+  run(model, 0.5);
+  double x = model.pose().x;
+  run(model, 1.0);
+  check(fabs(model.pose().x - x - 1000) < 1, "velocity x", model.pose().x - x,
+        1000);
+  check(fabs(model.pose().y - 2040) < 1e-6, "no y", model.pose().y, 2040);
+  check(fabs(model.pose().x - model.truePose().x) < 1e-6, "odometry",
+        model.pose().x, model.truePose().x);
+
+  // 止めると1次遅れで止まる
+  model.setCommand(1000, 0, 0, true);
+  run(model, 0.05);
+  check(fabs(model.wheelVelocity(0)) < 1000 * 0.71 * 0.4 &&
+            fabs(model.wheelVelocity(0)) > 1000 * 0.71 * 0.3,
+        "lag", model.wheelVelocity(0), 1000 * 0.71 * exp(-1));
+  run(model, 1.0);
+  check(fabs(model.wheelVelocity(0)) < 1e-3, "stop", model.wheelVelocity(0),
+        0);
+
+  // 回転: angular.zは駆動輪の速さ, drive_radiusで割った角速度で回る
+  model.reset(Pose{0, 0, 0.5});
+  model.setCommand(0, 0, 312, false);
+  run(model, 1.0);
+  double theta = model.pose().theta;
+  run(model, 1.0);
+  check(fabs(model.pose().theta - theta - 1) < 1e-3, "rotation",
+        model.pose().theta - theta, 1);
+
+  // 滑りの分だけ実際にもオドメトリでも進まない
+  ModelConfig slip_config;
+  slip_config.slip = 0.1;
+  WheelModel slip{slip_config};
+  slip.setCommand(0, 1000, 0, false);
+  run(slip, 0.5);
+  double y = slip.truePose().y;
+  run(slip, 1.0);
+  check(fabs(fabs(slip.truePose().y - y) - 900) < 1, "slip",
+        slip.truePose().y - y, 900);
+
+  // 計測輪の誤差でオドメトリだけずれていく, 同じseedなら同じずれ
+  ModelConfig noise_config;
+  noise_config.encoder_noise = 0.05;
+  WheelModel noise[2] = {WheelModel(noise_config), WheelModel(noise_config)};
+  for (WheelModel &m : noise) {
+    m.setCommand(1000, 500, 0, false);
+    run(m, 3.0);
+  }
+  double error = hypot(noise[0].pose().x - noise[0].truePose().x,
+                       noise[0].pose().y - noise[0].truePose().y);
+  check(error > 0.1 && error < 100, "noise", error, 0);
+  check(noise[0].pose().x == noise[1].pose().x, "seed", noise[0].pose().x,
+        noise[1].pose().x);
+
+  cout << (ng == 0 ? "All OK" : "NG") << endl;
+  return ng == 0 ? 0 : 1;
+}
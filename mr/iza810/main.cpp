@@ -1,9 +1,11 @@
 //立ルンです, Ma/nLoop from 294
+#include "raspi_utility/include/bus_scheduler.hpp"
 #include "raspi_utility/include/dualshock3.hpp"
 #include "raspi_utility/include/gy521.hpp"
 #include "raspi_utility/include/motor_serial.hpp"
 #include "raspi_utility/include/pid.hpp"
 #include "raspi_utility/include/pigpiod.hpp"
+#include "raspi_utility/include/shadow_register.hpp"
 #include "raspi_utility/include/time.hpp"
 #include <cmath>
 #include <iostream>
@@ -52,6 +54,13 @@ int main() {
 
   // Serial
   MotorSerial ms;
+  // バスに出すフレームは全てBusSchedulerが優先度順に送り, メインループは待たない
+  // 安全停止はBUS_EMERGENCY, 足回りと腕はBUS_MOTION, 射出やハンドはBUS_MECHANISM
+  BusScheduler bus(ms);
+  // 毎周期送る目標値は変化した時とkeep alive(0.5s)ごとにだけBUS_MOTIONに積む
+  ShadowRegister shadow(bus);
+  // TELEMETRY_PERIOD(s)ごとにMDDごとの往復時間とエラーの数を表示する
+  constexpr double TELEMETRY_PERIOD = 10;
 
   // DualShock3
   DualShock3 controller;
@@ -78,8 +87,10 @@ int main() {
   pigpio.write(RUN_LED, 1);
 
   // Wheel ver three omuni
-  constexpr int NUM_WHEEL = 3, WHEEL_MDD_ID[NUM_WHEEL] = {1, 1, 4},
-                WHEEL_CMD[NUM_WHEEL] = {2, 5, 3};
+  // 3輪はMDD 1(cmd 2, 5)とMDD 4(cmd 3)に分かれているので, 同期書き込みで同時に切り替える
+  // slotはmdd_slave/mdd1, mdd4のGROUP_SLOTと合わせる
+  // 変化した時とkeep aliveごとに送るのは他の目標値と同じくShadowRegisterに任せる
+  constexpr int NUM_WHEEL = 3, WHEEL_GROUP_SLOT[NUM_WHEEL] = {0, 1, 2};
   constexpr double WHEEL_OFFSET_THETA[NUM_WHEEL] = {2 * M_PI / 3, -2 * M_PI / 3,
                                                     0};
   constexpr int MAX_ROBOT_SPEED = 250, MAX_ROBOT_MOMENT = 100,
@@ -109,9 +120,9 @@ int main() {
   constexpr int HAND_CLOSE_ANGLE = 150, HAND_CATCH_ANGLE = 125,
                 HAND_OPEN_ANGLE = 30;
   constexpr double WAIT_HAND_TIME = 3;
-  ms.send(HAND_MDD_ID, HAND_CMD, HAND_CATCH_ANGLE);
-  ms.send(LOAD_MDD_ID, LOAD_CMD, -1);
-  ms.send(SHOOT_MDD_ID, SHOOT_READY_CMD, SHOOT_READ_STROKE);
+  bus.send(BUS_MECHANISM, HAND_MDD_ID, HAND_CMD, HAND_CATCH_ANGLE);
+  bus.send(BUS_MECHANISM, LOAD_MDD_ID, LOAD_CMD, -1);
+  bus.send(BUS_MECHANISM, SHOOT_MDD_ID, SHOOT_READY_CMD, SHOOT_READ_STROKE);
 
   // Laundry
   constexpr int LAUNDRY_MDD_ID = 2, LAUNDRY_CMD = 10;
@@ -151,7 +162,10 @@ int main() {
     if (controller.press(SELECT)) {
       emergency_stop = !emergency_stop;
       finish_mode = emergency_stop ? 0 : 1;
-      ms.send(255, 255, 0);
+      // キューに残っている目標値が安全停止を追い越さないように捨ててから送る
+      bus.discard();
+      shadow.clear();
+      bus.send(BUS_EMERGENCY, 255, 255, 0);
     }
     if (emergency_stop) {
       continue;
@@ -209,7 +223,7 @@ int main() {
       arm_goal_x = LAUNDRY_ARM_X;
       arm_goal_y = LAUNDRY_ARM_Y;
     }
-    ms.send(LAUNDRY_MDD_ID, LAUNDRY_CMD, laundry_mode);
+    shadow.set(LAUNDRY_MDD_ID, LAUNDRY_CMD, laundry_mode);
 
     // Leg Input
 
@@ -231,14 +245,14 @@ int main() {
       }
       if (controller.press(SQUARE)) {
         phase = 0;
-        ms.send(HAND_MDD_ID, HAND_CMD, HAND_CATCH_ANGLE);
-        ms.send(SHOOT_MDD_ID, SHOOT_READY_CMD, MAX_LOAD_LENGTH);
+        bus.send(BUS_MECHANISM, HAND_MDD_ID, HAND_CMD, HAND_CATCH_ANGLE);
+        bus.send(BUS_MECHANISM, SHOOT_MDD_ID, SHOOT_READY_CMD, MAX_LOAD_LENGTH);
         changed_phase = true;
       }
       break;
     case 1:
       if (changed_phase) {
-        ms.send(HAND_MDD_ID, HAND_CMD, HAND_CLOSE_ANGLE);
+        bus.send(BUS_MECHANISM, HAND_MDD_ID, HAND_CMD, HAND_CLOSE_ANGLE);
         hand_time.reset();
         changed_phase = false;
       }
@@ -265,7 +279,7 @@ int main() {
       break;
     case 5:
       if (changed_phase) {
-        ms.send(LOAD_MDD_ID, LOAD_CMD, 1);
+        bus.send(BUS_MECHANISM, LOAD_MDD_ID, LOAD_CMD, 1);
         changed_phase = false;
       }
       if (controller.press(SQUARE)) {
@@ -275,8 +289,9 @@ int main() {
       break;
     case 7:
       if (changed_phase) {
-        ms.send(SHOOT_MDD_ID, SHOOT_ROLL_CMD, SHOOT_ROLL_SPEED);
-        ms.send(SHOOT_MDD_ID, SHOOT_STROKE_CMD, SHOOT_CHARGE_STROKE);
+        bus.send(BUS_MECHANISM, SHOOT_MDD_ID, SHOOT_ROLL_CMD, SHOOT_ROLL_SPEED);
+        bus.send(BUS_MECHANISM, SHOOT_MDD_ID, SHOOT_STROKE_CMD,
+                 SHOOT_CHARGE_STROKE);
         changed_phase = false;
       }
       if (controller.press(SQUARE)) {
@@ -286,7 +301,7 @@ int main() {
       break;
     case 9:
       if (changed_phase) {
-        ms.send(LOAD_MDD_ID, LOAD_CMD, -1);
+        bus.send(BUS_MECHANISM, LOAD_MDD_ID, LOAD_CMD, -1);
         laundry_mode = 1;
         changed_phase = false;
       }
@@ -297,7 +312,7 @@ int main() {
       break;
     case 11:
       if (changed_phase) {
-        ms.send(HAND_MDD_ID, HAND_CMD, HAND_OPEN_ANGLE);
+        bus.send(BUS_MECHANISM, HAND_MDD_ID, HAND_CMD, HAND_OPEN_ANGLE);
         hand_time.reset();
         changed_phase = false;
       }
@@ -309,8 +324,9 @@ int main() {
       break;
     case 12:
       if (changed_phase) {
-        ms.send(SHOOT_MDD_ID, SHOOT_READY_CMD, SHOOT_READ_STROKE);
-        ms.send(HAND_MDD_ID, HAND_CMD, HAND_CATCH_ANGLE);
+        bus.send(BUS_MECHANISM, SHOOT_MDD_ID, SHOOT_READY_CMD,
+                 SHOOT_READ_STROKE);
+        bus.send(BUS_MECHANISM, HAND_MDD_ID, HAND_CMD, HAND_CATCH_ANGLE);
         changed_phase = false;
       }
       if (controller.press(SQUARE)) {
@@ -350,7 +366,7 @@ int main() {
     }
     for (int i = 0; i < NUM_WHEEL; ++i) {
       wheel_goal_speed[i] *= dummy_max / MAX_WHEEL_SPEED;
-      ms.send(WHEEL_MDD_ID[i], WHEEL_CMD[i], wheel_goal_speed[i]);
+      shadow.setGroup(WHEEL_GROUP_SLOT[i], (short)wheel_goal_speed[i]);
     }
 
     // Arm Output
@@ -360,15 +376,21 @@ int main() {
         atan2(arm_goal_y, arm_goal_x);
     double angle_elbo =
         calcTriangleTheta(FRONT_ARM_LENGTH, SECOND_ARM_LENGTH, arm_radius);
-    ms.send(ARM_MDD_ID, SHOULDER_CMD,
-            angle_shoulder / M_PI * 180 + OFFSET_SHOULDER_ANGLE);
-    ms.send(ARM_MDD_ID, ELBO_CMD, angle_elbo / M_PI * 180 + OFFSET_ELBO_ANGLE);
+    shadow.set(ARM_MDD_ID, SHOULDER_CMD,
+               angle_shoulder / M_PI * 180 + OFFSET_SHOULDER_ANGLE);
+    shadow.set(ARM_MDD_ID, ELBO_CMD,
+               angle_elbo / M_PI * 180 + OFFSET_ELBO_ANGLE);
+    shadow.flush();
+    ms.checkTelemetry().dumpEvery(TELEMETRY_PERIOD, cout);
   }
   cout << "Main Finish" << endl;
-  ms.send(255, 255, 0);
-  ms.send(SHOOT_MDD_ID, SHOOT_READY_CMD, SHOOT_READ_STROKE);
-  ms.send(HAND_MDD_ID, HAND_CMD, HAND_OPEN_ANGLE);
-  ms.send(LAUNDRY_MDD_ID, LAUNDRY_MDD_ID, 1);
+  ms.checkTelemetry().dump(cout);
+  bus.discard();
+  bus.request(BUS_EMERGENCY, 255, 255, 0).wait();
+  bus.request(BUS_MECHANISM, SHOOT_MDD_ID, SHOOT_READY_CMD, SHOOT_READ_STROKE)
+      .wait();
+  bus.request(BUS_MECHANISM, HAND_MDD_ID, HAND_CMD, HAND_OPEN_ANGLE).wait();
+  bus.request(BUS_MECHANISM, LAUNDRY_MDD_ID, LAUNDRY_MDD_ID, 1).wait();
   pigpio.write(RUN_LED, 0);
   return finish_mode;
 }
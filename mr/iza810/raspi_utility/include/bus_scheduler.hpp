@@ -0,0 +1,93 @@
+#ifndef ARRC_RASPI_BUS_SCHEDULER_HPP
+#define ARRC_RASPI_BUS_SCHEDULER_HPP
+#include "motor_serial.hpp"
+#include "ring_buffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace arrc_raspi {
+// 優先度クラス, 小さいほど優先
+constexpr int BUS_EMERGENCY = 0; // 255/255の安全停止など
+constexpr int BUS_MOTION = 1;    // 足回り, 腕
+constexpr int BUS_MECHANISM = 2; // 射出, ハンド, 昇降など
+constexpr int BUS_COSMETIC = 3;  // テープLEDなど
+constexpr int NUM_BUS_CLASS = 4;
+
+struct BusClassStatus {
+  unsigned long queued;        // キューに積んだ数
+  unsigned long rejected;      // キューが満杯で積めなかった数
+  unsigned long sent;          // 送信した数
+  unsigned long over_budget;   // 予算を超えて(他が空いていたので)送った数
+  unsigned long deadline_miss; // 締め切りまでに送り終わらなかった数
+  unsigned long sum_error;     // 返信のサムチェックが合わなかった数(一斉送信は数えない)
+  unsigned long expired;       // 送信前に締め切りを過ぎて捨てた数
+  unsigned long discarded;     // discard()で送らずに捨てた数
+  double max_wait;             // キューで待った時間の最大[s]
+  double sum_wait;             // キューで待った時間の合計[s]
+};
+
+class BusScheduler {
+public:
+  BusScheduler(MotorSerial &ms, double cycle = 0.01);
+  void setBudget(int priority, int frames_per_cycle);
+  void setDeadline(int priority, double deadline);
+  void setDropExpired(int priority, bool drop);
+  bool send(int priority, unsigned char id, unsigned char cmd, short data,
+            std::function<void(const MotorReply &)> callback = nullptr,
+            double deadline = -1);
+  std::future<MotorReply> request(int priority, unsigned char id,
+                                  unsigned char cmd, short data,
+                                  double deadline = -1);
+  bool sendGroup(int priority, const GroupWrite *group, int num_group,
+                 std::function<void(const MotorReply &)> callback = nullptr,
+                 double deadline = -1);
+  void discard();
+  BusClassStatus checkStatus(int priority);
+  ~BusScheduler();
+
+private:
+  using Clock = std::chrono::steady_clock;
+  static constexpr int QUEUE_SIZE = 64;
+  struct Job {
+    SendDataFormat send_data;
+    std::vector<GroupWrite> group; // 空でなければsend_dataの代わりに同期書き込み
+    std::function<void(const MotorReply &)> callback;
+    Clock::time_point queued_time;
+    Clock::time_point deadline;
+    unsigned int generation; // 積んだ時のgeneration_, discard()で古くなる
+  };
+  struct BusClass {
+    BusClass() : queue(QUEUE_SIZE) {}
+    RingBuffer<Job> queue;
+    std::atomic<int> budget;        // 1周期に送れる数, 負なら無制限
+    std::atomic<double> deadline;   // 積んでからの締め切り[s]
+    std::atomic<bool> drop_expired; // 締め切りを過ぎたものを捨てるか
+    bool has_head;  // queueから取り出して送信待ちのJob
+    Job head;
+    int num_sent_cycle;
+    BusClassStatus status;
+  };
+
+  MotorSerial &ms_;
+  double cycle_;
+  BusClass bus_class_[NUM_BUS_CLASS];
+  std::thread scheduling_thread_;
+  std::atomic<bool> thread_loop_flag_;
+  std::atomic<bool> thread_sleep_flag_;
+  std::atomic<unsigned int> generation_;
+  std::mutex sleep_mtx_;
+  std::condition_variable sleep_cv_;
+  std::mutex status_mtx_;
+  bool push(int priority, Job &job, double deadline);
+  void schedulingLoop();
+  int selectClass();
+};
+} // namespace arrc_raspi
+#endif
@@ -0,0 +1,53 @@
+#ifndef ARRC_RASPI_BUS_TELEMETRY_HPP
+#define ARRC_RASPI_BUS_TELEMETRY_HPP
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace arrc_raspi {
+// 往復時間のヒストグラム, i番目のビンは[LATENCY_BIN_MIN * 2^(i-1), LATENCY_BIN_MIN * 2^i)
+// 0番目はLATENCY_BIN_MIN未満, 最後のビンはそれ以上すべて
+constexpr int NUM_LATENCY_BIN = 12;
+constexpr double LATENCY_BIN_MIN = 100e-6; // [s]
+
+struct TelemetryEntry {
+  unsigned char id;
+  unsigned char cmd;
+  unsigned long frames;     // 送信したフレーム数(再送を含む)
+  unsigned long replies;    // 正しい返信を受け取った数
+  unsigned long timeouts;   // タイムアウトまでに正しい返信が来なかった数(再送ごと)
+  unsigned long sum_errors; // チェックサムが合わなかった返信の数
+  unsigned long com_errors; // シリアルの読み込みエラーの数
+  unsigned long retries;    // 再送した数
+  unsigned long tx_bytes;
+  unsigned long rx_bytes;
+  double min_latency; // 正しい返信の往復時間[s]
+  double max_latency;
+  double sum_latency;
+  unsigned long histogram[NUM_LATENCY_BIN];
+};
+
+class BusTelemetry {
+public:
+  BusTelemetry();
+  void recordFrame(unsigned char id, unsigned char cmd, int tx_bytes,
+                   bool is_retry);
+  void recordReply(unsigned char id, unsigned char cmd, int rx_bytes,
+                   int num_sum_error, bool is_com_error, bool is_success,
+                   double latency);
+  std::vector<TelemetryEntry> snapshot();
+  void reset();
+  void dump(std::ostream &os);
+  bool dumpEvery(double period, std::ostream &os);
+  static double binUpper(int bin);
+
+private:
+  TelemetryEntry &entry(unsigned char id, unsigned char cmd);
+  std::map<int, TelemetryEntry> entry_;
+  std::chrono::steady_clock::time_point last_dump_;
+  std::mutex mtx_;
+};
+} // namespace arrc_raspi
+#endif
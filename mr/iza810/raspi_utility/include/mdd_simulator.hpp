@@ -0,0 +1,60 @@
+#ifndef ARRC_RASPI_MDD_SIMULATOR_HPP
+#define ARRC_RASPI_MDD_SIMULATOR_HPP
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace arrc_raspi {
+// ScrpSlave::addCMDと同じ形の処理, trueを返すとtx_dataを返信する
+using SimulatorHandler = std::function<bool(int cmd, int rx_data, int &tx_data)>;
+
+struct SimulatorCount {
+  unsigned long received;    // 自分宛に受け取ったフレーム数
+  unsigned long replied;     // 返信した数
+  unsigned long dropped;     // drop_rateで返信しなかった数
+  unsigned long corrupted;   // corrupt_rateでチェックサムを壊して返信した数
+  unsigned long unknown_cmd; // 処理が登録されていないcmdの数
+};
+
+// 疑似端末の先にMDDが繋がっているふりをするクラス(Linuxのみ)
+class MddSimulator {
+public:
+  MddSimulator(unsigned int seed = 0);
+  bool checkInit();
+  const char *checkDevice();
+  void addSlave(unsigned char id, double latency = 0, double drop_rate = 0,
+                double corrupt_rate = 0);
+  void setLatency(unsigned char id, double latency);
+  void setDropRate(unsigned char id, double drop_rate);
+  void setCorruptRate(unsigned char id, double corrupt_rate);
+  void addCMD(unsigned char id, unsigned char cmd, SimulatorHandler handler);
+  SimulatorCount checkCount(unsigned char id);
+  unsigned long checkSumError();
+  ~MddSimulator();
+
+private:
+  struct Slave {
+    double latency;      // 受信してから返信するまで[s]
+    double drop_rate;    // 返信しない確率
+    double corrupt_rate; // チェックサムを壊す確率
+    std::map<int, SimulatorHandler> handler;
+    SimulatorCount count;
+  };
+  int master_fd_;
+  std::string device_;
+  std::map<int, Slave> slave_;
+  std::mt19937 engine_;
+  std::atomic<unsigned long> num_sum_error_;
+  std::atomic<bool> thread_loop_flag_;
+  std::thread slave_thread_;
+  std::mutex mtx_;
+  void slaveLoop();
+  void receive(unsigned char *frame);
+  void reply(unsigned char id, unsigned char cmd, int tx_data, bool corrupt);
+};
+} // namespace arrc_raspi
+#endif
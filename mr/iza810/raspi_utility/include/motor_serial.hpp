@@ -1,10 +1,15 @@
 #ifndef ARRC_RASPI_MOTOR_SERIAL_HPP
 #define ARRC_RASPI_MOTOR_SERIAL_HPP
+#include "bus_telemetry.hpp"
 #include "pigpiod.hpp"
+#include "ring_buffer.hpp"
 #include "serial.hpp"
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
 
@@ -15,28 +20,97 @@ struct SendDataFormat {
   short argData;
 };
 
+// 同期書き込み, 一斉送信(id 255)のcmd GROUP_STAGE_CMD + slotで値を仮置きし,
+// cmd GROUP_LATCH_CMDで全てのMDDが仮置きした値を同時に反映する
+constexpr unsigned char GROUP_STAGE_CMD = 200;
+constexpr unsigned char GROUP_LATCH_CMD = 254;
+constexpr int NUM_GROUP_SLOT = GROUP_LATCH_CMD - GROUP_STAGE_CMD;
+
+struct GroupWrite {
+  unsigned char slot; // 0 ~ NUM_GROUP_SLOT - 1, どのMDDのどのcmdかはMDD側で決める
+  short data;
+};
+
+struct MotorReply {
+  short data;
+  bool is_sent;           // キューが満杯で送れなかった時はfalse
+  bool sum_check_success;
+  double round_trip;      // 送信開始から受信完了までの時間[s]
+};
+
+struct AsyncReply {
+  unsigned char cmd;
+  short data;
+  bool sum_check_success;
+  unsigned int count = 0; // そのIDで何回目の完了か
+};
+
 class MotorSerial {
 public:
   MotorSerial(const char *dev_file = "/dev/ttyAMA0", int baudrate = 115200,
-              int rede = 4, int timeout = 10);
+              int rede = 4, int timeout = 10, int backend = PIGPIOD_SERIAL);
   int send();
   void setTimeOut(int timeout);
+  void setBurstMode(bool burst);
+  void setRetry(int retry);
   short sending(unsigned char id, unsigned char cmd, short data);
+  MotorReply transmit(unsigned char id, unsigned char cmd, short data);
   short send(unsigned char id, unsigned char cmd, short data,
              bool async_flag = false);
   short send(const SendDataFormat &send_data, bool async_flag);
+  bool post(const SendDataFormat &send_data);
+  bool sendGroup(const GroupWrite *group, int num_group);
+  std::future<MotorReply> request(unsigned char id, unsigned char cmd,
+                                  short data);
+  bool request(unsigned char id, unsigned char cmd, short data,
+               std::function<void(const MotorReply &)> callback);
+  bool checkReply(unsigned char id, AsyncReply &reply);
+  void discard();
+  int checkQueue();
+  unsigned long checkDropped();
+  BusTelemetry &checkTelemetry();
   virtual ~MotorSerial();
   bool sum_check_success_;
   short recent_receive_data_;
 
 private:
+  static constexpr int SEND_QUEUE_SIZE = 64;
+  struct SendRequest {
+    SendDataFormat send_data;
+    std::function<void(const MotorReply &)> callback;
+    unsigned int generation; // 積んだ時のgeneration_, discard()で古くなる
+  };
+  struct ReplySlot {
+    std::atomic<unsigned int> sequence;
+    std::atomic<unsigned char> cmd;
+    std::atomic<short> data;
+    std::atomic<bool> sum_check_success;
+  };
+
   Serial serial_;
   void sendingLoop();
-  bool thread_loop_flag_;
+  bool push(SendRequest &send_request);
+  bool burst_mode_;
+  std::atomic<int> retry_;
   int timeout_;
+  int baudrate_;
   int rede_pin_;
+  double transmitTime(int num_byte);
+  MotorReply transmitFrame(unsigned char id, unsigned char cmd, short data);
+  void writeRede(int level);
+  void writeFrame(unsigned char *send_array, int num_byte);
+  bool readReply(unsigned char *receive_array, int &num_rx, int &num_sum_error,
+                 bool &is_com_error);
+  BusTelemetry telemetry_;
   std::thread send_thread_;
-  std::queue<SendDataFormat> send_data_queue_;
+  RingBuffer<SendRequest> send_ring_;
+  std::atomic<bool> thread_loop_flag_;
+  std::atomic<bool> thread_sleep_flag_;
+  std::atomic<unsigned long> num_dropped_;
+  std::atomic<unsigned int> generation_;
+  std::mutex sleep_mtx_;
+  std::condition_variable sleep_cv_;
+  ReplySlot reply_slot_[256];
   std::mutex mtx_;
 };
 }; // namespace arrc_raspi
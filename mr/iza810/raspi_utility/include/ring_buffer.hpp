@@ -0,0 +1,96 @@
+#ifndef ARRC_RASPI_RING_BUFFER_HPP
+#define ARRC_RASPI_RING_BUFFER_HPP
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace arrc_raspi {
+// 複数スレッドからpush, 1スレッドからpopできるロックフリーなリングバッファ
+// (D. Vyukov, Bounded MPMC queue). 容量は2のべき乗に切り上げる
+template <class T> class RingBuffer {
+public:
+  RingBuffer(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cell_.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i) {
+      cell_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+  }
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  // 満杯ならfalse
+  bool push(const T &data) {
+    Cell *cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cell_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      long diff = (long)sequence - (long)pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = data;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 空ならfalse
+  bool pop(T &data) {
+    Cell *cell;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cell_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      long diff = (long)sequence - (long)(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    data = std::move(cell->data);
+    cell->data = T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    size_t enqueue_pos = enqueue_pos_.load(std::memory_order_acquire);
+    size_t dequeue_pos = dequeue_pos_.load(std::memory_order_acquire);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+  bool empty() const { return size() == 0; }
+  size_t capacity() const { return mask_ + 1; }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+  std::unique_ptr<Cell[]> cell_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+} // namespace arrc_raspi
+#endif
@@ -4,20 +4,30 @@
 #include <pigpiod_if2.h>
 
 namespace arrc_raspi {
+constexpr int PIGPIOD_SERIAL = 0;
+constexpr int NATIVE_SERIAL = 1;
+
 class Serial {
 public:
-  Serial();
+  Serial(int backend = PIGPIOD_SERIAL);
   bool init(const char *dev_file, int baudrate);
   int write(unsigned char tx_data);
   int writes(char *tx_data, unsigned int tx_len);
   int read();
   int reads(char *rx_data, unsigned int rx_len);
   int available();
+  int wait(int timeout_ms);
+  bool drain();
+  int flush();
+  int checkBackend();
   ~Serial();
 
 private:
+  int backend_;
   int gpio_handle_;
   int serial_handle_;
+  int fd_;
+  bool openNative(const char *dev_file, int baudrate);
 };
 };
 #endif
@@ -0,0 +1,52 @@
+#ifndef ARRC_RASPI_SHADOW_REGISTER_HPP
+#define ARRC_RASPI_SHADOW_REGISTER_HPP
+#include "bus_scheduler.hpp"
+#include <chrono>
+#include <map>
+#include <mutex>
+
+namespace arrc_raspi {
+struct ShadowCount {
+  unsigned long set;        // set()が呼ばれた回数
+  unsigned long posted;     // 実際にバスへ送った回数
+  unsigned long coalesced;  // 送る前に新しい値で上書きされた回数
+  unsigned long suppressed; // 値が変わっていないので送らなかった回数
+  unsigned long refreshed;  // 値は同じだがkeep aliveで送り直した回数
+  unsigned long dropped;    // バスで捨てられ(締め切り切れなど)次のflushに回した回数
+};
+
+class ShadowRegister {
+public:
+  ShadowRegister(BusScheduler &bus, double keep_alive = 0.5,
+                 int max_in_flight = 8);
+  void setKeepAlive(double keep_alive);
+  void set(unsigned char id, unsigned char cmd, short data);
+  void setGroup(unsigned char slot, short data);
+  int flush();
+  void clear();
+  ShadowCount checkCount();
+  ~ShadowRegister();
+
+private:
+  struct Entry {
+    short pending_data;
+    short sent_data;
+    bool is_pending;
+    bool has_sent;
+    std::chrono::steady_clock::time_point sent_time;
+  };
+  BusScheduler &bus_;
+  double keep_alive_;
+  int max_in_flight_;
+  int num_in_flight_; // BUS_MOTIONに積んで, まだコールバックが来ていない数
+  std::map<int, Entry> table_;
+  std::map<int, Entry> group_table_; // sendGroup()で送るslotごとの値
+  ShadowCount count_;
+  std::mutex mtx_;
+  void update(Entry &entry, short data);
+  int flushGroup();
+  void finish(std::map<int, Entry> &table, int key, short data,
+              const MotorReply &reply);
+};
+} // namespace arrc_raspi
+#endif
@@ -0,0 +1,268 @@
+#include "../include/bus_scheduler.hpp"
+#include "../include/motor_serial.hpp"
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+
+using namespace arrc_raspi;
+using namespace std;
+
+namespace {
+// 一斉送信には返信が無い
+constexpr unsigned char BROADCAST_ID = 255;
+
+double toSec(chrono::steady_clock::duration duration) {
+  return chrono::duration_cast<chrono::duration<double>>(duration).count();
+}
+} // namespace
+
+BusScheduler::BusScheduler(MotorSerial &ms, double cycle) : ms_(ms) {
+  cycle_ = cycle;
+  // 予算[frame/cycle], 締め切り[s]の初期値
+  constexpr int BUDGET[NUM_BUS_CLASS] = {-1, 8, 4, 1};
+  constexpr double DEADLINE[NUM_BUS_CLASS] = {0.005, 0.01, 0.05, 0.5};
+  constexpr bool DROP_EXPIRED[NUM_BUS_CLASS] = {false, true, false, true};
+  for (int i = 0; i < NUM_BUS_CLASS; ++i) {
+    bus_class_[i].budget = BUDGET[i];
+    bus_class_[i].deadline = DEADLINE[i];
+    bus_class_[i].drop_expired = DROP_EXPIRED[i];
+    bus_class_[i].has_head = false;
+    bus_class_[i].num_sent_cycle = 0;
+    bus_class_[i].status = {};
+  }
+  thread_sleep_flag_ = false;
+  generation_ = 0;
+  thread_loop_flag_ = true;
+  scheduling_thread_ = thread([this] { schedulingLoop(); });
+  sched_param sch_params;
+  sch_params.sched_priority = 1;
+  if (pthread_setschedparam(scheduling_thread_.native_handle(), SCHED_RR,
+                            &sch_params)) {
+    cout << "Failed to set Thread scheduling" << endl;
+  }
+}
+
+void BusScheduler::setBudget(int priority, int frames_per_cycle) {
+  bus_class_[priority].budget = frames_per_cycle;
+}
+
+void BusScheduler::setDeadline(int priority, double deadline) {
+  bus_class_[priority].deadline = deadline;
+}
+
+void BusScheduler::setDropExpired(int priority, bool drop) {
+  bus_class_[priority].drop_expired = drop;
+}
+
+// deadline < 0ならクラスの締め切りを使う, キューが満杯ならfalse
+bool BusScheduler::send(int priority, unsigned char id, unsigned char cmd,
+                        short data,
+                        function<void(const MotorReply &)> callback,
+                        double deadline) {
+  Job job;
+  job.send_data = {id, cmd, data};
+  job.callback = callback;
+  return push(priority, job, deadline);
+}
+
+// MotorSerial::sendGroup()と同じ同期書き込みを1つのフレームの列として積む
+// 返信は無いので, コールバックのis_sentとsum_check_successは書き込めたかどうか
+bool BusScheduler::sendGroup(int priority, const GroupWrite *group,
+                             int num_group,
+                             function<void(const MotorReply &)> callback,
+                             double deadline) {
+  if (num_group <= 0 || num_group > NUM_GROUP_SLOT) {
+    return false;
+  }
+  Job job;
+  job.send_data = {};
+  job.group.assign(group, group + num_group);
+  job.callback = callback;
+  return push(priority, job, deadline);
+}
+
+bool BusScheduler::push(int priority, Job &job, double deadline) {
+  BusClass &bus_class = bus_class_[priority];
+  job.queued_time = Clock::now();
+  job.generation = generation_;
+  if (deadline < 0) {
+    deadline = bus_class.deadline;
+  }
+  job.deadline = job.queued_time + chrono::duration_cast<Clock::duration>(
+                                       chrono::duration<double>(deadline));
+  bool is_queued = bus_class.queue.push(job);
+  {
+    lock_guard<mutex> lock(status_mtx_);
+    is_queued ? ++bus_class.status.queued : ++bus_class.status.rejected;
+  }
+  if (is_queued && thread_sleep_flag_) {
+    lock_guard<mutex> lock(sleep_mtx_);
+    sleep_cv_.notify_one();
+  }
+  return is_queued;
+}
+
+future<MotorReply> BusScheduler::request(int priority, unsigned char id,
+                                         unsigned char cmd, short data,
+                                         double deadline) {
+  auto reply_promise = make_shared<promise<MotorReply>>();
+  future<MotorReply> reply_future = reply_promise->get_future();
+  bool is_queued = send(priority, id, cmd, data,
+                        [reply_promise](const MotorReply &reply) {
+                          reply_promise->set_value(reply);
+                        },
+                        deadline);
+  if (!is_queued) {
+    MotorReply reply = {0, false, false, 0};
+    reply_promise->set_value(reply);
+  }
+  return reply_future;
+}
+
+// BUS_EMERGENCY以外のクラスで送信待ちのものを全て送らずに捨てる
+// 捨てたものにはis_sent = falseの返信が入る. 送信中のフレームは止められない
+void BusScheduler::discard() { ++generation_; }
+
+BusClassStatus BusScheduler::checkStatus(int priority) {
+  lock_guard<mutex> lock(status_mtx_);
+  return bus_class_[priority].status;
+}
+
+// 予算内のクラスを優先度順に探し, 無ければ予算超過のクラスを優先度順に探す
+// 送信中のフレーム以外は常に優先度の高いものが先に出るので,
+// 非常停止は送信が始まっていない全てのフレームを追い越す
+int BusScheduler::selectClass() {
+  int over_budget_class = -1;
+  for (int i = 0; i < NUM_BUS_CLASS; ++i) {
+    BusClass &bus_class = bus_class_[i];
+    if (!bus_class.has_head) {
+      bus_class.has_head = bus_class.queue.pop(bus_class.head);
+    }
+    if (!bus_class.has_head) {
+      continue;
+    }
+    int budget = bus_class.budget;
+    if (budget < 0 || bus_class.num_sent_cycle < budget) {
+      return i;
+    }
+    if (over_budget_class < 0) {
+      over_budget_class = i;
+    }
+  }
+  return over_budget_class;
+}
+
+void BusScheduler::schedulingLoop() {
+  Clock::time_point cycle_start = Clock::now();
+  while (true) {
+    Clock::time_point now = Clock::now();
+    if (toSec(now - cycle_start) >= cycle_) {
+      cycle_start = now;
+      for (BusClass &bus_class : bus_class_) {
+        bus_class.num_sent_cycle = 0;
+      }
+    }
+
+    int priority = selectClass();
+    if (priority >= 0) {
+      BusClass &bus_class = bus_class_[priority];
+      Job job = move(bus_class.head);
+      bus_class.has_head = false;
+      double wait = toSec(now - job.queued_time);
+      // 送信は全てこのスレッドなので, discard()の後に積まれた非常停止より
+      // 前に積まれたフレームが後から出ることはない
+      if (priority != BUS_EMERGENCY && job.generation != generation_) {
+        {
+          lock_guard<mutex> lock(status_mtx_);
+          ++bus_class.status.discarded;
+        }
+        if (job.callback) {
+          MotorReply reply = {0, false, false, 0};
+          job.callback(reply);
+        }
+        continue;
+      }
+      if (now > job.deadline && bus_class.drop_expired) {
+        {
+          lock_guard<mutex> lock(status_mtx_);
+          ++bus_class.status.expired;
+          ++bus_class.status.deadline_miss;
+        }
+        if (job.callback) {
+          MotorReply reply = {0, false, false, 0};
+          job.callback(reply);
+        }
+        continue;
+      }
+      bool is_over_budget = bus_class.budget >= 0 &&
+                            bus_class.num_sent_cycle >= bus_class.budget;
+      ++bus_class.num_sent_cycle;
+      MotorReply reply;
+      if (job.group.empty()) {
+        reply = ms_.transmit(job.send_data.id, job.send_data.cmd,
+                             job.send_data.argData);
+      } else {
+        bool is_written = ms_.sendGroup(job.group.data(), job.group.size());
+        reply = {0, is_written, is_written, toSec(Clock::now() - now)};
+      }
+      bool is_missed = Clock::now() > job.deadline;
+      bool is_sum_error = job.group.empty() &&
+                          job.send_data.id != BROADCAST_ID &&
+                          !reply.sum_check_success;
+      {
+        lock_guard<mutex> lock(status_mtx_);
+        BusClassStatus &status = bus_class.status;
+        ++status.sent;
+        if (is_over_budget) {
+          ++status.over_budget;
+        }
+        if (is_missed) {
+          ++status.deadline_miss;
+        }
+        if (is_sum_error) {
+          ++status.sum_error;
+        }
+        status.sum_wait += wait;
+        if (wait > status.max_wait) {
+          status.max_wait = wait;
+        }
+      }
+      if (job.callback) {
+        job.callback(reply);
+      }
+      continue;
+    }
+
+    if (!thread_loop_flag_) {
+      break;
+    }
+    unique_lock<mutex> lock(sleep_mtx_);
+    thread_sleep_flag_ = true;
+    bool is_empty = true;
+    for (BusClass &bus_class : bus_class_) {
+      if (!bus_class.queue.empty()) {
+        is_empty = false;
+      }
+    }
+    if (is_empty && thread_loop_flag_) {
+      sleep_cv_.wait_for(lock, chrono::milliseconds(10));
+    }
+    thread_sleep_flag_ = false;
+  }
+}
+
+BusScheduler::~BusScheduler() {
+  thread_loop_flag_ = false;
+  {
+    lock_guard<mutex> lock(sleep_mtx_);
+    sleep_cv_.notify_one();
+  }
+  if (scheduling_thread_.joinable()) {
+    scheduling_thread_.join();
+  }
+}
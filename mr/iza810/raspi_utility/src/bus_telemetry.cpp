@@ -0,0 +1,120 @@
+#include "../include/bus_telemetry.hpp"
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+using namespace arrc_raspi;
+using namespace std;
+
+BusTelemetry::BusTelemetry() { last_dump_ = chrono::steady_clock::now(); }
+
+// mtx_を取ってから呼ぶこと
+TelemetryEntry &BusTelemetry::entry(unsigned char id, unsigned char cmd) {
+  auto it = entry_.find(id << 8 | cmd);
+  if (it == entry_.end()) {
+    TelemetryEntry new_entry = {};
+    new_entry.id = id;
+    new_entry.cmd = cmd;
+    it = entry_.emplace(id << 8 | cmd, new_entry).first;
+  }
+  return it->second;
+}
+
+void BusTelemetry::recordFrame(unsigned char id, unsigned char cmd,
+                               int tx_bytes, bool is_retry) {
+  lock_guard<mutex> lock(mtx_);
+  TelemetryEntry &dummy = entry(id, cmd);
+  ++dummy.frames;
+  dummy.tx_bytes += tx_bytes;
+  if (is_retry) {
+    ++dummy.retries;
+  }
+}
+
+void BusTelemetry::recordReply(unsigned char id, unsigned char cmd,
+                               int rx_bytes, int num_sum_error,
+                               bool is_com_error, bool is_success,
+                               double latency) {
+  lock_guard<mutex> lock(mtx_);
+  TelemetryEntry &dummy = entry(id, cmd);
+  dummy.rx_bytes += rx_bytes;
+  dummy.sum_errors += num_sum_error;
+  if (is_com_error) {
+    ++dummy.com_errors;
+  }
+  if (!is_success) {
+    ++dummy.timeouts;
+    return;
+  }
+  ++dummy.replies;
+  if (dummy.replies == 1 || latency < dummy.min_latency) {
+    dummy.min_latency = latency;
+  }
+  if (latency > dummy.max_latency) {
+    dummy.max_latency = latency;
+  }
+  dummy.sum_latency += latency;
+  int bin = 0;
+  while (bin < NUM_LATENCY_BIN - 1 && latency >= binUpper(bin)) {
+    ++bin;
+  }
+  ++dummy.histogram[bin];
+}
+
+// bin番目のビンの上限[s]
+double BusTelemetry::binUpper(int bin) { return LATENCY_BIN_MIN * (1 << bin); }
+
+vector<TelemetryEntry> BusTelemetry::snapshot() {
+  lock_guard<mutex> lock(mtx_);
+  vector<TelemetryEntry> entries;
+  entries.reserve(entry_.size());
+  for (auto &it : entry_) {
+    entries.push_back(it.second);
+  }
+  return entries;
+}
+
+void BusTelemetry::reset() {
+  lock_guard<mutex> lock(mtx_);
+  entry_.clear();
+}
+
+void BusTelemetry::dump(ostream &os) {
+  vector<TelemetryEntry> entries = snapshot();
+  // 呼んだ側(coutなど)の書式を変えたままにしないように戻す
+  ios::fmtflags flags = os.flags();
+  streamsize precision = os.precision();
+  os << " id cmd   frames  replies timeouts sum_err com_err retries"
+        "  avg[ms]  max[ms]  histogram(<0.1ms, x2...)"
+     << endl;
+  for (TelemetryEntry &dummy : entries) {
+    os << setw(3) << (int)dummy.id << setw(4) << (int)dummy.cmd << setw(9)
+       << dummy.frames << setw(9) << dummy.replies << setw(9)
+       << dummy.timeouts << setw(8) << dummy.sum_errors << setw(8)
+       << dummy.com_errors << setw(8) << dummy.retries << fixed
+       << setprecision(3) << setw(9)
+       << (dummy.replies ? dummy.sum_latency / dummy.replies * 1000 : 0)
+       << setw(9) << dummy.max_latency * 1000 << " ";
+    os.flags(flags);
+    for (int i = 0; i < NUM_LATENCY_BIN; ++i) {
+      os << " " << dummy.histogram[i];
+    }
+    os << endl;
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
+
+// メインループで毎周期呼んで, period(s)経っていればdumpしてtrueを返す
+bool BusTelemetry::dumpEvery(double period, ostream &os) {
+  auto now = chrono::steady_clock::now();
+  if (chrono::duration_cast<chrono::duration<double>>(now - last_dump_)
+          .count() < period) {
+    return false;
+  }
+  last_dump_ = now;
+  dump(os);
+  return true;
+}
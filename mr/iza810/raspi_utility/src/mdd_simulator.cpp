@@ -0,0 +1,183 @@
+#include "../include/mdd_simulator.hpp"
+#include <chrono>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <random>
+#include <stdlib.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace arrc_raspi;
+using namespace std;
+
+constexpr int STX = 0x41;
+constexpr int SEND_DATA_NUM = 7;
+constexpr int BROADCAST_ID = 255;
+
+MddSimulator::MddSimulator(unsigned int seed) : engine_(seed) {
+  num_sum_error_ = 0;
+  thread_loop_flag_ = false;
+  master_fd_ = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master_fd_ < 0 || grantpt(master_fd_) < 0 || unlockpt(master_fd_) < 0) {
+    cout << "Pseudo Terminal Open Failed" << endl;
+    if (master_fd_ >= 0) {
+      close(master_fd_);
+      master_fd_ = -1;
+    }
+    return;
+  }
+  termios tio;
+  tcgetattr(master_fd_, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(master_fd_, TCSANOW, &tio);
+  fcntl(master_fd_, F_SETFL, fcntl(master_fd_, F_GETFL) | O_NONBLOCK);
+  device_ = ptsname(master_fd_);
+
+  thread_loop_flag_ = true;
+  slave_thread_ = thread([this] { slaveLoop(); });
+}
+
+bool MddSimulator::checkInit() { return master_fd_ >= 0; }
+
+// MotorSerialのdev_fileに渡す疑似端末のパス
+const char *MddSimulator::checkDevice() { return device_.c_str(); }
+
+void MddSimulator::addSlave(unsigned char id, double latency, double drop_rate,
+                            double corrupt_rate) {
+  lock_guard<mutex> lock(mtx_);
+  Slave &slave = slave_[id];
+  slave.latency = latency;
+  slave.drop_rate = drop_rate;
+  slave.corrupt_rate = corrupt_rate;
+  slave.count = {};
+}
+
+void MddSimulator::setLatency(unsigned char id, double latency) {
+  lock_guard<mutex> lock(mtx_);
+  slave_[id].latency = latency;
+}
+
+void MddSimulator::setDropRate(unsigned char id, double drop_rate) {
+  lock_guard<mutex> lock(mtx_);
+  slave_[id].drop_rate = drop_rate;
+}
+
+void MddSimulator::setCorruptRate(unsigned char id, double corrupt_rate) {
+  lock_guard<mutex> lock(mtx_);
+  slave_[id].corrupt_rate = corrupt_rate;
+}
+
+// handlerはシミュレータのスレッドで呼ばれます
+void MddSimulator::addCMD(unsigned char id, unsigned char cmd,
+                          SimulatorHandler handler) {
+  lock_guard<mutex> lock(mtx_);
+  slave_[id].handler[cmd] = handler;
+}
+
+SimulatorCount MddSimulator::checkCount(unsigned char id) {
+  lock_guard<mutex> lock(mtx_);
+  auto it = slave_.find(id);
+  if (it == slave_.end()) {
+    return SimulatorCount();
+  }
+  return it->second.count;
+}
+
+// チェックサムが合わずに捨てたフレームの数
+unsigned long MddSimulator::checkSumError() { return num_sum_error_; }
+
+void MddSimulator::slaveLoop() {
+  unsigned char frame[SEND_DATA_NUM];
+  int i = 0;
+  while (thread_loop_flag_) {
+    pollfd pfd = {master_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, 10) <= 0) {
+      continue;
+    }
+    unsigned char got_data;
+    while (::read(master_fd_, &got_data, 1) == 1) {
+      if ((i == 0 && got_data != 0xFF) || (i == 1 && got_data != STX)) {
+        i = 0;
+        continue;
+      }
+      frame[i++] = got_data;
+      if (i == SEND_DATA_NUM) {
+        i = 0;
+        receive(frame);
+      }
+    }
+  }
+}
+
+// 1フレーム分の処理, ScrpSlaveと同じく自分宛か一斉送信(id 255)の時だけ処理する
+// 一斉送信は全てのスレーブが処理して誰も返信しない
+void MddSimulator::receive(unsigned char *frame) {
+  unsigned char id = frame[2], cmd = frame[3];
+  if (((id + cmd + frame[4] + frame[5]) & 0xFF) != frame[6]) {
+    ++num_sum_error_;
+    return;
+  }
+  int rx_data = (short)(frame[4] | (frame[5] << 8));
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  unique_lock<mutex> lock(mtx_);
+  for (auto &it : slave_) {
+    if (id != it.first && id != BROADCAST_ID) {
+      continue;
+    }
+    Slave &slave = it.second;
+    ++slave.count.received;
+    auto handler = slave.handler.find(cmd);
+    if (handler == slave.handler.end()) {
+      ++slave.count.unknown_cmd;
+      continue;
+    }
+    int tx_data = 0;
+    if (!handler->second(cmd, rx_data, tx_data) || id == BROADCAST_ID) {
+      continue;
+    }
+    if (uniform(engine_) < slave.drop_rate) {
+      ++slave.count.dropped;
+      continue;
+    }
+    bool corrupt = uniform(engine_) < slave.corrupt_rate;
+    corrupt ? ++slave.count.corrupted : ++slave.count.replied;
+    double latency = slave.latency;
+    lock.unlock();
+    this_thread::sleep_for(chrono::duration<double>(latency));
+    reply(id, cmd, tx_data, corrupt);
+    return;
+  }
+}
+
+void MddSimulator::reply(unsigned char id, unsigned char cmd, int tx_data,
+                         bool corrupt) {
+  unsigned short u_data = (unsigned short)tx_data;
+  unsigned char send_array[SEND_DATA_NUM] = {
+      0xFF,
+      STX,
+      id,
+      cmd,
+      (unsigned char)(u_data & 0xFF),
+      (unsigned char)(u_data >> 8),
+      (unsigned char)((id + cmd + (u_data & 0xFF) + (u_data >> 8)) & 0xFF)};
+  if (corrupt) {
+    send_array[SEND_DATA_NUM - 1] ^= 0x5A;
+  }
+  if (::write(master_fd_, send_array, SEND_DATA_NUM) != SEND_DATA_NUM) {
+    cout << "Simulator Write Failed" << endl;
+  }
+}
+
+MddSimulator::~MddSimulator() {
+  thread_loop_flag_ = false;
+  if (slave_thread_.joinable()) {
+    slave_thread_.join();
+  }
+  if (master_fd_ >= 0) {
+    close(master_fd_);
+  }
+}
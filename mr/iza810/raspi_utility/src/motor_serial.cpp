@@ -3,39 +3,101 @@
 #include "../include/serial.hpp"
 #include <chrono>
 #include <cstring>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <pthread.h>
-#include <queue>
 #include <string>
 #include <thread>
 #include <unistd.h>
+#include <vector>
 
 using namespace arrc_raspi;
 using namespace std;
 
 constexpr int STX = 0x41;
 constexpr int SEND_DATA_NUM = 7;
+constexpr int BIT_PER_BYTE = 10; // start + 8bit + stop
+constexpr int GUARD_BIT = 2;
+constexpr double BYTE_SLEEP_TIME = 90; // [us]
+constexpr int BROADCAST_ID = 255;
 
 MotorSerial::MotorSerial(const char *dev_file, int baudrate, int rede,
-                         int timeout) {
+                         int timeout, int backend)
+    : serial_(backend), send_ring_(SEND_QUEUE_SIZE) {
+  sum_check_success_ = false;
+  recent_receive_data_ = 0;
+  thread_sleep_flag_ = false;
+  num_dropped_ = 0;
+  generation_ = 0;
+  for (ReplySlot &slot : reply_slot_) {
+    slot.sequence = 0;
+    slot.cmd = 0;
+    slot.data = 0;
+    slot.sum_check_success = false;
+  }
+  burst_mode_ = true;
+  retry_ = 0;
+  timeout_ = timeout;
+  baudrate_ = baudrate;
+  rede_pin_ = rede;
   if (serial_.init(dev_file, baudrate)) {
-    sum_check_success_ = false;
-    recent_receive_data_ = 0;
-    thread_loop_flag_ = false;
-    timeout_ = timeout;
-    rede_pin_ = rede;
     cout << "MotorSerial Initialize Success" << endl;
   } else {
     cout << "Serial Initialize Failed" << endl;
   }
 
-  Pigpiod::gpio().set(rede_pin_, OUT, 0);
+  if (rede_pin_ >= 0) {
+    Pigpiod::gpio().set(rede_pin_, OUT, 0);
+  }
+
+  // 非同期送信用のスレッドは1つだけ立てて使い回す
+  thread_loop_flag_ = true;
+  send_thread_ = thread([this] { sendingLoop(); });
+  sched_param sch_params;
+  sch_params.sched_priority = 1;
+  if (pthread_setschedparam(send_thread_.native_handle(), SCHED_RR,
+                            &sch_params)) {
+    cout << "Failed to set Thread scheduling" << endl;
+  }
 }
 
 void MotorSerial::setTimeOut(int timeout) { timeout_ = timeout; }
 
+void MotorSerial::setBurstMode(bool burst) { burst_mode_ = burst; }
+
+// 正しい返信が来なかった時にretry回まで送り直す
+void MotorSerial::setRetry(int retry) { retry_ = retry; }
+
+// rede < 0ならRE・DEピンは操作しない(自動切り替えのトランシーバ, 試験用の疑似端末など)
+void MotorSerial::writeRede(int level) {
+  if (rede_pin_ >= 0) {
+    Pigpiod::gpio().write(rede_pin_, level);
+  }
+}
+
+// num_byte分のデータがUARTから出きるまでの時間[us]
+double MotorSerial::transmitTime(int num_byte) {
+  return (num_byte * BIT_PER_BYTE + GUARD_BIT) * 1.0e+6 / baudrate_;
+}
+
 short MotorSerial::sending(unsigned char id, unsigned char cmd, short data) {
+  MotorReply reply = transmit(id, cmd, data);
+  sum_check_success_ = reply.sum_check_success;
+  return (recent_receive_data_ = reply.data);
+}
+
+MotorReply MotorSerial::transmit(unsigned char id, unsigned char cmd,
+                                 short data) {
+  lock_guard<mutex> lock(mtx_);
+  return transmitFrame(id, cmd, data);
+}
+
+// mtx_を取ってから呼ぶこと
+MotorReply MotorSerial::transmitFrame(unsigned char id, unsigned char cmd,
+                                      short data) {
   unsigned short u_data = (unsigned short)data;
   unsigned char send_array[SEND_DATA_NUM] = {
       0xFF,
@@ -45,27 +107,121 @@ short MotorSerial::sending(unsigned char id, unsigned char cmd, short data) {
       (unsigned char)(u_data & 0xFF),
       (unsigned char)(u_data >> 8),
       (unsigned char)((id + cmd + (u_data & 0xFF) + (u_data >> 8)) & 0xFF)};
+
+  MotorReply reply;
+  reply.is_sent = true;
+  reply.sum_check_success = false;
+  unsigned char receive_array[5] = {};
+  auto start_time = std::chrono::steady_clock::now();
+  for (int attempt = 0; attempt <= retry_ && !reply.sum_check_success;
+       ++attempt) {
+    auto attempt_time = std::chrono::steady_clock::now();
+    if (attempt > 0) {
+      // 前の試行の壊れた返信や遅れて来た返信を次の返信と間違えないように捨てる
+      serial_.flush();
+    }
+    writeFrame(send_array, SEND_DATA_NUM);
+    telemetry_.recordFrame(id, cmd, SEND_DATA_NUM, attempt > 0);
+
+    int num_rx = 0, num_sum_error = 0;
+    bool is_com_error = false;
+    reply.sum_check_success =
+        readReply(receive_array, num_rx, num_sum_error, is_com_error);
+    if (is_com_error) {
+      cout << "Serial Com Error" << endl;
+    }
+    telemetry_.recordReply(
+        id, cmd, num_rx, num_sum_error, is_com_error, reply.sum_check_success,
+        std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - attempt_time)
+            .count());
+  }
+  reply.data = (short)(receive_array[2] | (receive_array[3] << 8));
+  reply.round_trip = std::chrono::duration_cast<std::chrono::duration<double>>(
+                         std::chrono::steady_clock::now() - start_time)
+                         .count();
+  return reply;
+}
+
+// num_group個の値を仮置きするフレームと反映するフレームを1回で送る
+// 全て一斉送信なので返信は待たない(バスの折り返しが無い)
+bool MotorSerial::sendGroup(const GroupWrite *group, int num_group) {
+  if (num_group <= 0 || num_group > NUM_GROUP_SLOT) {
+    return false;
+  }
+  vector<unsigned char> send_array((num_group + 1) * SEND_DATA_NUM);
+  for (int i = 0; i <= num_group; ++i) {
+    unsigned char cmd = GROUP_LATCH_CMD;
+    unsigned short u_data = 0;
+    if (i < num_group) {
+      if (group[i].slot >= NUM_GROUP_SLOT) {
+        return false;
+      }
+      cmd = GROUP_STAGE_CMD + group[i].slot;
+      u_data = (unsigned short)group[i].data;
+    }
+    unsigned char *frame = &send_array[i * SEND_DATA_NUM];
+    frame[0] = 0xFF;
+    frame[1] = STX;
+    frame[2] = BROADCAST_ID;
+    frame[3] = cmd;
+    frame[4] = (unsigned char)(u_data & 0xFF);
+    frame[5] = (unsigned char)(u_data >> 8);
+    frame[6] = (unsigned char)((BROADCAST_ID + cmd + (u_data & 0xFF) +
+                                (u_data >> 8)) &
+                               0xFF);
+  }
   lock_guard<mutex> lock(mtx_);
+  writeFrame(send_array.data(), send_array.size());
+  for (int i = 0; i <= num_group; ++i) {
+    telemetry_.recordFrame(BROADCAST_ID, send_array[i * SEND_DATA_NUM + 3],
+                           SEND_DATA_NUM, false);
+  }
+  return true;
+}
 
-  Pigpiod::gpio().write(rede_pin_, 1);
-  for (int i = 0; i < SEND_DATA_NUM; ++i) {
-    serial_.write(send_array[i]);
-    Pigpiod::gpio().delay(90);
+// mtx_を取ってから呼ぶこと
+void MotorSerial::writeFrame(unsigned char *send_array, int num_byte) {
+  writeRede(1);
+  if (burst_mode_) {
+    serial_.writes(reinterpret_cast<char *>(send_array), num_byte);
+    if (!serial_.drain()) {
+      this_thread::sleep_for(chrono::microseconds((int)transmitTime(num_byte)));
+    }
+  } else {
+    for (int i = 0; i < num_byte; ++i) {
+      serial_.write(send_array[i]);
+      this_thread::sleep_for(chrono::microseconds((int)BYTE_SLEEP_TIME));
+    }
   }
-  Pigpiod::gpio().write(rede_pin_, 0);
+  writeRede(0);
+}
 
+// タイムアウトまでに正しい返信(STXの後ろ5byte)が来ればtrue
+// num_rxに読んだbyte数, num_sum_errorにチェックサムが合わなかった数が入る
+bool MotorSerial::readReply(unsigned char *receive_array, int &num_rx,
+                            int &num_sum_error, bool &is_com_error) {
   bool stx_flag = false;
-  char receive_array[5] = {};
   int i = 0;
 
-  auto start_time = std::chrono::system_clock::now();
-  sum_check_success_ = false;
-  while (std::chrono::time_point<std::chrono::system_clock>(
-             start_time + std::chrono::milliseconds(timeout_)) >=
-             std::chrono::system_clock::now() &&
-         !sum_check_success_) {
+  auto end_time =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_);
+  while (true) {
+    auto now = std::chrono::steady_clock::now();
+    if (now > end_time) {
+      break;
+    }
+    int num_available = serial_.wait(
+        std::chrono::duration_cast<std::chrono::milliseconds>(end_time - now)
+            .count() +
+        1);
+    if (num_available < 0) {
+      is_com_error = true;
+      break;
+    }
     while (serial_.available() > 0) {
-      char got_data = serial_.read();
+      unsigned char got_data = serial_.read();
+      ++num_rx;
       if (got_data == STX && !stx_flag) {
         stx_flag = true;
         continue;
@@ -78,45 +234,148 @@ short MotorSerial::sending(unsigned char id, unsigned char cmd, short data) {
         for (int j = 0; j < 4; ++j)
           sum += receive_array[j];
         if (sum == receive_array[4]) {
-          sum_check_success_ = true;
-          break;
+          return true;
         }
+        ++num_sum_error;
+        stx_flag = false;
+        i = 0;
       }
     }
   }
-  if (serial_.available() < 0) {
-    cout << "Serial Com Error" << endl;
-  }
-  return (recent_receive_data_ = receive_array[2] + (receive_array[3] << 8));
+  return false;
 }
 
 void MotorSerial::sendingLoop(void) {
-  while (!send_data_queue_.empty()) {
-    thread_loop_flag_ = true;
-    SendDataFormat sendData = send_data_queue_.front();
-    send_data_queue_.pop();
-    sending(sendData.id, sendData.cmd, sendData.argData);
+  SendRequest send_request;
+  while (true) {
+    if (send_ring_.pop(send_request)) {
+      const SendDataFormat &send_data = send_request.send_data;
+      MotorReply reply = {0, false, false, 0};
+      {
+        // discard()より前に積まれたものは送らずに捨てる
+        lock_guard<mutex> lock(mtx_);
+        if (send_request.generation == generation_) {
+          reply = transmitFrame(send_data.id, send_data.cmd, send_data.argData);
+        }
+      }
+      if (!reply.is_sent) {
+        if (send_request.callback) {
+          send_request.callback(reply);
+        }
+        continue;
+      }
+      // 完了スロットに書き込む(seqlock, 奇数の間は書き込み中)
+      ReplySlot &slot = reply_slot_[send_data.id];
+      unsigned int sequence = slot.sequence.load(memory_order_relaxed);
+      slot.sequence.store(sequence + 1, memory_order_relaxed);
+      atomic_thread_fence(memory_order_release);
+      slot.cmd.store(send_data.cmd, memory_order_relaxed);
+      slot.data.store(reply.data, memory_order_relaxed);
+      slot.sum_check_success.store(reply.sum_check_success,
+                                   memory_order_relaxed);
+      slot.sequence.store(sequence + 2, memory_order_release);
+      if (send_request.callback) {
+        send_request.callback(reply);
+      }
+      continue;
+    }
+    if (!thread_loop_flag_) {
+      break;
+    }
+    unique_lock<mutex> lock(sleep_mtx_);
+    thread_sleep_flag_ = true;
+    if (send_ring_.empty() && thread_loop_flag_) {
+      sleep_cv_.wait_for(lock, chrono::milliseconds(10));
+    }
+    thread_sleep_flag_ = false;
   }
-  thread_loop_flag_ = false;
 }
 
+// リングバッファが満杯ならfalseを返し, 捨てた数を数える
+bool MotorSerial::push(SendRequest &send_request) {
+  send_request.generation = generation_;
+  if (!send_ring_.push(send_request)) {
+    ++num_dropped_;
+    return false;
+  }
+  if (thread_sleep_flag_) {
+    lock_guard<mutex> lock(sleep_mtx_);
+    sleep_cv_.notify_one();
+  }
+  return true;
+}
+
+bool MotorSerial::post(const SendDataFormat &send_data) {
+  SendRequest send_request;
+  send_request.send_data = send_data;
+  return push(send_request);
+}
+
+// 返信はfutureで受け取る, キューが満杯ならis_sent = falseの返信がすぐに入る
+future<MotorReply> MotorSerial::request(unsigned char id, unsigned char cmd,
+                                        short data) {
+  auto reply_promise = make_shared<promise<MotorReply>>();
+  future<MotorReply> reply_future = reply_promise->get_future();
+  bool is_sent = request(id, cmd, data, [reply_promise](const MotorReply &reply) {
+    reply_promise->set_value(reply);
+  });
+  if (!is_sent) {
+    MotorReply reply = {0, false, false, 0};
+    reply_promise->set_value(reply);
+  }
+  return reply_future;
+}
+
+// callbackは送信スレッドで呼ばれるので重い処理はしないこと
+bool MotorSerial::request(unsigned char id, unsigned char cmd, short data,
+                          function<void(const MotorReply &)> callback) {
+  SendRequest send_request;
+  send_request.send_data = {id, cmd, data};
+  send_request.callback = callback;
+  return push(send_request);
+}
+
+// id番のMDDへの非同期送信が完了していればtrue, 前回読んでから完了していなければfalse
+bool MotorSerial::checkReply(unsigned char id, AsyncReply &reply) {
+  ReplySlot &slot = reply_slot_[id];
+  unsigned int sequence;
+  AsyncReply dummy;
+  do {
+    sequence = slot.sequence.load(memory_order_acquire);
+    dummy.cmd = slot.cmd.load(memory_order_relaxed);
+    dummy.data = slot.data.load(memory_order_relaxed);
+    dummy.sum_check_success = slot.sum_check_success.load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+  } while ((sequence & 1) ||
+           sequence != slot.sequence.load(memory_order_relaxed));
+  dummy.count = sequence / 2;
+  bool is_new = dummy.count != reply.count;
+  reply = dummy;
+  return is_new;
+}
+
+// 非同期送信のキューに残っているものを全て送らずに捨てる
+// 返り値を待っているものにはis_sent = falseの返信が入る
+// 安全停止(255/255)を同期送信する前に呼ぶと, 古い目標値に追い越されない
+void MotorSerial::discard() {
+  // 先に世代を進めてから送信中のフレームが終わるのを待つ
+  // (mtx_を待ってから進めると, 送信スレッドがキューを送り切るまで取れないことがある)
+  ++generation_;
+  lock_guard<mutex> lock(mtx_);
+}
+
+int MotorSerial::checkQueue() { return send_ring_.size(); }
+
+unsigned long MotorSerial::checkDropped() { return num_dropped_; }
+
+// id, cmdごとの往復時間のヒストグラムとエラーの数
+BusTelemetry &MotorSerial::checkTelemetry() { return telemetry_; }
+
 short MotorSerial::send(unsigned char id, unsigned char cmd, short data,
                         bool async_flag) {
   if (async_flag) {
-    SendDataFormat sendData = {id, cmd, data};
-    send_data_queue_.push(sendData);
-    if (!thread_loop_flag_) {
-      if (send_thread_.joinable())
-        send_thread_.join();
-      send_thread_ = thread([&] { sendingLoop(); });
-      sched_param sch_params;
-      sch_params.sched_priority = 1;
-      if (pthread_setschedparam(send_thread_.native_handle(), SCHED_RR,
-                                &sch_params)) {
-        cout << "Failed to set Thread scheduling" << endl;
-      }
-    }
-    return 0;
+    SendDataFormat send_data = {id, cmd, data};
+    return post(send_data) ? 0 : -1;
   }
   return sending(id, cmd, data);
 }
@@ -126,6 +385,12 @@ short MotorSerial::send(const SendDataFormat &send_data, bool async_flag) {
 }
 
 MotorSerial::~MotorSerial() {
+  // キューに残っている分を送り切ってから終了する
+  thread_loop_flag_ = false;
+  {
+    lock_guard<mutex> lock(sleep_mtx_);
+    sleep_cv_.notify_one();
+  }
   if (send_thread_.joinable()) {
     send_thread_.join();
   }
@@ -1,34 +1,198 @@
 #include "../include/pigpiod.hpp"
 #include "../include/serial.hpp"
+#include <cerrno>
+#include <fcntl.h>
 #include <pigpiod_if2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
 
 using namespace arrc_raspi;
 
-Serial::Serial() { gpio_handle_ = Pigpiod::gpio().checkHandle(); }
+namespace {
+speed_t toSpeed(int baudrate) {
+  switch (baudrate) {
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 921600:
+    return B921600;
+  default:
+    return B0;
+  }
+}
+} // namespace
+
+Serial::Serial(int backend) {
+  backend_ = backend;
+  gpio_handle_ = -1;
+  serial_handle_ = -1;
+  fd_ = -1;
+  if (backend_ == PIGPIOD_SERIAL) {
+    gpio_handle_ = Pigpiod::gpio().checkHandle();
+  }
+}
 
 bool Serial::init(const char *dev_file, int baudrate) {
+  if (backend_ == NATIVE_SERIAL) {
+    return openNative(dev_file, baudrate);
+  }
   unsigned char dummy_flag = 0;
   serial_handle_ = serial_open(gpio_handle_, const_cast<char *>(dev_file),
                                baudrate, dummy_flag);
   return serial_handle_ < 0 ? false : true;
 }
 
+bool Serial::openNative(const char *dev_file, int baudrate) {
+  speed_t speed = toSpeed(baudrate);
+  if (speed == B0) {
+    return false;
+  }
+  fd_ = open(dev_file, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd_ < 0) {
+    return false;
+  }
+  termios tio;
+  if (tcgetattr(fd_, &tio) < 0) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~CRTSCTS;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  if (tcsetattr(fd_, TCSANOW, &tio) < 0) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  tcflush(fd_, TCIOFLUSH);
+  return true;
+}
+
 int Serial::write(unsigned char tx_data) {
+  if (backend_ == NATIVE_SERIAL) {
+    return writes(reinterpret_cast<char *>(&tx_data), 1) == 1 ? 0 : -1;
+  }
   return serial_write_byte(gpio_handle_, serial_handle_, tx_data);
 }
 
 int Serial::writes(char *tx_data, unsigned int tx_len) {
+  if (backend_ == NATIVE_SERIAL) {
+    // 非ブロッキングなので書き込めるようになるまでpollで待つ
+    unsigned int sent = 0;
+    while (sent < tx_len) {
+      ssize_t n = ::write(fd_, tx_data + sent, tx_len - sent);
+      if (n > 0) {
+        sent += n;
+      } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+        return -1;
+      } else {
+        pollfd pfd = {fd_, POLLOUT, 0};
+        poll(&pfd, 1, -1);
+      }
+    }
+    return sent;
+  }
   return serial_write(gpio_handle_, serial_handle_, tx_data, tx_len);
 }
 
-int Serial::read() { return serial_read_byte(gpio_handle_, serial_handle_); }
+int Serial::read() {
+  if (backend_ == NATIVE_SERIAL) {
+    unsigned char rx_data;
+    return ::read(fd_, &rx_data, 1) == 1 ? rx_data : -1;
+  }
+  return serial_read_byte(gpio_handle_, serial_handle_);
+}
 
 int Serial::reads(char *rx_data, unsigned int rx_len) {
+  if (backend_ == NATIVE_SERIAL) {
+    ssize_t n = ::read(fd_, rx_data, rx_len);
+    if (n < 0) {
+      return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    return n;
+  }
   return serial_read(gpio_handle_, serial_handle_, rx_data, rx_len);
 }
 
 int Serial::available() {
+  if (backend_ == NATIVE_SERIAL) {
+    int num_byte = 0;
+    if (ioctl(fd_, FIONREAD, &num_byte) < 0) {
+      return -1;
+    }
+    return num_byte;
+  }
   return serial_data_available(gpio_handle_, serial_handle_);
 }
 
-Serial::~Serial() { serial_close(gpio_handle_, serial_handle_); }
+// 受信データが来るか, timeout_ms(ms)経つまで待つ
+// pigpiodでは待たずにavailable()を返す
+int Serial::wait(int timeout_ms) {
+  if (backend_ == NATIVE_SERIAL) {
+    pollfd pfd = {fd_, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) < 0 && errno != EINTR) {
+      return -1;
+    }
+  }
+  return available();
+}
+
+// 送信バッファが空になるまで待つ, 出来ない場合はfalse
+bool Serial::drain() {
+  if (backend_ == NATIVE_SERIAL) {
+    return tcdrain(fd_) == 0;
+  }
+  return false;
+}
+
+// 受信バッファに溜まっているデータを捨て, 捨てたbyte数を返す
+// pigpiodにはtcflushが無いので読み切って捨てる
+int Serial::flush() {
+  int num_byte = available();
+  if (num_byte <= 0) {
+    return num_byte;
+  }
+  if (backend_ == NATIVE_SERIAL) {
+    return tcflush(fd_, TCIFLUSH) == 0 ? num_byte : -1;
+  }
+  char dummy[64];
+  int num_flushed = 0;
+  while (num_flushed < num_byte) {
+    int n = reads(dummy, sizeof(dummy));
+    if (n <= 0) {
+      break;
+    }
+    num_flushed += n;
+  }
+  return num_flushed;
+}
+
+int Serial::checkBackend() { return backend_; }
+
+Serial::~Serial() {
+  if (backend_ == NATIVE_SERIAL) {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  } else {
+    serial_close(gpio_handle_, serial_handle_);
+  }
+}
@@ -0,0 +1,185 @@
+#include "../include/shadow_register.hpp"
+#include "../include/bus_scheduler.hpp"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace arrc_raspi;
+using namespace std;
+
+ShadowRegister::ShadowRegister(BusScheduler &bus, double keep_alive,
+                               int max_in_flight)
+    : bus_(bus) {
+  keep_alive_ = keep_alive;
+  max_in_flight_ = max_in_flight;
+  num_in_flight_ = 0;
+  count_ = {};
+}
+
+void ShadowRegister::setKeepAlive(double keep_alive) {
+  lock_guard<mutex> lock(mtx_);
+  keep_alive_ = keep_alive;
+}
+
+// (id, cmd)ごとに最新の値だけを残す
+void ShadowRegister::set(unsigned char id, unsigned char cmd, short data) {
+  lock_guard<mutex> lock(mtx_);
+  update(table_[id << 8 | cmd], data);
+}
+
+// 同期書き込み(sendGroup)のslotごとに最新の値だけを残す
+// どれか1つでも送る必要があれば, flush()で全てのslotを1回の同期書き込みで送る
+void ShadowRegister::setGroup(unsigned char slot, short data) {
+  lock_guard<mutex> lock(mtx_);
+  update(group_table_[slot], data);
+}
+
+// mtx_を取ってから呼ぶこと
+void ShadowRegister::update(Entry &entry, short data) {
+  ++count_.set;
+  if (entry.is_pending) {
+    ++count_.coalesced;
+    entry.pending_data = data;
+    return;
+  }
+  if (entry.has_sent && entry.sent_data == data) {
+    double elapsed = chrono::duration_cast<chrono::duration<double>>(
+                         chrono::steady_clock::now() - entry.sent_time)
+                         .count();
+    if (elapsed < keep_alive_) {
+      ++count_.suppressed;
+      return;
+    }
+    ++count_.refreshed;
+  }
+  entry.pending_data = data;
+  entry.is_pending = true;
+}
+
+// 送信待ちの値をBusSchedulerのBUS_MOTIONに積む, 積んだまま送られていないものが
+// max_in_flight個あれば次回に回す. 同期書き込みのslotは1つの列としてまとめて積む
+int ShadowRegister::flush() {
+  lock_guard<mutex> lock(mtx_);
+  int num_posted = flushGroup();
+  for (auto &x : table_) {
+    Entry &entry = x.second;
+    if (!entry.is_pending) {
+      continue;
+    }
+    if (num_in_flight_ >= max_in_flight_) {
+      break;
+    }
+    int key = x.first;
+    short data = entry.pending_data;
+    if (!bus_.send(BUS_MOTION, (unsigned char)(key >> 8),
+                   (unsigned char)(key & 0xFF), data,
+                   [this, key, data](const MotorReply &reply) {
+                     lock_guard<mutex> lock(mtx_);
+                     --num_in_flight_;
+                     finish(table_, key, data, reply);
+                   })) {
+      break;
+    }
+    ++num_in_flight_;
+    entry.sent_data = data;
+    entry.sent_time = chrono::steady_clock::now();
+    entry.has_sent = true;
+    entry.is_pending = false;
+    ++count_.posted;
+    ++num_posted;
+  }
+  return num_posted;
+}
+
+// 送った値を忘れて, 次のset()から全て送り直す(安全停止でMDDが値を捨てた後など)
+void ShadowRegister::clear() {
+  lock_guard<mutex> lock(mtx_);
+  table_.clear();
+  group_table_.clear();
+}
+
+// mtx_を取ってから呼ぶこと
+int ShadowRegister::flushGroup() {
+  bool is_pending = false;
+  for (auto &x : group_table_) {
+    is_pending |= x.second.is_pending;
+  }
+  if (!is_pending) {
+    return 0;
+  }
+  vector<GroupWrite> group;
+  for (auto &x : group_table_) {
+    Entry &entry = x.second;
+    group.push_back({(unsigned char)x.first,
+                     entry.is_pending ? entry.pending_data : entry.sent_data});
+  }
+  if (num_in_flight_ >= max_in_flight_ ||
+      !bus_.sendGroup(BUS_MOTION, group.data(), group.size(),
+                      [this, group](const MotorReply &reply) {
+                        lock_guard<mutex> lock(mtx_);
+                        --num_in_flight_;
+                        for (const GroupWrite &x : group) {
+                          finish(group_table_, x.slot, x.data, reply);
+                        }
+                      })) {
+    return 0;
+  }
+  ++num_in_flight_;
+  int i = 0, num_posted = 0;
+  auto now = chrono::steady_clock::now();
+  for (auto &x : group_table_) {
+    Entry &entry = x.second;
+    if (entry.is_pending) {
+      ++num_posted;
+    }
+    entry.sent_data = group[i++].data;
+    entry.sent_time = now;
+    entry.has_sent = true;
+    entry.is_pending = false;
+  }
+  count_.posted += num_posted;
+  return num_posted;
+}
+
+// mtx_を取ってから呼ぶこと. BusSchedulerのスレッドのコールバックから呼ばれる
+// 送れずに捨てられた値が最後に送った値のままなら, 送っていないことにして
+// 次のflush()で送り直す(keep aliveまで待たない)
+// clear()で忘れた値や, もう次の値を積んだものはそのまま
+void ShadowRegister::finish(map<int, Entry> &table, int key, short data,
+                            const MotorReply &reply) {
+  if (reply.is_sent) {
+    return;
+  }
+  auto it = table.find(key);
+  if (it == table.end()) {
+    return;
+  }
+  Entry &entry = it->second;
+  if (entry.is_pending || !entry.has_sent || entry.sent_data != data) {
+    return;
+  }
+  entry.pending_data = data;
+  entry.is_pending = true;
+  ++count_.dropped;
+}
+
+ShadowCount ShadowRegister::checkCount() {
+  lock_guard<mutex> lock(mtx_);
+  return count_;
+}
+
+// コールバックがthisを使うので, 積んだものが全て返ってくるまで待つ
+// BusSchedulerより先に壊すこと
+ShadowRegister::~ShadowRegister() {
+  while (true) {
+    {
+      lock_guard<mutex> lock(mtx_);
+      if (num_in_flight_ == 0) {
+        return;
+      }
+    }
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+}
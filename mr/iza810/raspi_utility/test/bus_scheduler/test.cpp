@@ -0,0 +1,87 @@
+#include "../../include/bus_scheduler.hpp"
+#include "../../include/motor_serial.hpp"
+#include "../pty_slave.hpp"
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+
+const char *arrc_raspi::PIGPIOD_HOST = "localhost";
+const char *arrc_raspi::PIGPIOD_PORT = "8888";
+
+using namespace arrc_raspi;
+using namespace std;
+
+// 1フレームごとにreply_delay[us]待ってからエコーを返すスレーブ
+int reply_delay = 500;
+bool delayFrame(unsigned char *frame) {
+  this_thread::sleep_for(chrono::microseconds(reply_delay));
+  return true;
+}
+
+void showStatus(BusScheduler &scheduler) {
+  const char *name[NUM_BUS_CLASS] = {"emergency", "motion", "mechanism",
+                                     "cosmetic"};
+  for (int i = 0; i < NUM_BUS_CLASS; ++i) {
+    BusClassStatus status = scheduler.checkStatus(i);
+    cout << name[i] << "\tqueued: " << status.queued
+         << ", rejected: " << status.rejected << ", sent: " << status.sent
+         << ", over budget: " << status.over_budget
+         << ", deadline miss: " << status.deadline_miss
+         << ", sum error: " << status.sum_error
+         << ", expired: " << status.expired
+         << ", discarded: " << status.discarded << ", wait: "
+         << (status.sent ? status.sum_wait / status.sent * 1000 : 0)
+         << "ms (max " << status.max_wait * 1000 << "ms)" << endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int num_loop = 200;
+  if (argc >= 2) {
+    num_loop = stoi(argv[1]);
+  }
+
+  PtySlave slave(delayFrame);
+  if (!slave.checkInit()) {
+    return 1;
+  }
+
+  {
+    MotorSerial ms(slave.checkDevice(), 115200, -1, 10, NATIVE_SERIAL);
+    BusScheduler scheduler(ms);
+    // 10ms周期で足回り3つ, 射出1つに加えてテープLEDを毎周期溢れるまで積む
+    double max_emergency = 0;
+    for (int i = 0; i < num_loop; ++i) {
+      for (int j = 0; j < 16; ++j) {
+        scheduler.send(BUS_COSMETIC, 6, 10, (short)i);
+      }
+      scheduler.send(BUS_MOTION, 1, 2, (short)i);
+      scheduler.send(BUS_MOTION, 1, 5, (short)-i);
+      scheduler.send(BUS_MOTION, 4, 3, (short)i);
+      scheduler.send(BUS_MECHANISM, 2, 32, (short)i);
+      // 50周期ごとに送信待ちを捨てて非常停止を送り, 返ってくるまでの時間を測る
+      if (i % 50 == 49) {
+        auto start_time = chrono::steady_clock::now();
+        scheduler.discard();
+        future<MotorReply> reply =
+            scheduler.request(BUS_EMERGENCY, 255, 255, 0);
+        reply.wait();
+        double latency = chrono::duration_cast<chrono::duration<double>>(
+                             chrono::steady_clock::now() - start_time)
+                             .count();
+        if (latency > max_emergency) {
+          max_emergency = latency;
+        }
+      }
+      this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+    showStatus(scheduler);
+    cout << "emergency latency (max): " << max_emergency * 1000 << "ms"
+         << endl;
+  }
+
+  return 0;
+}
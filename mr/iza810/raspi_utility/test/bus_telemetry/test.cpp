@@ -0,0 +1,72 @@
+#include "../../include/bus_telemetry.hpp"
+#include "../../include/motor_serial.hpp"
+#include "../pty_slave.hpp"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+
+const char *arrc_raspi::PIGPIOD_HOST = "localhost";
+const char *arrc_raspi::PIGPIOD_PORT = "8888";
+
+using namespace arrc_raspi;
+using namespace std;
+
+// IDごとに調子の違うMDDのふりをするスレーブ
+// 1: すぐ返す, 2: 2ms遅れて返す, 3: 4回に1回チェックサムを壊す, 4: 返さない
+unsigned long num_frame = 0;
+bool faultyFrame(unsigned char *frame) {
+  ++num_frame;
+  switch (frame[2]) {
+  case 2:
+    this_thread::sleep_for(chrono::milliseconds(2));
+    break;
+  case 3:
+    if (num_frame % 4 == 0) {
+      frame[6] ^= 0x5A;
+    }
+    break;
+  case 4:
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  int num_loop = 100;
+  if (argc >= 2) {
+    num_loop = stoi(argv[1]);
+  }
+
+  PtySlave slave(faultyFrame);
+  if (!slave.checkInit()) {
+    return 1;
+  }
+
+  {
+    MotorSerial ms(slave.checkDevice(), 115200, -1, 5, NATIVE_SERIAL);
+    ms.setRetry(1);
+    for (int i = 0; i < num_loop; ++i) {
+      for (int id = 1; id <= 4; ++id) {
+        ms.send(id, 2, (short)i);
+      }
+      ms.checkTelemetry().dumpEvery(0.5, cout);
+    }
+    cout << endl;
+    streamsize precision = cout.precision();
+    ms.checkTelemetry().dump(cout);
+    // dumpがcoutの書式を変えたままにしない
+    cout << "stream format: "
+         << (cout.precision() == precision && !(cout.flags() & ios::fixed)
+                 ? "OK"
+                 : "NG")
+         << endl;
+    cout << "latency bins[ms]:";
+    for (int i = 0; i < NUM_LATENCY_BIN - 1; ++i) {
+      cout << " <" << BusTelemetry::binUpper(i) * 1000;
+    }
+    cout << endl;
+  }
+
+  return 0;
+}
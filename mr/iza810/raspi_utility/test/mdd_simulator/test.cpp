@@ -0,0 +1,238 @@
+#include "../../include/mdd_simulator.hpp"
+#include "../../include/motor_serial.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+const char *arrc_raspi::PIGPIOD_HOST = "localhost";
+const char *arrc_raspi::PIGPIOD_PORT = "8888";
+
+using namespace arrc_raspi;
+using namespace std;
+
+// mr/mdd_slave/mdd3(射出, id 3)のコマンド表を真似たモデル
+// ストロークはSTROKE_SPEED[mm/s]で目標に近づく
+namespace mdd3 {
+constexpr double STROKE_SPEED = 2000;
+constexpr int MAX_STROKE_LENGTH = 370, STROKE_LOAD_LENGTH = 360;
+int phase = 7, goal_stroke = MAX_STROKE_LENGTH, tray_speed = 0, servo = 0;
+double current_stroke = MAX_STROKE_LENGTH;
+bool is_safe = false;
+chrono::steady_clock::time_point last_time = chrono::steady_clock::now();
+
+void update() {
+  auto now = chrono::steady_clock::now();
+  double step =
+      STROKE_SPEED *
+      chrono::duration_cast<chrono::duration<double>>(now - last_time).count();
+  last_time = now;
+  double error = goal_stroke - current_stroke;
+  current_stroke += error > step ? step : (error < -step ? -step : error);
+}
+
+bool startShoot(int cmd, int rx_data, int &tx_data) {
+  update();
+  goal_stroke = rx_data;
+  phase = 3;
+  return true;
+}
+bool setTraySpeed(int cmd, int rx_data, int &tx_data) {
+  tray_speed = rx_data;
+  return true;
+}
+bool setReady(int cmd, int rx_data, int &tx_data) {
+  update();
+  goal_stroke = rx_data;
+  phase = 10;
+  return true;
+}
+bool checkStroke(int cmd, int rx_data, int &tx_data) {
+  update();
+  tx_data = (int)current_stroke;
+  return true;
+}
+bool loadTray(int cmd, int rx_data, int &tx_data) {
+  update();
+  if (rx_data == 1) {
+    phase = 0;
+    goal_stroke = STROKE_LOAD_LENGTH;
+  } else if (rx_data == -1) {
+    phase = 7;
+  }
+  return true;
+}
+bool actServo(int cmd, int rx_data, int &tx_data) {
+  servo = rx_data;
+  return true;
+}
+bool safe(int cmd, int rx_data, int &tx_data) {
+  is_safe = true;
+  tray_speed = 0;
+  return true;
+}
+} // namespace mdd3
+
+// mr/mdd_slave/mdd1, mdd4(足回り)のモデル, 受け取った速度をそのまま返す
+int wheel_speed[3] = {};
+bool spinMotor(int cmd, int rx_data, int &tx_data) {
+  wheel_speed[cmd == 3 ? 2 : (cmd == 2 ? 0 : 1)] = rx_data;
+  tx_data = rx_data;
+  return true;
+}
+// 同期書き込み(mdd1: slot 0, 1, mdd4: slot 2)
+int staged_speed[3] = {};
+unsigned long num_latch = 0;
+bool stageWheel(int cmd, int rx_data, int &tx_data) {
+  staged_speed[cmd - GROUP_STAGE_CMD] = rx_data;
+  return true;
+}
+bool latchWheel(int cmd, int rx_data, int &tx_data) {
+  // id 1, 4の両方で呼ばれるので2回目は同じ値を書くだけ
+  for (int i = 0; i < 3; ++i) {
+    wheel_speed[i] = staged_speed[i];
+  }
+  ++num_latch;
+  return true;
+}
+
+bool safe(int cmd, int rx_data, int &tx_data) {
+  for (int &speed : wheel_speed) {
+    speed = 0;
+  }
+  return true;
+}
+
+int num_ng = 0;
+void check(const string &name, bool result) {
+  cout << (result ? "  OK  " : "  NG  ") << name << endl;
+  if (!result) {
+    ++num_ng;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int num_loop = 500;
+  if (argc >= 2) {
+    num_loop = stoi(argv[1]);
+  }
+
+  MddSimulator sim;
+  if (!sim.checkInit()) {
+    return 1;
+  }
+  // 足回りのid 1は少し遅く, id 4は返信が落ちたり壊れたりする
+  sim.addSlave(1, 200e-6);
+  sim.addSlave(3);
+  sim.addSlave(4, 0, 0.05, 0.05);
+  for (unsigned char id : {1, 4}) {
+    sim.addCMD(id, 255, safe);
+  }
+  sim.addCMD(1, 2, spinMotor);
+  sim.addCMD(1, 5, spinMotor);
+  sim.addCMD(4, 3, spinMotor);
+  sim.addCMD(1, GROUP_STAGE_CMD + 0, stageWheel);
+  sim.addCMD(1, GROUP_STAGE_CMD + 1, stageWheel);
+  sim.addCMD(4, GROUP_STAGE_CMD + 2, stageWheel);
+  sim.addCMD(1, GROUP_LATCH_CMD, latchWheel);
+  sim.addCMD(4, GROUP_LATCH_CMD, latchWheel);
+  sim.addCMD(3, 30, mdd3::startShoot);
+  sim.addCMD(3, 31, mdd3::setTraySpeed);
+  sim.addCMD(3, 32, mdd3::setReady);
+  sim.addCMD(3, 33, mdd3::checkStroke);
+  sim.addCMD(3, 34, mdd3::loadTray);
+  sim.addCMD(3, 35, mdd3::actServo);
+  sim.addCMD(3, 255, mdd3::safe);
+
+  {
+    MotorSerial ms(sim.checkDevice(), 115200, -1, 5, NATIVE_SERIAL);
+
+    cout << "mdd3 command table" << endl;
+    ms.send(3, 32, 200);
+    short stroke = 0;
+    for (int i = 0; i < 100 && stroke != 200; ++i) {
+      this_thread::sleep_for(chrono::milliseconds(5));
+      stroke = ms.send(3, 33, 0);
+    }
+    check("32 setReady -> 33 checkStroke reaches 200", stroke == 200);
+    ms.send(3, 31, 120);
+    check("31 setTraySpeed", mdd3::tray_speed == 120);
+    ms.send(3, 30, 300);
+    check("30 startShoot", mdd3::phase == 3 && mdd3::goal_stroke == 300);
+    ms.send(3, 34, 1);
+    check("34 loadTray(1)", mdd3::phase == 0);
+    ms.send(3, 34, -1);
+    check("34 loadTray(-1)", mdd3::phase == 7);
+    ms.send(3, 35, 11);
+    check("35 actServo", mdd3::servo == 11);
+    check("negative data", ms.send(1, 5, -250) == -250 && ms.sum_check_success_);
+    ms.send(255, 255, 0);
+    this_thread::sleep_for(chrono::milliseconds(20));
+    check("255 safe (broadcast, no reply)",
+          mdd3::is_safe && mdd3::tray_speed == 0 && wheel_speed[1] == 0 &&
+              !ms.sum_check_success_);
+    ms.send(3, 99, 0);
+    check("unknown cmd (no reply)", !ms.sum_check_success_ &&
+                                        sim.checkCount(3).unknown_cmd == 1);
+
+    cout << "group write" << endl;
+    GroupWrite wheel_group[3] = {{0, 100}, {1, -100}, {2, 50}};
+    ms.sendGroup(wheel_group, 3);
+    this_thread::sleep_for(chrono::milliseconds(20));
+    check("stage 3 wheels and latch", wheel_speed[0] == 100 &&
+                                          wheel_speed[1] == -100 &&
+                                          wheel_speed[2] == 50 &&
+                                          num_latch == 2);
+    check("bad slot", !ms.sendGroup(wheel_group, 0) &&
+                          !ms.sendGroup(wheel_group, NUM_GROUP_SLOT + 1));
+
+    cout << "wheel " << num_loop << " loops" << endl;
+    sim.setDropRate(4, 0);
+    sim.setCorruptRate(4, 0);
+    auto start_time = chrono::steady_clock::now();
+    for (int i = 0; i < num_loop; ++i) {
+      ms.send(1, 2, (short)i);
+      ms.send(1, 5, (short)-i);
+      ms.send(4, 3, (short)i);
+    }
+    double single_time = chrono::duration_cast<chrono::duration<double>>(
+                             chrono::steady_clock::now() - start_time)
+                             .count();
+    start_time = chrono::steady_clock::now();
+    for (int i = 0; i < num_loop; ++i) {
+      GroupWrite group[3] = {{0, (short)i}, {1, (short)-i}, {2, (short)i}};
+      ms.sendGroup(group, 3);
+    }
+    double group_time = chrono::duration_cast<chrono::duration<double>>(
+                            chrono::steady_clock::now() - start_time)
+                            .count();
+    cout << "  3 x send: " << single_time / num_loop * 1e6
+         << "us/loop, sendGroup: " << group_time / num_loop * 1e6 << "us/loop"
+         << endl;
+    this_thread::sleep_for(chrono::milliseconds(100));
+    check("last group latched", wheel_speed[0] == num_loop - 1 &&
+                                    wheel_speed[2] == num_loop - 1);
+    sim.setDropRate(4, 0.05);
+    sim.setCorruptRate(4, 0.05);
+
+    cout << "wheel with faults " << num_loop << " loops" << endl;
+    ms.checkTelemetry().reset();
+    for (int i = 0; i < num_loop; ++i) {
+      ms.send(1, 2, (short)i);
+      ms.send(1, 5, (short)-i);
+      ms.send(4, 3, (short)i);
+    }
+    ms.checkTelemetry().dump(cout);
+    for (unsigned char id : {1, 3, 4}) {
+      SimulatorCount count = sim.checkCount(id);
+      cout << "  id " << (int)id << " received: " << count.received
+           << ", replied: " << count.replied << ", dropped: " << count.dropped
+           << ", corrupted: " << count.corrupted
+           << ", unknown cmd: " << count.unknown_cmd << endl;
+    }
+    SimulatorCount wheel = sim.checkCount(4);
+    check("id 4 drops and corrupts", wheel.dropped > 0 && wheel.corrupted > 0);
+  }
+  cout << (num_ng ? "NG" : "All OK") << endl;
+  return num_ng ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+#include "../../include/motor_serial.hpp"
+#include "../../include/time.hpp"
+#include <iostream>
+#include <string>
+
+const char *arrc_raspi::PIGPIOD_HOST = "localhost";
+const char *arrc_raspi::PIGPIOD_PORT = "8888";
+
+using namespace arrc_raspi;
+using namespace std;
+
+double measure(MotorSerial &ms, unsigned char id, unsigned char cmd,
+               int num_send) {
+  int num_success = 0;
+  Timer timer;
+  for (int i = 0; i < num_send; ++i) {
+    ms.send(id, cmd, 0);
+    if (ms.sum_check_success_) {
+      ++num_success;
+    }
+  }
+  timer.update();
+  cout << "  " << num_success << "/" << num_send << " Receive Success" << endl;
+  return num_send / (double)timer.read();
+}
+
+int main(int argc, char *argv[]) {
+  MotorSerial ms;
+
+  unsigned char id = 1, cmd = 2;
+  int num_send = 1000;
+  if (argc >= 4) {
+    id = (unsigned char)stoi(argv[1]);
+    cmd = (unsigned char)stoi(argv[2]);
+    num_send = stoi(argv[3]);
+  }
+  cout << (int)id << " " << (int)cmd << " x" << num_send << endl;
+
+  ms.setBurstMode(false);
+  cout << "Byte Mode" << endl;
+  double byte_rate = measure(ms, id, cmd, num_send);
+  cout << "  " << byte_rate << " cmd/s" << endl;
+
+  ms.setBurstMode(true);
+  cout << "Burst Mode" << endl;
+  double burst_rate = measure(ms, id, cmd, num_send);
+  cout << "  " << burst_rate << " cmd/s" << endl;
+
+  cout << "Speed Up: x" << burst_rate / byte_rate << endl;
+  return 0;
+}
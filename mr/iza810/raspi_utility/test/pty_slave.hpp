@@ -0,0 +1,89 @@
+#ifndef ARRC_RASPI_TEST_PTY_SLAVE_HPP
+#define ARRC_RASPI_TEST_PTY_SLAVE_HPP
+#include <atomic>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <poll.h>
+#include <stdlib.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+namespace arrc_raspi {
+// テスト用の疑似端末のスレーブ. マスター側で0xFF, STXから始まる7byteのフレームを
+// 受け取るたびにon_frameを呼び, trueが返ればフレーム(書き換えてもよい)を送り返す
+// on_frameはスレーブのスレッドで呼ばれる. 遅らせたい時はon_frameの中で待つ
+using PtyFrameHandler = std::function<bool(unsigned char *frame)>;
+
+class PtySlave {
+public:
+  PtySlave(PtyFrameHandler on_frame) : on_frame_(on_frame) {
+    thread_loop_flag_ = true;
+    master_fd_ = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd_ < 0 || grantpt(master_fd_) < 0 ||
+        unlockpt(master_fd_) < 0) {
+      std::cout << "Pseudo Terminal Open Failed" << std::endl;
+      return;
+    }
+    termios tio;
+    tcgetattr(master_fd_, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(master_fd_, TCSANOW, &tio);
+    fcntl(master_fd_, F_SETFL, fcntl(master_fd_, F_GETFL) | O_NONBLOCK);
+    device_ = ptsname(master_fd_);
+    slave_thread_ = std::thread([this] { slaveLoop(); });
+  }
+  PtySlave(const PtySlave &) = delete;
+  PtySlave &operator=(const PtySlave &) = delete;
+
+  bool checkInit() { return slave_thread_.joinable(); }
+  // MotorSerialのdev_fileに渡すパス
+  const char *checkDevice() { return device_.c_str(); }
+
+  ~PtySlave() {
+    thread_loop_flag_ = false;
+    if (slave_thread_.joinable()) {
+      slave_thread_.join();
+    }
+    if (master_fd_ >= 0) {
+      close(master_fd_);
+    }
+  }
+
+private:
+  int master_fd_;
+  std::string device_;
+  PtyFrameHandler on_frame_;
+  std::atomic<bool> thread_loop_flag_;
+  std::thread slave_thread_;
+
+  void slaveLoop() {
+    unsigned char frame[7];
+    int i = 0;
+    while (thread_loop_flag_) {
+      pollfd pfd = {master_fd_, POLLIN, 0};
+      if (poll(&pfd, 1, 10) <= 0) {
+        continue;
+      }
+      unsigned char got_data;
+      while (read(master_fd_, &got_data, 1) == 1) {
+        if ((i == 0 && got_data != 0xFF) || (i == 1 && got_data != 0x41)) {
+          i = 0;
+          continue;
+        }
+        frame[i++] = got_data;
+        if (i < 7) {
+          continue;
+        }
+        i = 0;
+        if (on_frame_(frame) && write(master_fd_, frame, 7) != 7) {
+          std::cout << "Slave Write Failed" << std::endl;
+        }
+      }
+    }
+  }
+};
+} // namespace arrc_raspi
+#endif
@@ -0,0 +1,191 @@
+#include "../../include/motor_serial.hpp"
+#include "../pty_slave.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+const char *arrc_raspi::PIGPIOD_HOST = "localhost";
+const char *arrc_raspi::PIGPIOD_PORT = "8888";
+
+using namespace arrc_raspi;
+using namespace std;
+
+// 受け取ったフレームのdataをそのまま返すスレーブ
+// 安全停止(id 255)の後に届いたフレームの数も数える, reply_delay[us]待ってから返す
+atomic<bool> slave_stopped(false);
+atomic<int> num_after_stop(0);
+atomic<int> reply_delay(0);
+bool echoFrame(unsigned char *frame) {
+  if (frame[2] == 255) {
+    slave_stopped = true;
+  } else if (slave_stopped) {
+    ++num_after_stop;
+  }
+  this_thread::sleep_for(chrono::microseconds(reply_delay));
+  return true;
+}
+
+void measure(MotorSerial &ms, int num_frame) {
+  vector<double> latency;
+  int num_success = 0;
+  for (int i = 0; i < num_frame; ++i) {
+    short data = (short)(i * 37 - 1000);
+    auto start = chrono::steady_clock::now();
+    short receive_data = ms.send(1, 2, data);
+    auto end = chrono::steady_clock::now();
+    latency.push_back(
+        chrono::duration_cast<chrono::nanoseconds>(end - start).count() *
+        1.0e-3);
+    if (ms.sum_check_success_ && receive_data == data) {
+      ++num_success;
+    }
+  }
+  sort(latency.begin(), latency.end());
+  double sum = 0;
+  for (double x : latency) {
+    sum += x;
+  }
+  cout << "  " << num_success << "/" << num_frame << " Receive Success" << endl;
+  cout << "  latency[us] mean: " << sum / num_frame
+       << ", min: " << latency.front()
+       << ", p50: " << latency[num_frame / 2]
+       << ", p99: " << latency[num_frame * 99 / 100]
+       << ", max: " << latency.back() << endl;
+}
+
+// 非同期送信: 全部postしてから完了スロットで最後の返信を待つ
+void measureAsync(MotorSerial &ms, int num_frame) {
+  int num_rejected = 0;
+  AsyncReply reply = {};
+  ms.checkReply(1, reply);
+  unsigned int start_count = reply.count;
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < num_frame; ++i) {
+    SendDataFormat send_data = {1, 2, (short)i};
+    while (!ms.post(send_data)) {
+      ++num_rejected;
+      this_thread::yield();
+    }
+  }
+  auto post_end = chrono::steady_clock::now();
+  while (reply.count - start_count < (unsigned int)num_frame) {
+    ms.checkReply(1, reply);
+    this_thread::yield();
+  }
+  auto end = chrono::steady_clock::now();
+  cout << "  async post[us/frame]: "
+       << chrono::duration_cast<chrono::nanoseconds>(post_end - start)
+                  .count() *
+              1.0e-3 / num_frame
+       << ", complete[us/frame]: "
+       << chrono::duration_cast<chrono::nanoseconds>(end - start).count() *
+              1.0e-3 / num_frame
+       << ", rejected(full): " << num_rejected << ", last data: " << reply.data
+       << (reply.sum_check_success ? " OK" : " NG") << endl;
+}
+
+// futureで4台分まとめて要求を出し, 待っている間に別の計算をする
+void measureFuture(MotorSerial &ms, int num_frame) {
+  constexpr int NUM_ID = 4;
+  int num_success = 0;
+  double round_trip_sum = 0;
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < num_frame / NUM_ID; ++i) {
+    future<MotorReply> reply[NUM_ID];
+    for (int j = 0; j < NUM_ID; ++j) {
+      reply[j] = ms.request(j + 1, 2, (short)(i + j));
+    }
+    volatile double dummy = 0;
+    for (int k = 0; k < 1000; ++k) {
+      dummy += k * 0.5;
+    }
+    for (int j = 0; j < NUM_ID; ++j) {
+      MotorReply result = reply[j].get();
+      if (result.sum_check_success && result.data == (short)(i + j)) {
+        ++num_success;
+      }
+      round_trip_sum += result.round_trip;
+    }
+  }
+  auto end = chrono::steady_clock::now();
+  int num_sent = num_frame / NUM_ID * NUM_ID;
+  cout << "  future " << num_success << "/" << num_sent
+       << " Receive Success, round trip[us]: "
+       << round_trip_sum / num_sent * 1.0e+6 << ", total[us/frame]: "
+       << chrono::duration_cast<chrono::nanoseconds>(end - start).count() *
+              1.0e-3 / num_sent
+       << endl;
+}
+
+// 非同期送信を溜めたままdiscard()して安全停止を送り, 古いフレームが後から届かないか
+void measureDiscard(MotorSerial &ms) {
+  constexpr int NUM_QUEUED = 60;
+  atomic<int> num_sent(0), num_discarded(0);
+  reply_delay = 1000;
+  for (int i = 0; i < NUM_QUEUED; ++i) {
+    ms.request(1, 2, (short)i, [&](const MotorReply &reply) {
+      reply.is_sent ? ++num_sent : ++num_discarded;
+    });
+  }
+  slave_stopped = false;
+  num_after_stop = 0;
+  ms.discard();
+  ms.send(255, 255, 0);
+  while (num_sent + num_discarded < NUM_QUEUED) {
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  this_thread::sleep_for(chrono::milliseconds(20));
+  reply_delay = 0;
+  cout << "  discard sent: " << num_sent << ", discarded: " << num_discarded
+       << ", after stop: " << num_after_stop
+       << (num_after_stop == 0 && num_discarded > 0 ? " OK" : " NG") << endl;
+}
+
+int main(int argc, char *argv[]) {
+  int num_frame = 1000;
+  if (argc >= 2) {
+    num_frame = stoi(argv[1]);
+  }
+
+  PtySlave slave(echoFrame);
+  if (!slave.checkInit()) {
+    return 1;
+  }
+  string slave_name = slave.checkDevice();
+
+  {
+    cout << "Native Backend: " << slave_name << endl;
+    MotorSerial ms(slave_name.c_str(), 115200, -1, 10, NATIVE_SERIAL);
+    measure(ms, num_frame);
+    measureAsync(ms, num_frame);
+    measureFuture(ms, num_frame);
+    measureDiscard(ms);
+  }
+
+  // pigpiodは/dev/tty*しか開けないので, 第2引数のパスにシンボリックリンクを張る
+  if (argc >= 3) {
+    string link_name = argv[2];
+    unlink(link_name.c_str());
+    if (symlink(slave_name.c_str(), link_name.c_str()) == 0 &&
+        Pigpiod::gpio().checkInit()) {
+      cout << "Pigpiod Backend: " << link_name << endl;
+      MotorSerial ms(link_name.c_str(), 115200, -1, 10, PIGPIOD_SERIAL);
+      measure(ms, num_frame);
+      measureAsync(ms, num_frame);
+      measureFuture(ms, num_frame);
+    } else {
+      cout << "Pigpiod Backend: Skip" << endl;
+    }
+    unlink(link_name.c_str());
+  } else {
+    cout << "Pigpiod Backend: Skip (./test [num] /dev/ttyPTS0)" << endl;
+  }
+
+  return 0;
+}
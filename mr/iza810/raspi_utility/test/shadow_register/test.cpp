@@ -0,0 +1,68 @@
+#include "../../include/bus_scheduler.hpp"
+#include "../../include/motor_serial.hpp"
+#include "../../include/shadow_register.hpp"
+#include "../pty_slave.hpp"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+
+const char *arrc_raspi::PIGPIOD_HOST = "localhost";
+const char *arrc_raspi::PIGPIOD_PORT = "8888";
+
+using namespace arrc_raspi;
+using namespace std;
+
+// 受け取ったフレームの数と同期書き込みを反映した数を数えてエコーを返すスレーブ
+atomic<int> num_frame(0);
+atomic<int> num_latch(0);
+bool countFrame(unsigned char *frame) {
+  ++num_frame;
+  if (frame[2] == 255 && frame[3] == GROUP_LATCH_CMD) {
+    ++num_latch;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  int num_loop = 1000;
+  if (argc >= 2) {
+    num_loop = stoi(argv[1]);
+  }
+
+  PtySlave slave(countFrame);
+  if (!slave.checkInit()) {
+    return 1;
+  }
+
+  {
+    MotorSerial ms(slave.checkDevice(), 115200, -1, 10, NATIVE_SERIAL);
+    BusScheduler bus(ms);
+    ShadowRegister shadow(bus, 0.1);
+    // iza810/main.cppのメインループと同じように, 足回り3つ(同期書き込み)と
+    // 腕2つを毎周期送る. 足回りは100周期ごとに値を変え, 腕は変えない
+    for (int i = 0; i < num_loop; ++i) {
+      short wheel = (short)(i / 100 * 10);
+      shadow.setGroup(0, wheel);
+      shadow.setGroup(1, -wheel);
+      shadow.setGroup(2, wheel);
+      shadow.set(5, 60, 90);
+      shadow.set(5, 61, 45);
+      shadow.flush();
+      this_thread::sleep_for(chrono::microseconds(500));
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+    ShadowCount count = shadow.checkCount();
+    cout << "set: " << count.set << ", posted: " << count.posted
+         << ", coalesced: " << count.coalesced
+         << ", suppressed: " << count.suppressed
+         << ", refreshed: " << count.refreshed
+         << ", dropped: " << count.dropped << endl;
+    cout << "saved frames: " << count.set - count.posted << " ("
+         << 100.0 * (count.set - count.posted) / count.set << "%)" << endl;
+  }
+  cout << "slave received: " << num_frame << " frames, " << num_latch
+       << " group latches" << endl;
+
+  return 0;
+}
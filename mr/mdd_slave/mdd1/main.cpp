@@ -75,10 +75,41 @@ bool safe(int cmd, int rx_data, int &tx_data) {
 
 bool check(int cmd, int rx_data, int &tx_data) { return true; }
 
+// 同期書き込み, 一斉送信(id 255)で値を仮置きし, ラッチで全MDDが同時に反映する
+// 一斉送信なので返信はしない. slotの割り当てはiza810/main.cppのWHEEL_GROUP_SLOTと合わせる
+constexpr int GROUP_STAGE_CMD = 200, GROUP_LATCH_CMD = 254;
+constexpr int NUM_GROUP = 2;
+constexpr int GROUP_SLOT[NUM_GROUP] = {0, 1};
+constexpr int GROUP_MOTOR_ID[NUM_GROUP] = {0, 3}; // 足回り(cmd 2, 5)
+int group_data[NUM_GROUP] = {};
+bool group_staged[NUM_GROUP] = {};
+bool stageGroup(int cmd, int rx_data, int &tx_data) {
+  for (int i = 0; i < NUM_GROUP; ++i) {
+    if (cmd - GROUP_STAGE_CMD == GROUP_SLOT[i]) {
+      group_data[i] = rx_data;
+      group_staged[i] = true;
+    }
+  }
+  return true;
+}
+
+bool latchGroup(int cmd, int rx_data, int &tx_data) {
+  for (int i = 0; i < NUM_GROUP; ++i) {
+    if (group_staged[i]) {
+      spinMotor(GROUP_MOTOR_ID[i], group_data[i]);
+      group_staged[i] = false;
+    }
+  }
+  return true;
+}
+
 int main() {
   slave.addCMD(255, safe);
   slave.addCMD(2, spinMotor);
   slave.addCMD(5, spinMotor);
+  slave.addCMD(GROUP_STAGE_CMD + GROUP_SLOT[0], stageGroup);
+  slave.addCMD(GROUP_STAGE_CMD + GROUP_SLOT[1], stageGroup);
+  slave.addCMD(GROUP_LATCH_CMD, latchGroup);
 
   while (true) {
   }
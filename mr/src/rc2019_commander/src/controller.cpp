@@ -1,6 +1,7 @@
 #include <cmath>
 #include <iostream>
 #include <rc2019_commander/button.h>
+#include <robot_trace/ros_trace.hpp>
 #include <ros/ros.h>
 #include <sensor_msgs/Joy.h>
 #include <std_msgs/Bool.h>
@@ -11,6 +12,17 @@ rc2019_commander::button data; // button message
 double stick_x, stick_y, rotation_right_law, rotation_left_law, angle_move,
     velocity_move, speed;
 
+// 変化した時だけ送る. 値はパラメータ(~deadband等)で変えられる
+constexpr int NUM_AXIS = 6;
+constexpr int AXIS_INDEX[NUM_AXIS] = {0, 1, 2, 3, 12, 13};
+double axis_deadband = 0.02;    // スティックの変化がこれ以下なら送らない
+double axis_min_interval = 0.02; // スティックだけの変化はこの間隔以上空ける
+double heartbeat_period = 0.1;   // 何も変化しなくてもこの間隔で送る
+double published_axis[NUM_AXIS] = {};
+bool should_publish = false; // ボタンが変わったのですぐ送る
+bool axis_pending = false;   // スティックが変わったが間隔待ち
+int64_t joy_receive_time = 0; // robot_trace用, Joyを受け取った時刻
+
 namespace akashi {
 double map(double x, double in_min, double in_max, double out_min,
            double out_max) {
@@ -19,19 +31,39 @@ double map(double x, double in_min, double in_max, double out_min,
 }
 }
 
+// 中心付近は0にして, 離した後のわずかなずれで送り続けないようにする
+double deadband(double axis) {
+  return std::fabs(axis) < axis_deadband ? 0.0 : axis;
+}
+
 void joy_callback(const sensor_msgs::Joy &joy_msg) {
-  stick_x = joy_msg.axes[2];
-  stick_y = joy_msg.axes[3];
+  joy_receive_time = robot_trace::monotonicNow();
+  rc2019_commander::button prev = data;
+  sensor_msgs::Joy joy = joy_msg;
+  bool axis_changed = false;
+  for (int i = 0; i < NUM_AXIS; ++i) {
+    float &axis = joy.axes[AXIS_INDEX[i]];
+    axis = deadband(axis);
+    if (std::fabs(axis - published_axis[i]) > axis_deadband ||
+        (axis == 0.0 && published_axis[i] != 0.0)) {
+      axis_changed = true;
+    } else {
+      // 送らない変化は前に送った値のままにしておく
+      axis = published_axis[i];
+    }
+  }
+  stick_x = joy.axes[2];
+  stick_y = joy.axes[3];
   data.move_angle = atan2(stick_y, stick_x); // calculation in radians
   speed = hypot(stick_x, stick_y) *
           255; // caululation of speed of movement direction of robot
   if (speed > 255)
     speed = 255;
   data.move_speed = speed;
-  data.move_turn_right = akashi::map(joy_msg.axes[13], 1, -1, 0, 255);
-  data.move_turn_left = akashi::map(joy_msg.axes[12], 1, -1, 0, 255);
-  data.move_arm_x = akashi::map(joy_msg.axes[0], 1, -1, -0.1, 0.1);
-  data.move_arm_y = akashi::map(joy_msg.axes[1], -1, 1, -0.1, 0.1);
+  data.move_turn_right = akashi::map(joy.axes[13], 1, -1, 0, 255);
+  data.move_turn_left = akashi::map(joy.axes[12], 1, -1, 0, 255);
+  data.move_arm_x = akashi::map(joy.axes[0], 1, -1, -0.1, 0.1);
+  data.move_arm_y = akashi::map(joy.axes[1], -1, 1, -0.1, 0.1);
   // I have not put the rotation component yet
   data.calibration = joy_msg.buttons[16];
   data.arm_data_1 = joy_msg.buttons[5];
@@ -59,6 +91,30 @@ void joy_callback(const sensor_msgs::Joy &joy_msg) {
   } else {
     data.expansion_down_key = false;
   }
+  data.stamp = joy_msg.header.stamp;
+
+  if (data.turn_right != prev.turn_right || data.turn_left != prev.turn_left ||
+      data.arm_data_1 != prev.arm_data_1 ||
+      data.arm_data_2 != prev.arm_data_2 ||
+      data.calibration != prev.calibration ||
+      data.expansion_up != prev.expansion_up ||
+      data.expansion_up_key != prev.expansion_up_key ||
+      data.expansion_down != prev.expansion_down ||
+      data.expansion_down_key != prev.expansion_down_key ||
+      data.speed_half != prev.speed_half || data.loading != prev.loading ||
+      data.shooting != prev.shooting ||
+      data.laundry_case_open != prev.laundry_case_open ||
+      data.laundry_case_close != prev.laundry_case_close ||
+      data.hand != prev.hand || data.obon != prev.obon) {
+    should_publish = true;
+  } else if (axis_changed) {
+    axis_pending = true;
+  }
+  if (should_publish || axis_changed) {
+    for (int i = 0; i < NUM_AXIS; ++i) {
+      published_axis[i] = joy.axes[AXIS_INDEX[i]];
+    }
+  }
 }
 
 void check_callback(const std_msgs::Bool &check);
@@ -72,15 +128,42 @@ void joy_control_fase2();
 int main(int argc, char **argv) {
   ros::init(argc, argv, "manual_controller");
   ros::NodeHandle n;
+  robot_trace::openTrace(n, "controller");
   ros::Publisher controller_pub =
       n.advertise<rc2019_commander::button>("controller_info", 50);
   ros::Subscriber check_sub =
       n.subscribe("controller_check", 10, check_callback);
   ros::Subscriber joy_sub = n.subscribe("joy", 10, joy_callback);
-  ros::Rate loop_rate(1000);
+  ros::NodeHandle private_n("~");
+  private_n.param("deadband", axis_deadband, axis_deadband);
+  private_n.param("axis_min_interval", axis_min_interval, axis_min_interval);
+  private_n.param("heartbeat_period", heartbeat_period, heartbeat_period);
+  // 送るかどうかを見るだけなので1000Hzで回す必要はない
+  ros::Rate loop_rate(200);
+  ros::Time last_publish(0);
+  uint32_t trace_id = 0;
   while (ros::ok()) {
-    controller_pub.publish(data);
     ros::spinOnce();
+    ros::Time now = ros::Time::now();
+    double elapsed = (now - last_publish).toSec();
+    if (should_publish || (axis_pending && elapsed >= axis_min_interval) ||
+        elapsed >= heartbeat_period) {
+      // 入力が変わった時だけ番号を付ける, ハートビートは追わない
+      robot_trace::Tracer &tracer = robot_trace::Tracer::trace();
+      data.trace_id = 0;
+      if (tracer.isOpen() && (should_publish || axis_pending)) {
+        data.trace_id = ++trace_id;
+        tracer.record(data.trace_id, robot_trace::JOY_STAMP,
+                      robot_trace::toMonotonic(data.stamp));
+        tracer.record(data.trace_id, robot_trace::CONTROLLER_RECEIVE,
+                      joy_receive_time);
+      }
+      controller_pub.publish(data);
+      tracer.record(data.trace_id, robot_trace::CONTROLLER_PUBLISH);
+      last_publish = now;
+      should_publish = false;
+      axis_pending = false;
+    }
     loop_rate.sleep();
   }
   return 0;
@@ -1,33 +1,222 @@
 #include "motor_serial.hpp"
+#include "motor_serial/motor_commands.h"
+#include "motor_serial/motor_reply.h"
 #include "motor_serial/motor_serial.h"
+#include<chrono>
+#include<condition_variable>
+#include<deque>
+#include<future>
+#include<memory>
+#include<mutex>
+#include<robot_trace/ros_trace.hpp>
 #include<ros/ros.h>
+#include<string>
+#include<thread>
+#include<vector>
 
 using ros::MotorSerial;
+using Clock = std::chrono::steady_clock;
 MotorSerial ms;
+ros::Publisher reply_pub;
 
-bool motorSerialSend(motor_serial::motor_serial::Request &tx,motor_serial::motor_serial::Response &rx){
-	rx.data = ms.send(tx.id, tx.cmd, tx.data);
+//サービスごとのキュー, priorityが小さいほど先にバスに出す
+struct Job{
+	unsigned char id;
+	unsigned char cmd;
+	short data;
+	Clock::time_point queued_time;
+	std::shared_ptr<std::promise<short>> reply; //トピックから来たものはnullptr
+	uint32_t trace_id; //robot_traceの番号, 0は追わない
+};
+
+struct ServiceQueue{
+	ServiceQueue(const std::string &name, int priority, size_t capacity, bool is_topic = false)
+		: name(name), priority(priority), capacity(capacity), is_topic(is_topic), sent(0), rejected(0), sum_wait(0), max_wait(0){}
+	std::string name;
+	int priority;
+	size_t capacity;
+	bool is_topic; //motor_commands型のトピック
+	std::deque<Job> jobs;
+	unsigned long sent;
+	unsigned long rejected;
+	double sum_wait; //キューで待った時間[s]
+	double max_wait;
+};
+
+//サービス(トピック)名, 優先度, キューの長さ, トピックか
+//トピックは送る側ごとに分けて, 同じ優先度のキューを足回りと腕, テープLEDで共有しない
+std::vector<ServiceQueue> service_queue = {
+	{"motor_commands", 0, 32, true}, //足回り(three_omuni)
+	{"robot_arm", 1, 8},
+	{"arm_commands", 1, 16, true}, //腕の角度(robot_arm/arm_angle)
+	{"arm_calibration", 1, 8},
+	{"hand_info", 2, 8},
+	{"shotting_cloths", 2, 8},
+	{"robot_expansion", 2, 8},
+	{"laundry_basket", 2, 8},
+	{"head", 3, 8},
+	{"tape_led_commands", 4, 4, true}, //テープLED(tape_led)
+};
+std::mutex queue_mtx;
+std::condition_variable queue_cv;
+bool bus_loop_flag = true;
+
+//キューが満杯ならfalse
+bool push(int service, const Job &job){
+	std::lock_guard<std::mutex> lock(queue_mtx);
+	ServiceQueue &queue = service_queue[service];
+	if(queue.jobs.size() >= queue.capacity){
+		++queue.rejected;
+		return false;
+	}
+	queue.jobs.push_back(job);
+	queue_cv.notify_one();
 	return true;
 }
 
+//送信して, 返信と往復時間をmotor_replyに流す
+short sendAndReply(unsigned char id, unsigned char cmd, short data){
+	ros::WallTime start = ros::WallTime::now();
+	short rx_data = ms.send(id, cmd, data);
+	if(reply_pub.getNumSubscribers() > 0){
+		motor_serial::motor_reply reply;
+		reply.id = id;
+		reply.cmd = cmd;
+		reply.tx_data = data;
+		reply.rx_data = rx_data;
+		reply.round_trip = (ros::WallTime::now() - start).toSec();
+		reply_pub.publish(reply);
+	}
+	return rx_data;
+}
+
+//バスを使うのはこのスレッドだけ, 優先度の高いキューから1つずつ送る
+void busLoop(){
+	while(true){
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(queue_mtx);
+			ServiceQueue *next = nullptr;
+			queue_cv.wait(lock, [&]{
+				next = nullptr;
+				for(ServiceQueue &queue : service_queue){
+					if(!queue.jobs.empty() && (next == nullptr || queue.priority < next->priority)){
+						next = &queue;
+					}
+				}
+				return next != nullptr || !bus_loop_flag;
+			});
+			if(next == nullptr){
+				break;
+			}
+			job = next->jobs.front();
+			next->jobs.pop_front();
+			double wait = std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - job.queued_time).count();
+			++next->sent;
+			next->sum_wait += wait;
+			if(wait > next->max_wait){
+				next->max_wait = wait;
+			}
+		}
+		robot_trace::Tracer::trace().record(job.trace_id, robot_trace::BUS_TX_START);
+		short rx_data = sendAndReply(job.id, job.cmd, job.data);
+		robot_trace::Tracer::trace().record(job.trace_id, robot_trace::BUS_TX_END);
+		if(job.reply){
+			job.reply->set_value(rx_data);
+		}
+	}
+}
+
+//返信が必要な読み出しはサービスで, バスのスレッドが送るまで待つ
+class ServiceHandler{
+	public:
+		ServiceHandler(int service) : service_(service){}
+		bool call(motor_serial::motor_serial::Request &tx, motor_serial::motor_serial::Response &rx){
+			Job job = {tx.id, tx.cmd, tx.data, Clock::now(), std::make_shared<std::promise<short>>(), 0};
+			std::future<short> reply = job.reply->get_future();
+			if(!push(service_, job)){
+				ROS_WARN_STREAM_THROTTLE(1, service_queue[service_].name << " queue is full");
+				return false;
+			}
+			rx.data = reply.get();
+			return true;
+		}
+	private:
+		int service_;
+};
+
+//目標値など返信を待たなくていいものはトピックで, 送る側は止まらない
+class TopicHandler{
+	public:
+		TopicHandler(int service) : service_(service){}
+		void callback(const motor_serial::motor_commands &msg){
+			robot_trace::Tracer::trace().record(msg.trace_id, robot_trace::BUS_QUEUED);
+			//区間の時間は先頭の1つで測る
+			uint32_t trace_id = msg.trace_id;
+			for(const motor_serial::motor_command &command : msg.commands){
+				Job job = {command.id, command.cmd, command.data, Clock::now(), nullptr, trace_id};
+				if(!push(service_, job)){
+					ROS_WARN_STREAM_THROTTLE(1, service_queue[service_].name << " queue is full");
+				}
+				trace_id = 0;
+			}
+		}
+	private:
+		int service_;
+};
+
+//サービスごとの待ち時間を表示して最大値をリセットする
+void showQueueDelay(const ros::WallTimerEvent &event){
+	std::lock_guard<std::mutex> lock(queue_mtx);
+	for(ServiceQueue &queue : service_queue){
+		if(queue.sent == 0 && queue.rejected == 0){
+			continue;
+		}
+		ROS_INFO("%-16s sent: %lu, rejected: %lu, wait avg: %.3fms, max: %.3fms",
+				queue.name.c_str(), queue.sent, queue.rejected,
+				queue.sent ? queue.sum_wait / queue.sent * 1000 : 0.0, queue.max_wait * 1000);
+		queue.max_wait = 0;
+	}
+}
+
 int main(int argc, char **argv){
 	ros::init(argc, argv, "motor_serial");
 	ros::NodeHandle n;
+	robot_trace::openTrace(n, "motor_serial");
+	double delay_period;
+	n.param("motor_serial/delay_period", delay_period, 10.0);
 
-	ros::ServiceServer service_wheel = n.advertiseService("motor_info", motorSerialSend);
-	ros::ServiceServer service_arm = n.advertiseService("robot_arm", motorSerialSend);
-	ros::ServiceServer service_calibration = n.advertiseService("arm_calibration", motorSerialSend);
-	ros::ServiceServer service_expansion = n.advertiseService("robot_expansion", motorSerialSend);
-	ros::ServiceServer service_laundry = n.advertiseService("laundry_basket", motorSerialSend);
-	ros::ServiceServer service_shotting = n.advertiseService("shotting_cloths", motorSerialSend);
-	ros::ServiceServer service_hand = n.advertiseService("hand_info", motorSerialSend);
-	ros::ServiceServer service_led = n.advertiseService("tape_led", motorSerialSend);
-	ros::ServiceServer service_head = n.advertiseService("head", motorSerialSend);
+	std::thread bus_thread(busLoop);
+	std::vector<ServiceHandler> handlers;
+	std::vector<TopicHandler> topic_handlers;
+	handlers.reserve(service_queue.size());
+	topic_handlers.reserve(service_queue.size());
+	std::vector<ros::ServiceServer> services;
+	std::vector<ros::Subscriber> topics;
+	for(size_t i = 0; i < service_queue.size(); ++i){
+		if(service_queue[i].is_topic){
+			topic_handlers.emplace_back(i);
+			topics.push_back(n.subscribe(service_queue[i].name, 10, &TopicHandler::callback, &topic_handlers.back()));
+			continue;
+		}
+		handlers.emplace_back(i);
+		services.push_back(n.advertiseService(service_queue[i].name, &ServiceHandler::call, &handlers.back()));
+	}
+	reply_pub = n.advertise<motor_serial::motor_reply>("motor_reply", 100);
+	ros::WallTimer delay_timer = n.createWallTimer(ros::WallDuration(delay_period), showQueueDelay);
 	ROS_INFO_STREAM("Start MotorSerial");
 
-	ros::spin();
+	//サービスの処理はバスを待って止まるので, サービスの数だけスレッドを用意する
+	ros::AsyncSpinner spinner(service_queue.size());
+	spinner.start();
+	ros::waitForShutdown();
+
+	{
+		std::lock_guard<std::mutex> lock(queue_mtx);
+		bus_loop_flag = false;
+		queue_cv.notify_one();
+	}
+	bus_thread.join();
 	ms.send(255, 255, 0);
 	return 0;
 }
-
-
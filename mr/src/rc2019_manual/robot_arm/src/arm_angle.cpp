@@ -1,8 +1,9 @@
 #include<iostream>
 #include<cmath>
+#include<robot_trace/ros_trace.hpp>
 #include<ros/ros.h>
 #include<std_msgs/Float64MultiArray.h>
-#include"motor_serial/motor_serial.h"
+#include"motor_serial/motor_commands.h"
 
 using std::cout;
 using std::endl;
@@ -16,6 +17,7 @@ constexpr double calibration_angle_1 = M_PI / 2;
 constexpr double calibration_angle_2 = M_PI - (M_PI / 3);
 
 double x, y;
+uint32_t trace_id = 0; //angle_infoのdata[2], 次のmotor_commandsに付ける
 
 void positionCallback(const std_msgs::Float64MultiArray &position);
 void angle_calcurate(double *angle_1, double *angle_2);
@@ -23,12 +25,15 @@ void angle_calcurate(double *angle_1, double *angle_2);
 int main(int argc, char **argv){
 	ros::init(argc, argv, "robot_arm");
 	ros::NodeHandle n;
+	robot_trace::openTrace(n, "arm_angle");
 	ros::Publisher robot_arm_pub = n.advertise<std_msgs::Float64MultiArray>("arm_angle", 10);
 	ros::Publisher check_pub = n.advertise<std_msgs::Float64MultiArray>("check", 10);
 	ros::Subscriber robot_arm_sub = n.subscribe("angle_info", 10, positionCallback);
-	ros::ServiceClient arm_client = n.serviceClient<motor_serial::motor_serial>("robot_arm");
+	//足回りのmotor_commandsとは別のキューに入るように腕用のトピックで送る
+	ros::Publisher motor_pub = n.advertise<motor_serial::motor_commands>("arm_commands", 1);
 
-	motor_serial::motor_serial srv;
+	motor_serial::motor_commands commands;
+	commands.commands.resize(2);
 
 	double angle_1 = 0, angle_2 = 0;
 	int ARM_ID[2] = {5, 5};
@@ -53,12 +58,16 @@ int main(int argc, char **argv){
 		ROS_INFO("angle_2 = %d", (int)angle.data[1]);
 		angle_check.data[0] = angle.data[0];
 		angle_check.data[1] = angle.data[1];
+		//2軸まとめて返信を待たずに送る
 		for(int i = 0; i < 2; ++i){
-			srv.request.id = (unsigned int)ARM_ID[i];
-			srv.request.cmd = (unsigned int)ARM_CMD[i];
-			srv.request.data = (int)angle.data[i];
-			arm_client.call(srv);
+			commands.commands[i].id = ARM_ID[i];
+			commands.commands[i].cmd = ARM_CMD[i];
+			commands.commands[i].data = (int)angle.data[i];
 		}
+		commands.trace_id = trace_id;
+		motor_pub.publish(commands);
+		robot_trace::Tracer::trace().record(trace_id, robot_trace::NODE_PUBLISH);
+		trace_id = 0;
 		robot_arm_pub.publish(angle);
 		check_pub.publish(angle_check);
 		ros::spinOnce();
@@ -69,6 +78,9 @@ int main(int argc, char **argv){
 void positionCallback(const std_msgs::Float64MultiArray &position){
 	x = (double)position.data[0];
 	y = (double)position.data[1];
+	if(position.data.size() > 2 && position.data[2] != 0){
+		trace_id = (uint32_t)position.data[2];
+	}
 }
 
 void angle_calcurate(double *angle_1, double *angle_2){
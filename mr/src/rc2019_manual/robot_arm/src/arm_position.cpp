@@ -3,6 +3,7 @@
 #include <iostream>
 #include <motor_serial.hpp>
 #include <pigpiod.hpp>
+#include <robot_trace/ros_trace.hpp>
 #include <ros/ros.h>
 #include <std_msgs/Bool.h>
 #include <std_msgs/Float64MultiArray.h>
@@ -40,11 +41,14 @@ int arm_count = 0;
 int count_prev = 0;
 int gpio_handle_ = 0;
 double arm_angle_1 = 0, arm_angle_2 = 0;
+// controller_infoは変化した時しか来ないので, 足す量を覚えてループで足す
+double arm_move_x = 0, arm_move_y = 0;
 ros::ServiceClient calibration;
 
 int main(int argc, char **argv) {
   ros::init(argc, argv, "arm_position");
   ros::NodeHandle n;
+  robot_trace::openTrace(n, "arm_position");
   ros::Subscriber position_button_sub =
       n.subscribe("controller_info", 10, controllerButton);
   ros::Subscriber position_joy_sub =
@@ -64,7 +68,8 @@ int main(int argc, char **argv) {
      calibrationFlag_1);
      unsigned int z_2 = callback(gpio_handle_, pin_Z_2, RISING_EDGE,
      calibrationFlag_2);*/
-  angle_data.data.resize(2);
+  // data[2]はrobot_traceの番号, arm_angleがmotor_commandsに付けて送る
+  angle_data.data.resize(3);
   ros::Rate loop_rate(1000);
 
   while (ros::ok()) {
@@ -75,7 +80,10 @@ int main(int argc, char **argv) {
             angle_data.data[0] = 400;
             angle_data.data[1] = 250;
     }*/
+    angle_data.data[0] += arm_move_x;
+    angle_data.data[1] += arm_move_y;
     position_pub.publish(angle_data);
+    angle_data.data[2] = 0;
     ROS_INFO("angle_1 : %d", (int)angle_data.data[0]);
     ROS_INFO("angle_2 : %d", (int)angle_data.data[1]);
     //    calibration.data = true;
@@ -102,9 +110,17 @@ void controllerButton(const three_omuni::button &button) {
   }
 }
 void controllerJoy(const three_omuni::button &button) {
+  if (button.trace_id != 0) {
+    robot_trace::Tracer::trace().record(button.trace_id,
+                                        robot_trace::NODE_RECEIVE);
+    angle_data.data[2] = button.trace_id;
+  }
   if (button.arm_data_1 == 0 && button.arm_data_2 == 0) {
-    angle_data.data[0] += button.move_arm_x;
-    angle_data.data[1] += button.move_arm_y;
+    arm_move_x = button.move_arm_x;
+    arm_move_y = button.move_arm_y;
+  } else {
+    arm_move_x = 0;
+    arm_move_y = 0;
   }
 }
 /*
@@ -0,0 +1,31 @@
+#ifndef ROBOT_TRACE_ROS_TRACE_HPP
+#define ROBOT_TRACE_ROS_TRACE_HPP
+#include <robot_trace/trace.hpp>
+#include <ros/ros.h>
+#include <string>
+
+namespace robot_trace {
+// /trace/enableがtrueの時だけ/trace/dirに記録する, /run_idを同じ回の印にする
+inline void openTrace(ros::NodeHandle &n, const std::string &node) {
+  bool enable;
+  n.param("/trace/enable", enable, false);
+  if (!enable) {
+    return;
+  }
+  std::string dir, session;
+  n.param<std::string>("/trace/dir", dir, "/tmp/robot_trace");
+  // roslaunch(roscore)が起動ごとに付けるID
+  n.param<std::string>("/run_id", session, "");
+  if (Tracer::trace().open(dir, node, session)) {
+    ROS_INFO_STREAM("trace: " << dir);
+  } else {
+    ROS_WARN_STREAM("trace: cannot open " << dir);
+  }
+}
+
+inline int64_t toMonotonic(const ros::Time &stamp) {
+  return Tracer::trace().fromRealtime((int64_t)stamp.sec * 1000000000 +
+                                      stamp.nsec);
+}
+} // namespace robot_trace
+#endif
@@ -0,0 +1,86 @@
+#ifndef ROBOT_TRACE_TRACE_HPP
+#define ROBOT_TRACE_TRACE_HPP
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// スティックの入力がモーターに届くまでの各区間の時間を測る
+// ノードごとに1つのファイルへ固定長のレコードを書き, trace_summaryでまとめて見る
+namespace robot_trace {
+// 入力からバスまでの通過点, 順番に並べる
+enum Stage : uint8_t {
+  JOY_STAMP,          // joy_nodeが付けた時刻
+  CONTROLLER_RECEIVE, // controllerがJoyを受け取った
+  CONTROLLER_PUBLISH, // controller_infoを出した
+  NODE_RECEIVE,       // omuni, arm_positionなどが受け取った
+  NODE_PUBLISH,       // motor_commandsを出した
+  BUS_QUEUED,         // motor_serialがキューに積んだ
+  BUS_TX_START,       // バスに送り始めた
+  BUS_TX_END,         // 返信まで終わった
+  NUM_STAGE
+};
+const char *stageName(int stage);
+
+constexpr char TRACE_MAGIC[4] = {'R', 'T', 'R', 'C'};
+constexpr uint32_t TRACE_VERSION = 2;
+constexpr int TRACE_NODE_NAME = 24;
+constexpr int TRACE_SESSION = 40;
+
+struct TraceHeader {
+  char magic[4];
+  uint32_t version;
+  char node[TRACE_NODE_NAME];
+  // 同じ回に起動したノードで同じ値(roslaunchの/run_id). trace_idは起動ごとに
+  // 1から数え直すので, trace_summaryはsessionとtrace_idの組でまとめる
+  char session[TRACE_SESSION];
+  int64_t clock_offset; // CLOCK_REALTIME - CLOCK_MONOTONIC [ns]
+};
+
+struct TraceRecord {
+  uint32_t trace_id;
+  uint8_t stage;
+  uint8_t reserved[3];
+  int64_t time; // CLOCK_MONOTONIC [ns]
+};
+
+int64_t monotonicNow();
+int64_t realtimeNow();
+
+class Tracer {
+public:
+  static Tracer &trace() {
+    static Tracer tracer;
+    return tracer;
+  }
+  // dir/node_pid.rtrcを作って記録を始める, 開かなければrecordは何もしない
+  bool open(const std::string &dir, const std::string &node,
+            const std::string &session);
+  void close();
+  bool isOpen() const { return is_open_; }
+  // trace_idが0のものは記録しない
+  void record(uint32_t trace_id, Stage stage);
+  void record(uint32_t trace_id, Stage stage, int64_t time);
+  // ROSのTimeなどCLOCK_REALTIMEの時刻をこのプロセスの単調時刻に直す
+  int64_t fromRealtime(int64_t realtime) const {
+    return realtime - clock_offset_;
+  }
+
+private:
+  Tracer() : file_(nullptr), is_open_(false), clock_offset_(0) {}
+  ~Tracer() { close(); }
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+  std::mutex mtx_;
+  std::FILE *file_;
+  std::atomic<bool> is_open_;
+  int64_t clock_offset_;
+};
+
+// trace_summary用, ファイルを丸ごと読む
+bool readTrace(const std::string &path, TraceHeader &header,
+               std::vector<TraceRecord> &records);
+} // namespace robot_trace
+#endif
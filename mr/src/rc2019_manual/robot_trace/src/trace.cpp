@@ -0,0 +1,100 @@
+#include <cerrno>
+#include <cstring>
+#include <robot_trace/trace.hpp>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace robot_trace {
+const char *stageName(int stage) {
+  static const char *NAME[NUM_STAGE] = {
+      "joy_stamp",    "controller_receive", "controller_publish",
+      "node_receive", "node_publish",       "bus_queued",
+      "bus_tx_start", "bus_tx_end"};
+  return 0 <= stage && stage < NUM_STAGE ? NAME[stage] : "unknown";
+}
+
+static int64_t readClock(clockid_t clock) {
+  timespec now;
+  clock_gettime(clock, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+int64_t monotonicNow() { return readClock(CLOCK_MONOTONIC); }
+
+int64_t realtimeNow() { return readClock(CLOCK_REALTIME); }
+
+bool Tracer::open(const std::string &dir, const std::string &node,
+                  const std::string &session) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (file_ != nullptr) {
+    return true;
+  }
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    return false;
+  }
+  std::string path = dir + "/" + node + "_" + std::to_string(getpid()) + ".rtrc";
+  file_ = std::fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  TraceHeader header = {};
+  std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  std::strncpy(header.node, node.c_str(), TRACE_NODE_NAME - 1);
+  std::strncpy(header.session, session.c_str(), TRACE_SESSION - 1);
+  // 他のマシンのファイルと時刻を合わせるために差を残しておく
+  clock_offset_ = realtimeNow() - monotonicNow();
+  header.clock_offset = clock_offset_;
+  std::fwrite(&header, sizeof(header), 1, file_);
+  is_open_ = true;
+  return true;
+}
+
+void Tracer::close() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  is_open_ = false;
+  if (file_ != nullptr) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+void Tracer::record(uint32_t trace_id, Stage stage) {
+  if (is_open_ && trace_id != 0) {
+    record(trace_id, stage, monotonicNow());
+  }
+}
+
+void Tracer::record(uint32_t trace_id, Stage stage, int64_t time) {
+  if (!is_open_ || trace_id == 0) {
+    return;
+  }
+  TraceRecord record = {};
+  record.trace_id = trace_id;
+  record.stage = stage;
+  record.time = time;
+  // stdioのバッファに溜まるだけなので制御ループは止めない
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (file_ != nullptr) {
+    std::fwrite(&record, sizeof(record), 1, file_);
+  }
+}
+
+bool readTrace(const std::string &path, TraceHeader &header,
+               std::vector<TraceRecord> &records) {
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool is_valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                  std::memcmp(header.magic, TRACE_MAGIC, 4) == 0 &&
+                  header.version == TRACE_VERSION;
+  TraceRecord record;
+  while (is_valid && std::fread(&record, sizeof(record), 1, file) == 1) {
+    records.push_back(record);
+  }
+  std::fclose(file);
+  return is_valid;
+}
+} // namespace robot_trace
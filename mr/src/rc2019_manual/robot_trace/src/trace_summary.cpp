@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <robot_trace/trace.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 使い方: trace_summary /tmp/robot_trace/*.rtrc
+// 同じ回(session)の同じtrace_idの記録を集めて, 隣り合う通過点の間の時間を
+// 区間ごとに並べる. 前の回のファイルが混ざっていても別のtraceになる
+using robot_trace::NUM_STAGE;
+using robot_trace::TraceHeader;
+using robot_trace::TraceRecord;
+
+struct Trace {
+  bool has[NUM_STAGE] = {};
+  int64_t time[NUM_STAGE] = {};
+};
+
+double percentile(const std::vector<double> &sorted, double p) {
+  size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+void show(const std::string &name, std::vector<double> &latency) {
+  std::sort(latency.begin(), latency.end());
+  double sum = 0;
+  for (double value : latency) {
+    sum += value;
+  }
+  std::printf("%-42s %7zu %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f\n", name.c_str(),
+              latency.size(), latency.front(), sum / latency.size(),
+              percentile(latency, 0.5), percentile(latency, 0.9),
+              percentile(latency, 0.99), latency.back());
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s trace_file...\n", argv[0]);
+    return 1;
+  }
+  std::map<std::pair<std::string, uint32_t>, Trace> traces;
+  std::map<std::string, int> sessions; // sessionごとのファイルの数
+  for (int i = 1; i < argc; ++i) {
+    TraceHeader header;
+    std::vector<TraceRecord> records;
+    if (!robot_trace::readTrace(argv[i], header, records)) {
+      std::fprintf(stderr, "%s: not a trace file\n", argv[i]);
+      continue;
+    }
+    header.session[robot_trace::TRACE_SESSION - 1] = '\0';
+    std::string session = header.session;
+    ++sessions[session];
+    std::printf("%s: %s, session %s, %zu records\n", argv[i], header.node,
+                session.c_str(), records.size());
+    for (const TraceRecord &record : records) {
+      if (record.stage >= NUM_STAGE) {
+        continue;
+      }
+      // 各ノードの単調時刻をCLOCK_REALTIMEに揃える, 同じ通過点は最初の1回を使う
+      int64_t time = record.time + header.clock_offset;
+      Trace &trace = traces[std::make_pair(session, record.trace_id)];
+      if (!trace.has[record.stage] || time < trace.time[record.stage]) {
+        trace.has[record.stage] = true;
+        trace.time[record.stage] = time;
+      }
+    }
+  }
+
+  std::map<std::pair<int, int>, std::vector<double>> section;
+  std::vector<double> total;
+  for (const auto &trace_pair : traces) {
+    const Trace &trace = trace_pair.second;
+    int first = -1, prev = -1;
+    for (int stage = 0; stage < NUM_STAGE; ++stage) {
+      if (!trace.has[stage]) {
+        continue;
+      }
+      if (prev >= 0) {
+        section[std::make_pair(prev, stage)].push_back(
+            (trace.time[stage] - trace.time[prev]) * 1.0e-6);
+      } else {
+        first = stage;
+      }
+      prev = stage;
+    }
+    if (first >= 0 && prev == robot_trace::BUS_TX_END) {
+      total.push_back((trace.time[prev] - trace.time[first]) * 1.0e-6);
+    }
+  }
+
+  std::printf("\n%zu sessions, %zu traces, %zu reached the bus\n",
+              sessions.size(), traces.size(), total.size());
+  std::printf("%-42s %7s %8s %8s %8s %8s %8s %8s\n", "section [ms]", "count",
+              "min", "mean", "p50", "p90", "p99", "max");
+  for (auto &section_pair : section) {
+    show(std::string(robot_trace::stageName(section_pair.first.first)) +
+             " -> " + robot_trace::stageName(section_pair.first.second),
+         section_pair.second);
+  }
+  if (!total.empty()) {
+    show("total", total);
+  }
+  return 0;
+}
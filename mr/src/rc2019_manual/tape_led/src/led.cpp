@@ -1,5 +1,5 @@
 #include<ros/ros.h>
-#include "motor_serial/motor_serial.h"
+#include "motor_serial/motor_commands.h"
 #include<pigpiod_if2.h>
 #include<pigpiod.hpp>
 #include<std_msgs/String.h>
@@ -34,10 +34,12 @@ bool warning(){
 int main(int argc, char **argv){
 	ros::init(argc, argv, "led");
 	ros::NodeHandle n;
-	ros::ServiceClient tape_led = n.serviceClient<motor_serial::motor_serial>("tape_led");
+	//テープLEDは一番後回しでいいので専用のトピックで送る
+	ros::Publisher motor_pub = n.advertise<motor_serial::motor_commands>("tape_led_commands", 1);
 	ros::Subscriber calibration_sub = n.subscribe("calibration", 10, calibrationCallback);
 	ros::Publisher led_pub = n.advertise<std_msgs::String>("led_info", 10);
-	motor_serial::motor_serial srv;
+	motor_serial::motor_commands commands;
+	commands.commands.resize(1);
 	int led_data = 0;
 	gpio_handle = Pigpiod::gpio().checkHandle();
 	Pigpiod::gpio().set(WARNING_PIN, ros::IN, ros::PULL_UP);	
@@ -56,10 +58,11 @@ int main(int argc, char **argv){
 			msg.data = "NOMAL";
 		}
 
-		srv.request.id = 6;
-		srv.request.cmd = 100;
-		srv.request.data = led_data;
-		tape_led.call(srv);
+		//返信は使わないのでトピックで送る
+		commands.commands[0].id = 6;
+		commands.commands[0].cmd = 100;
+		commands.commands[0].data = led_data;
+		motor_pub.publish(commands);
 		led_pub.publish(msg);
 			
 		ros::spinOnce();
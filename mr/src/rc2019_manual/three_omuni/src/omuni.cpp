@@ -1,7 +1,8 @@
-#include "motor_serial/motor_serial.h"
+#include "motor_serial/motor_commands.h"
 #include "pigpiod.hpp"
 #include <cmath>
 #include <iostream>
+#include <robot_trace/ros_trace.hpp>
 #include <ros/ros.h>
 #include <std_msgs/Float64.h>
 #include <std_msgs/Int16.h>
@@ -19,6 +20,7 @@ double robot_left = 0;
 // double resolutional = 0;
 double gyro_angle = 0;
 bool speed_half = false;
+uint32_t trace_id = 0; // 次のmotor_commandsに付ける
 
 /*
    void joy_callback(const three_omuni::button &move_info){
@@ -36,6 +38,11 @@ void joy_callback(const three_omuni::button &move_info) {
   robot_right = (double)move_info.move_turn_left;
   robot_left = -(double)move_info.move_turn_right;
   move_info.speed_half == true ? speed_half = true : speed_half = false;
+  if (move_info.trace_id != 0) {
+    robot_trace::Tracer::trace().record(move_info.trace_id,
+                                        robot_trace::NODE_RECEIVE);
+    trace_id = move_info.trace_id;
+  }
   // cout << robot_angle << ":" << robot_speed << endl;
 }
 
@@ -116,13 +123,16 @@ void change_speed(double speed, double angle, double *wheel_control,
 int main(int argc, char **argv) {
   ros::init(argc, argv, "omuni");
   ros::NodeHandle n;
+  robot_trace::openTrace(n, "omuni");
   ros::Subscriber controller_sub =
       n.subscribe("controller_info", 10, joy_callback);
   ros::Subscriber gyro_sub = n.subscribe("gyro_info", 10, gyro_callback);
-  ros::ServiceClient motor_speed =
-      n.serviceClient<motor_serial::motor_serial>("motor_info");
+  // 目標値は返信を待たずにトピックで3輪まとめて送る
+  ros::Publisher motor_pub =
+      n.advertise<motor_serial::motor_commands>("motor_commands", 1);
   ros::Publisher check_pub = n.advertise<std_msgs::Int16>("check_wheel", 10);
-  motor_serial::motor_serial srv;
+  motor_serial::motor_commands commands;
+  commands.commands.resize(3);
   // this parameter will be dicided later
   constexpr int WHEEL_ID[3] = {1, 1, 4};
   constexpr int WHEEL_CMD[3] = {2, 5, 3};
@@ -137,12 +147,14 @@ int main(int argc, char **argv) {
       if (speed_half == true) {
         wheel_control[i] /= 2;
       }
-      srv.request.id = (unsigned int)WHEEL_ID[i];
-      srv.request.cmd = (unsigned int)WHEEL_CMD[i];
-      srv.request.data = (int)wheel_control[i];
-      // srv.request.data = 100;
-      motor_speed.call(srv);
+      commands.commands[i].id = WHEEL_ID[i];
+      commands.commands[i].cmd = WHEEL_CMD[i];
+      commands.commands[i].data = (int)wheel_control[i];
     }
+    commands.trace_id = trace_id;
+    motor_pub.publish(commands);
+    robot_trace::Tracer::trace().record(trace_id, robot_trace::NODE_PUBLISH);
+    trace_id = 0;
     // msg.data = (int)srv.request.data;
     msg.data = wheel_control[2];
     check_pub.publish(msg);
@@ -1,7 +1,7 @@
 #include<ros/ros.h>
 #include<pigpiod.hpp>
 #include<cmath>
-#include"motor_serial/motor_serial.h"
+#include"motor_serial/motor_commands.h"
 #include<iostream>
 #include<three_omuni/button.h>
 #include<std_msgs/Float64.h>
@@ -141,9 +141,10 @@ int main(int argc, char **argv){
 	ros::Subscriber gain_sub_wheel2 = n.subscribe("pid_gain_wheel2", 10, gain_callback_wheel2);
 	ros::Subscriber gain_sub_wheel3 = n.subscribe("pid_gain_wheel3", 10, gain_callback_wheel3);
 //	ros::Subscriber gain_goal = n.subscribe("pid_gain_goal", 10, gain_callback_goal);
-	ros::ServiceClient motor_speed = n.serviceClient<motor_serial::motor_serial>("motor_info");
+	ros::Publisher motor_pub = n.advertise<motor_serial::motor_commands>("motor_commands", 1);
 	ros::Publisher rqt_pub = n.advertise<std_msgs::Int16>("pid_info", 10);
-	motor_serial::motor_serial srv;
+	motor_serial::motor_commands commands;
+	commands.commands.resize(3);
 	//this parameter will be dicided later
 	constexpr int WHEEL_ID[3] = {1, 1, 1};
 	constexpr int WHEEL_CMD[3] = {4, 2, 5};
@@ -176,18 +177,18 @@ int main(int argc, char **argv){
 			speed_pid[i].PidUpdate((double)wheel_control[i], wheel_speed[i], prev_speed[i]);
 //			speed_pid[i].PidUpdate((double)pid_goal, wheel_speed[i], prev_speed[i]);
 			pid_result[i] = speed_pid[i].Get();
-			srv.request.id = (unsigned int)WHEEL_ID[i];
-			srv.request.cmd = (unsigned int)WHEEL_CMD[i];
+			commands.commands[i].id = WHEEL_ID[i];
+			commands.commands[i].cmd = WHEEL_CMD[i];
 			pid_result[i] *= 40;
 			pid_result[i] > 210.0 ? pid_result[i] = 210.0 : pid_result[i] = pid_result[i];
-			srv.request.data = (int)pid_result[i];
-			motor_speed.call(srv);
-			cout << srv.request.data << endl;
+			commands.commands[i].data = (int)pid_result[i];
+			cout << commands.commands[i].data << endl;
 			prev_speed[i] = wheel_speed[i];
 			wheel_prev[i] = wheel_now[i];
 			info.data = pid_result[i];
 			rqt_pub.publish(info); 
 		}
+		motor_pub.publish(commands);
 		ros::spinOnce();
 		loop_rate.sleep();
 	}